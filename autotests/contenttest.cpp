@@ -6,12 +6,24 @@
 
 #include "contenttest.h"
 
+#include <KCharsets>
+#include <KCodecs>
+
+#include <QBuffer>
 #include <QDebug>
+#include <QTemporaryFile>
 #include <QTest>
+#include <QTextCodec>
 
 #include <kmime_content.h>
 #include <kmime_headers.h>
 #include <kmime_message.h>
+#include <kmime_newsarticle.h>
+#include <../src/kmime_parsers.cpp>
+
+#include <algorithm>
+#include <memory>
+
 using namespace KMime;
 
 QTEST_MAIN(ContentTest)
@@ -377,13 +389,14 @@ void ContentTest::testMultipartMixed()
         "It DOES end with a linebreak.\n";
 
     // What we expect KMime to parse the above data into.
+    // (Unmodified headers are assembled as they were parsed.)
     QByteArray parsedWithPreambleAndEpilogue =
         "From: Nathaniel Borenstein <nsb@bellcore.com>\n"
         "To: Ned Freed <ned@innosoft.com>\n"
-        "Date: Sun, 21 Mar 1993 23:56:48 -0800\n"
+        "Date: Sun, 21 Mar 1993 23:56:48 -0800 (PST)\n"
         "Subject: Sample message\n"
         "MIME-Version: 1.0\n"
-        "Content-Type: multipart/mixed; boundary=\"simple boundary\"\n"
+        "Content-type: multipart/mixed; boundary=\"simple boundary\"\n"
         "\n"
         "This is the preamble.  It is to be ignored, though it\n"
         "is a handy place for composition agents to include an\n"
@@ -394,7 +407,7 @@ void ContentTest::testMultipartMixed()
         "This is implicitly typed plain US-ASCII text.\n"
         "It does NOT end with a linebreak.\n"
         "--simple boundary\n"
-        "Content-Type: text/plain; charset=\"us-ascii\"\n"
+        "Content-type: text/plain; charset=us-ascii\n"
         "\n"
         "This is explicitly typed plain US-ASCII text.\n"
         "It DOES end with a linebreak.\n"
@@ -597,6 +610,178 @@ void ContentTest::testParsingUuencoded()
     delete msg;
 }
 
+void ContentTest::testParsingMultipleUuencoded()
+{
+    const QByteArray firstFile = "This is the first uuencoded file in this post. It needs a few lines so that the parser accepts it.\n";
+    const QByteArray secondFile = "And this is the second uuencoded file. It also spans more than two lines of uuencoded output data.\n";
+
+    const QByteArray uuencodedMsg =
+        "From: Coin coin <meuh@example.net>\n"
+        "Newsgroups: test.kmime.uuencoded\n"
+        "Subject: Kmime test with two files\n"
+        "\n"
+        "Two files follow.\n"
+        "\n"
+        "begin 644 first.txt\n"
+        "M5&AI<R!I<R!T:&4@9FER<W0@=75E;F-O9&5D(&9I;&4@:6X@=&AI<R!P;W-T\n"
+        "M+B!)=\"!N965D<R!A(&9E=R!L:6YE<R!S;R!T:&%T('1H92!P87)S97(@86-C\n"
+        ")97!T<R!I=\"X*\n"
+        "`\n"
+        "end\n"
+        "\n"
+        "begin 644 second.txt\n"
+        "M06YD('1H:7,@:7,@=&AE('-E8V]N9\"!U=65N8V]D960@9FEL92X@270@86QS\n"
+        "M;R!S<&%N<R!M;W)E('1H86X@='=O(&QI;F5S(&]F('5U96YC;V1E9\"!O=71P\n"
+        ")=70@9&%T82X*\n"
+        "`\n"
+        "end\n"
+        "\n";
+
+    Message msg;
+    msg.setContent(uuencodedMsg);
+    msg.parse();
+    const auto contents = msg.contents();
+
+    // text + two files
+    QCOMPARE(contents.size(), 3);
+    QVERIFY(contents.at(0)->contentType()->isPlainText());
+
+    // Every attachment only contains its own data
+    QCOMPARE(contents.at(1)->contentDisposition()->filename(), QStringLiteral("first.txt"));
+    QCOMPARE(contents.at(1)->decodedContent(), firstFile);
+    QCOMPARE(contents.at(2)->contentDisposition()->filename(), QStringLiteral("second.txt"));
+    QCOMPARE(contents.at(2)->decodedContent(), secondFile);
+}
+
+void ContentTest::testParsingYenc_data()
+{
+    QTest::addColumn<QByteArray>("yenc");
+    QTest::addColumn<bool>("parsed");
+    QTest::addColumn<bool>("partial");
+    QTest::addColumn<int>("verification");
+
+    // 259 bytes including all the escaped values
+    const QByteArray data =
+        "*18FMT[bipw~07>ELSZahov}/6=}DKRY`gnu|.5<CJQX_fmt{-4;BIPW^elsz,3:\n"
+        "AHOV]dkry+29@GNUcjqx*18FMT[bipw~07>ELSZahov}/6=}DKRY`gnu|.5<CJQX\n"
+        "_fmt{-4;BIPW^elsz,3:AHOV]dkry+29@GNUcjqx*18FMT[bipw~07>ELSZahov}\n"
+        "/6=}DK=}=@=}*=@*-0369<BEHKNQTWZ]`cfilorux+.147:=}@CFILORUX[^adgj\n"
+        "mpsvy,/258;\n";
+    const QByteArray begin = "=ybegin line=64 size=259 name=test.bin\n";
+    const QByteArray partBegin =
+        "=ybegin part=1 total=2 line=64 size=518 name=test.bin\n"
+        "=ypart begin=1 end=259\n";
+
+    QTest::newRow("crc32") << QByteArray(begin + data + "=yend size=259 crc32=44dcef4a\n")
+                           << true << false << int(Parser::NonMimeParser::Verified);
+    QTest::newRow("crc32 mismatch") << QByteArray(begin + data + "=yend size=259 crc32=44dcef4b\n")
+                                    << true << false << int(Parser::NonMimeParser::VerificationFailed);
+    QTest::newRow("no crc32") << QByteArray(begin + data + "=yend size=259\n")
+                              << true << false << int(Parser::NonMimeParser::NotVerified);
+    QTest::newRow("no =yend") << QByteArray(begin + data)
+                              << false << false << int(Parser::NonMimeParser::NotVerified);
+    // a part is verified with the checksum of its own data, not the file's
+    QTest::newRow("pcrc32") << QByteArray(partBegin + data + "=yend size=259 part=1 pcrc32=44dcef4a crc32=12345678\n")
+                            << true << true << int(Parser::NonMimeParser::Verified);
+    QTest::newRow("pcrc32 mismatch") << QByteArray(partBegin + data + "=yend size=259 part=1 pcrc32=12345678 crc32=44dcef4a\n")
+                                     << true << true << int(Parser::NonMimeParser::VerificationFailed);
+    QTest::newRow("part without pcrc32") << QByteArray(partBegin + data + "=yend size=259 part=1 crc32=44dcef4a\n")
+                                         << true << true << int(Parser::NonMimeParser::NotVerified);
+}
+
+void ContentTest::testParsingYenc()
+{
+    QFETCH(QByteArray, yenc);
+    QFETCH(bool, parsed);
+    QFETCH(bool, partial);
+    QFETCH(int, verification);
+
+    const QByteArray binary = QByteArray::fromBase64(
+        "AAcOHCMqMTg/Rk1UBg0UGyIpMDc+RUxTBQwTGiEoLzY9REtSBAsSGSAnLjU8Q0pRAwoRGB8mLTQ7QklQ"
+        "AgkQFx4lLDM6QUhPAQgPFh0kKzlAR04ABw4cIyoxOD9GTVQGDRQbIikwNz5FTFMFDBMaISgvNj1ES1IE"
+        "CxIZICcuNTxDSlEDChEYHyYtNDtCSVACCRAXHiUsMzpBSE8BCA8WHSQrOUBHTgAHDhwjKjE4P0ZNVAYN"
+        "FBsiKTA3PkVMUwUMExohE9YTANYAAwYJDA8SGBseISQnKi0wMzY5PD9CRUhLTgEEBwoNEBMWGRwfIiUo"
+        "Ky4xNDc6PUBDRklMTwIFCAsOEQ==");
+    const QByteArray body = "A yEnc encoded file follows.\n\n" + yenc;
+
+    Parser::YENCEncoded parser(body);
+    QCOMPARE(parser.parse(), parsed);
+    if (!parsed) {
+        QVERIFY(parser.binaryParts().isEmpty());
+        QVERIFY(parser.verifications().isEmpty());
+        return;
+    }
+    QCOMPARE(parser.isPartial(), partial);
+    QCOMPARE(parser.binaryParts(), QVector<QByteArray>{binary});
+    QCOMPARE(parser.verifications().size(), 1);
+    QCOMPARE(int(parser.verifications().constFirst()), verification);
+    if (partial) {
+        return;
+    }
+
+    Message msg;
+    msg.setContent(
+        "From: Coin coin <meuh@example.net>\n"
+        "Newsgroups: test.kmime.yenc\n"
+        "Subject: Kmime test with yEnc\n"
+        "\n" + body);
+    msg.parse();
+    const auto contents = msg.contents();
+
+    // text + one file, whether or not the checksum matches
+    QCOMPARE(contents.size(), 2);
+    QVERIFY(contents.at(0)->contentType()->isPlainText());
+    QCOMPARE(contents.at(0)->body(), QByteArray("A yEnc encoded file follows.\n\n"));
+
+    QCOMPARE(contents.at(1)->contentDisposition()->filename(), QStringLiteral("test.bin"));
+    QCOMPARE(contents.at(1)->decodedContent(), binary);
+}
+
+void ContentTest::benchmarkParsingYenc()
+{
+    // a binary of the size posted to newsgroups, made of every possible
+    // byte value, including the escaped ones
+    const int size = 100 * 1024 * 1024;
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) {
+        data[i] = static_cast<char>(i * 7);
+    }
+
+    const QByteArray begin = "=ybegin line=128 size=" + QByteArray::number(size) + " name=data.bin\n";
+    const QByteArray end = "\n=yend size=" + QByteArray::number(size) + " crc32=" + QByteArray::number(crc32(data), 16) + "\n";
+    QByteArray yenc(begin.size() + size * 2 + size / 128 + end.size(), Qt::Uninitialized);
+    char *out = yenc.data();
+    out = std::copy(begin.cbegin(), begin.cend(), out);
+    int lineLength = 0;
+    for (const char c : std::as_const(data)) {
+        const char encoded = static_cast<char>(static_cast<uchar>(c) + 42);
+        if (encoded == '\0' || encoded == '\n' || encoded == '\r' || encoded == '=') {
+            *out++ = '=';
+            *out++ = static_cast<char>(static_cast<uchar>(encoded) + 64);
+        } else {
+            *out++ = encoded;
+        }
+        if (++lineLength == 128) {
+            *out++ = '\n';
+            lineLength = 0;
+        }
+    }
+    out = std::copy(end.cbegin(), end.cend(), out);
+    yenc.truncate(out - yenc.constData());
+
+    // decoding and CRC check only, without the conversion to base64 that
+    // parsing a Message adds
+    QBENCHMARK {
+        Parser::YENCEncoded parser(yenc);
+        QVERIFY(parser.parse());
+        QVERIFY(parser.verifications().constFirst() == Parser::NonMimeParser::Verified);
+    }
+
+    Parser::YENCEncoded parser(yenc);
+    QVERIFY(parser.parse());
+    QCOMPARE(parser.binaryParts().constFirst(), data);
+}
+
 void ContentTest::testParent()
 {
     auto *c1 = new Content();
@@ -879,3 +1064,589 @@ void ContentTest::testContentTypeMimetype()
         QCOMPARE(msg.contents().at(i)->contentType(false)->mimeType(), contentMimeType.at(i));
     }
 }
+
+void ContentTest::testClassification()
+{
+    const QByteArray data =
+        "From: Nobody <nobody@example.org>\n"
+        "Subject: signed\n"
+        "MIME-Version: 1.0\n"
+        "Content-Type: multipart/signed; protocol=\"application/pgp-signature\"; boundary=\"outer\"\n"
+        "\n"
+        "--outer\n"
+        "Content-Type: multipart/mixed; boundary=\"inner\"\n"
+        "\n"
+        "--inner\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "Hello\n"
+        "--inner\n"
+        "Content-Type: text/calendar; method=REQUEST\n"
+        "\n"
+        "BEGIN:VCALENDAR\n"
+        "END:VCALENDAR\n"
+        "--inner--\n"
+        "--outer\n"
+        "Content-Type: application/pgp-signature; name=\"signature.asc\"\n"
+        "\n"
+        "-----BEGIN PGP SIGNATURE-----\n"
+        "-----END PGP SIGNATURE-----\n"
+        "--outer--\n";
+
+    Message msg;
+    msg.setContent(data);
+    msg.parse();
+
+    QCOMPARE(msg.contents().size(), 2);
+    Content *mixed = msg.contents().at(0);
+    Content *signature = msg.contents().at(1);
+    QCOMPARE(mixed->contents().size(), 2);
+    Content *text = mixed->contents().at(0);
+    Content *calendar = mixed->contents().at(1);
+
+    QCOMPARE(msg.classification(), Content::Signed | Content::ContainsInvitation);
+    QCOMPARE(mixed->classification(), Content::Classification(Content::ContainsInvitation));
+    QCOMPARE(text->classification(), Content::Classification(Content::NoClassification));
+    QCOMPARE(calendar->classification(), Content::Invitation | Content::ContainsInvitation);
+    // crypto parts are never attachments, even with a name
+    QCOMPARE(signature->classification(), Content::CryptoPart | Content::Signed);
+    QCOMPARE(msg.textContent(), text);
+    QVERIFY(msg.attachments().isEmpty());
+    // computed by parse(), reading it does not modify anything
+    const Message &constMsg = msg;
+    QCOMPARE(constMsg.classification(), Content::Signed | Content::ContainsInvitation);
+
+    // the classification follows changes to the tree...
+    auto attachment = new Content;
+    attachment->contentType()->setMimeType("image/png");
+    attachment->contentDisposition()->setFilename(QStringLiteral("image.png"));
+    mixed->addContent(attachment);
+    QVERIFY(isAttachment(attachment));
+    QVERIFY(hasAttachment(mixed));
+    QCOMPARE(msg.attachments(), QVector<Content *>{attachment});
+
+    mixed->removeContent(calendar, true);
+    QVERIFY(!hasInvitation(&msg));
+
+    // ... and to its headers
+    attachment->contentDisposition()->setFilename(QString());
+    QVERIFY(!isAttachment(attachment));
+    QVERIFY(!hasAttachment(&msg));
+    QVERIFY(msg.attachments().isEmpty());
+
+    msg.contentType()->setMimeType("multipart/encrypted");
+    QVERIFY(!isSigned(&msg));
+    QVERIFY(isEncrypted(&msg));
+
+    // reading headers keeps the classification, modifying a header that
+    // was handed out before does not
+    auto cd = attachment->contentDisposition();
+    QVERIFY(!isAttachment(attachment));
+    QVERIFY(!msg.headerByType("Content-Type")->isEmpty());
+    cd->setDisposition(Headers::CDattachment);
+    QVERIFY(isAttachment(attachment));
+    QVERIFY(hasAttachment(&msg));
+
+    // a Content whose parent does not list it as child
+    std::unique_ptr<Content> unlisted(new Content(mixed));
+    QVERIFY(!isAttachment(unlisted.get()));
+    unlisted->contentDisposition()->setFilename(QStringLiteral("data.bin"));
+    QVERIFY(isAttachment(unlisted.get()));
+    QCOMPARE(msg.attachments(), QVector<Content *>{attachment});
+
+    std::unique_ptr<Content> copy(msg.clone());
+    QVERIFY(isEncrypted(copy.get()));
+    copy->contentType()->setMimeType("multipart/signed");
+    QVERIFY(isSigned(copy.get()));
+    QVERIFY(isEncrypted(&msg));
+}
+
+void ContentTest::testAssembleKeepsUnmodifiedHeaders()
+{
+    const QByteArray head =
+        "from:   Alice <alice@example.org>  (the sender)\n"
+        "DKIM-Signature: v=1; a=rsa-sha256; d=example.org; s=mail;\n"
+        "\th=from:subject; bh=abc=; b=def\n"
+        "Subject: a subject that was\n"
+        "   folded somewhere\n"
+        "Date: Sun, 21 Mar 1993 23:56:48 -0800 (PST)\n"
+        "MIME-Version: 1.0\n"
+        "Content-type: text/plain;   charset=us-ascii\n";
+    const QByteArray data = head + "\nbody\n";
+
+    Message msg;
+    msg.setContent(data);
+    msg.parse();
+    QVERIFY(!msg.subject()->rawField().isNull());
+    QCOMPARE(msg.date()->rawField(), QByteArray("Date: Sun, 21 Mar 1993 23:56:48 -0800 (PST)"));
+
+    // reading headers is no modification
+    QCOMPARE(msg.contentType()->mimeType(), QByteArray("text/plain"));
+    QVERIFY(msg.contentType()->isText());
+    msg.assemble();
+    QCOMPARE(msg.head(), head);
+
+    // only modified headers are generated again
+    msg.subject()->fromUnicodeString(QStringLiteral("New subject"), "utf-8");
+    QVERIFY(msg.subject()->rawField().isNull());
+    msg.contentType()->setCharset("utf-8");
+    msg.assemble();
+    QCOMPARE(msg.head(), QByteArray(
+                 "from:   Alice <alice@example.org>  (the sender)\n"
+                 "DKIM-Signature: v=1; a=rsa-sha256; d=example.org; s=mail;\n"
+                 "\th=from:subject; bh=abc=; b=def\n"
+                 "Subject: New subject\n"
+                 "Date: Sun, 21 Mar 1993 23:56:48 -0800 (PST)\n"
+                 "MIME-Version: 1.0\n"
+                 "Content-Type: text/plain; charset=\"utf-8\"\n"));
+}
+
+void ContentTest::testEncodedBodyCache()
+{
+    Message msg;
+    msg.contentType()->setMimeType("multipart/mixed");
+    msg.contentType()->setBoundary("boundary");
+    auto text = new Content;
+    text->contentType()->setMimeType("text/plain");
+    text->setBody("text\n");
+    msg.addContent(text);
+    auto attachment = new Content;
+    attachment->contentType()->setMimeType("application/octet-stream");
+    attachment->contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    attachment->setBody(QByteArray(4096, 'x'));
+    msg.addContent(attachment);
+    msg.assemble();
+
+    // unchanged Contents are not encoded again
+    const QByteArray encoded = attachment->encodedBody();
+    QVERIFY(encoded.startsWith("eHh4"));
+    QVERIFY(attachment->encodedBody().constData() == encoded.constData());
+
+    // adding a header to the top-level Content only changes its head
+    msg.encodedContent();
+    auto header = new Headers::Generic("X-Spam-Score");
+    header->from7BitString("0.0");
+    msg.appendHeader(header);
+    msg.assemble();
+    QVERIFY(attachment->encodedBody().constData() == encoded.constData());
+    const QByteArray body = msg.encodedBody();
+    QCOMPARE(msg.encodedBody(), body);
+    QVERIFY(body.contains(encoded));
+    QCOMPARE(msg.encodedContent(), msg.head() + body);
+    QVERIFY(msg.head().contains("X-Spam-Score: 0.0\n"));
+
+    // a changed sub-Content invalidates the encoded body of its ancestors
+    attachment->setBody(QByteArray(4096, 'y'));
+    QVERIFY(msg.encodedContent().contains("eXl5"));
+    QVERIFY(!msg.encodedContent().contains("eHh4"));
+
+    // so does a changed encoding, even before assembling
+    text->contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    QVERIFY(text->encodedBody().startsWith("dGV4dA"));
+    QVERIFY(msg.encodedBody().contains("dGV4dA"));
+
+    // and a body that is marked as already encoded
+    QVERIFY(attachment->encodedBody().startsWith("eXl5"));
+    attachment->contentTransferEncoding()->setDecoded(false);
+    QCOMPARE(attachment->encodedBody(), QByteArray(4096, 'y'));
+    QVERIFY(msg.encodedBody().contains(QByteArray(4096, 'y')));
+}
+
+void ContentTest::testMoveSetters_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("head and body") << QByteArray("Subject: test\nFrom: a@b.c\n\nbody\n");
+    QTest::newRow("empty head") << QByteArray("\nbody\n");
+    QTest::newRow("head only") << QByteArray("Subject: test\n");
+    QTest::newRow("empty line in body") << QByteArray("Subject: test\n\n\nbody\n");
+    QTest::newRow("empty body") << QByteArray("Subject: test\n\n");
+    QTest::newRow("empty") << QByteArray();
+}
+
+void ContentTest::testMoveSetters()
+{
+    QFETCH(QByteArray, data);
+
+    Content copied;
+    copied.setContent(data);
+
+    // same result as setContent(const QByteArray &)
+    Content moved;
+    QByteArray s = data;
+    s.detach();
+    moved.setContent(std::move(s));
+    QCOMPARE(moved.head(), copied.head());
+    QCOMPARE(moved.body(), copied.body());
+}
+
+void ContentTest::testTakeBody()
+{
+    QByteArray data = "Subject: test\n\n" + QByteArray(1 << 16, 'x');
+    data.detach();
+    const char *buffer = data.constData();
+
+    // the body keeps the buffer it was passed in
+    Content c;
+    c.setContent(std::move(data));
+    QCOMPARE(c.bodyView().size(), 1 << 16);
+    QVERIFY(c.bodyView().constData() == buffer);
+
+    QByteArray body = c.takeBody();
+    QVERIFY(body.constData() == buffer);
+    QVERIFY(c.body().isEmpty());
+    QCOMPARE(c.head(), QByteArray("Subject: test\n"));
+
+    c.setBody(std::move(body));
+    QVERIFY(c.bodyView().constData() == buffer);
+
+    const QByteArray head = c.takeHead();
+    QCOMPARE(head, QByteArray("Subject: test\n"));
+    QVERIFY(c.head().isEmpty());
+
+    c.setHead(QByteArray("Subject: test"));
+    QCOMPARE(c.head(), QByteArray("Subject: test\n"));
+    QVERIFY(c.encodedContent().endsWith("\n\nxxx" + QByteArray((1 << 16) - 3, 'x')));
+}
+
+void ContentTest::testClone()
+{
+    Message::Ptr msg(new Message);
+    msg->setContent(
+        "From: alice@example.org\n"
+        "Subject: =?utf-8?q?Gr=C3=BC=C3=9Fe?=\n"
+        "MIME-Version: 1.0\n"
+        "Content-Type: multipart/mixed;\n"
+        " boundary=\"boundary\"\n"
+        "\n"
+        "preamble\n"
+        "--boundary\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n"
+        "--boundary\n"
+        "Content-Type: message/rfc822\n"
+        "\n"
+        "Subject: inner\n"
+        "\n"
+        "inner text\n"
+        "--boundary--\n");
+    msg->parse();
+    auto attachment = new Content;
+    attachment->contentType()->setMimeType("application/octet-stream");
+    attachment->contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    attachment->setBody(QByteArray(4096, 'x'));
+    msg->addContent(attachment);
+    msg->assemble();
+    const QByteArray encoded = msg->encodedContent();
+
+    QScopedPointer<Message> copy(static_cast<Message *>(msg->clone()));
+    QVERIFY(dynamic_cast<Message *>(copy.data()));
+    QVERIFY(!copy->parent());
+    QCOMPARE(copy->encodedContent(), encoded);
+    QCOMPARE(copy->subject()->asUnicodeString(), QStringLiteral("Grüße"));
+    QCOMPARE(copy->subject()->rawField(), msg->subject()->rawField());
+    QCOMPARE(copy->contents().size(), 3);
+    const auto contents = copy->contents();
+    for (Content *c : contents) {
+        QCOMPARE(c->parent(), static_cast<Content *>(copy.data()));
+        QCOMPARE(c->topLevel(), static_cast<Content *>(copy.data()));
+    }
+
+    // body data is shared until modified
+    Content *attachmentCopy = copy->contents().at(2);
+    QVERIFY(attachmentCopy->contentTransferEncoding()->isDecoded());
+    QVERIFY(attachmentCopy->bodyView().constData() == attachment->bodyView().constData());
+    QVERIFY(copy->contents().at(1)->bodyIsMessage());
+    QCOMPARE(copy->contents().at(1)->bodyAsMessage()->subject()->asUnicodeString(), QStringLiteral("inner"));
+    QVERIFY(copy->contents().at(1)->bodyAsMessage() != msg->contents().at(1)->bodyAsMessage());
+
+    // and modifications of the copy do not affect the original
+    copy->subject()->fromUnicodeString(QStringLiteral("for Bob"), "utf-8");
+    attachmentCopy->setBody(QByteArray(4096, 'y'));
+    copy->assemble();
+    QVERIFY(copy->encodedContent().contains("Subject: for Bob\n"));
+    QVERIFY(copy->encodedContent().contains("eXl5"));
+    QCOMPARE(msg->encodedContent(), encoded);
+
+    // headers are copied with their types and values, none is dropped
+    Message headers;
+    headers.date()->setDateTime(QDateTime(QDate(2020, 2, 29), QTime(12, 0), Qt::UTC));
+    headers.contentType()->setMimeType("text/plain");
+    headers.contentType()->setCategory(Headers::CCmixedPart);
+    headers.contentTransferEncoding()->setDecoded(false);
+    auto custom = new Headers::Generic("X-Custom");
+    custom->from7BitString("value");
+    headers.appendHeader(custom);
+    headers.appendHeader(new Headers::Generic("X-Empty"));
+    QScopedPointer<Message> headersCopy(static_cast<Message *>(headers.clone()));
+    QCOMPARE(headersCopy->headers().size(), headers.headers().size());
+    QCOMPARE(headersCopy->date(false)->dateTime(), headers.date(false)->dateTime());
+    QCOMPARE(headersCopy->contentType(false)->category(), Headers::CCmixedPart);
+    QVERIFY(!headersCopy->contentTransferEncoding(false)->isDecoded());
+    QCOMPARE(headersCopy->headerByType("X-Custom")->as7BitString(), QByteArray("X-Custom: value"));
+    QVERIFY(headersCopy->headerByType("X-Empty"));
+    QCOMPARE(QByteArray(headersCopy->headerByType("X-Empty")->type()), QByteArray("X-Empty"));
+
+    // a NewsArticle stays a NewsArticle
+    NewsArticle article;
+    article.setContent("Newsgroups: comp.test\n\nbody\n");
+    article.parse();
+    QScopedPointer<Content> articleCopy(article.clone());
+    QVERIFY(dynamic_cast<NewsArticle *>(articleCopy.data()));
+    QCOMPARE(articleCopy->encodedContent(), article.encodedContent());
+}
+
+void ContentTest::testBodySource()
+{
+    QByteArray data;
+    for (int i = 0; i < 200 * 1024; ++i) {
+        data += char(i % 251);
+    }
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QCOMPARE(file.write(data), qint64(data.size()));
+    file.close();
+
+    Message msg;
+    msg.from()->from7BitString("alice@example.org");
+    msg.date()->from7BitString("Sun, 21 Mar 1993 23:56:48 -0800");
+    msg.contentType()->setMimeType("multipart/mixed");
+    msg.contentType()->setBoundary("boundary");
+    auto text = new Content;
+    text->contentType()->setMimeType("text/plain");
+    auto textData = new QBuffer;
+    textData->setData("first line\nsecond line\n");
+    QVERIFY(textData->open(QIODevice::ReadOnly));
+    QVERIFY(text->setBodySource(textData));
+    msg.addContent(text);
+    auto attachment = new Content;
+    attachment->contentType()->setMimeType("application/octet-stream");
+    QVERIFY(attachment->setBodySource(file.fileName()));
+    msg.addContent(attachment);
+    msg.assemble();
+
+    // the encoding is chosen from the data
+    QVERIFY(text->hasBodySource());
+    QVERIFY(text->body().isEmpty());
+    QCOMPARE(text->contentTransferEncoding()->encoding(), Headers::CE7Bit);
+    QCOMPARE(attachment->contentTransferEncoding()->encoding(), Headers::CEbase64);
+
+    // streaming gives the same result as encodedContent()
+    for (bool useCrLf : {false, true}) {
+        QByteArray streamed;
+        QBuffer buffer(&streamed);
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        QVERIFY(msg.writeEncodedContent(&buffer, useCrLf));
+        QCOMPARE(streamed, msg.encodedContent(useCrLf));
+    }
+
+    // and can be parsed again
+    Message parsed;
+    parsed.setContent(msg.encodedContent());
+    parsed.parse();
+    QCOMPARE(parsed.contents().size(), 2);
+    QCOMPARE(parsed.contents().at(0)->decodedText(), QStringLiteral("first line\nsecond line\n"));
+    QCOMPARE(parsed.contents().at(1)->decodedContent(), data);
+
+    // setting a body replaces the source
+    attachment->setBody("data");
+    QVERIFY(!attachment->hasBodySource());
+    QCOMPARE(attachment->decodedContent(), QByteArray("data"));
+
+    // unusable devices are rejected
+    QBuffer closed;
+    QVERIFY(!attachment->setBodySource(&closed));
+    QVERIFY(!attachment->setBodySource(QStringLiteral("/nonexistent/file")));
+}
+
+void ContentTest::testBase64_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QByteArray bytes;
+    for (int i = 0; i < 1000; ++i) {
+        bytes += char(i * 7 % 256);
+    }
+    // around the 57 bytes that fill a line, and the padding cases
+    for (int size : {0, 1, 2, 3, 4, 56, 57, 58, 113, 114, 115, 1000}) {
+        QTest::newRow(QByteArray::number(size).constData()) << bytes.left(size);
+    }
+}
+
+void ContentTest::testBase64()
+{
+    QFETCH(QByteArray, data);
+
+    // encoding and decoding are the same as with KCodecs
+    QByteArray expected;
+    KCodecs::base64Encode(data, expected, true);
+
+    Content c;
+    c.contentType()->setMimeType("application/octet-stream");
+    c.contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    c.contentTransferEncoding()->setDecoded(true);
+    c.setBody(data);
+    if (!data.isEmpty()) {
+        QCOMPARE(c.encodedBody(), expected + '\n');
+    }
+
+    Content binary;
+    binary.contentType()->setMimeType("application/octet-stream");
+    binary.contentTransferEncoding()->setEncoding(Headers::CEbinary);
+    binary.setBody(data);
+    binary.changeEncoding(Headers::CEbase64);
+    QCOMPARE(binary.body(), expected);
+    QCOMPARE(binary.decodedContent(), data);
+
+    c.contentTransferEncoding()->setDecoded(false);
+
+    // CRLF line breaks and broken input
+    for (const QByteArray &body : {QByteArray(expected).replace('\n', "\r\n"), expected + "\n", expected.left(expected.size() - 1),
+                                   QByteArray("QQ==QUJD"), QByteArray("QU JD"), QByteArray("QUJD="), QByteArray("=QUJD")}) {
+        c.setBody(body);
+        QCOMPARE(c.decodedContent(), KCodecs::base64Decode(body));
+    }
+}
+
+void ContentTest::benchmarkBase64Decode()
+{
+    QByteArray data;
+    for (int i = 0; i < 1024 * 1024; ++i) {
+        data += char(i % 251);
+    }
+    Content c;
+    c.contentType()->setMimeType("application/octet-stream");
+    c.contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    c.contentTransferEncoding()->setDecoded(false);
+    QByteArray encoded;
+    KCodecs::base64Encode(data, encoded, true);
+    c.setBody(encoded + '\n');
+    QBENCHMARK {
+        QCOMPARE(c.decodedContent().size(), data.size());
+    }
+}
+
+void ContentTest::testQuotedPrintable_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("plain") << QByteArray("Hello World\n");
+    QTest::newRow("specials") << QByteArray("a=b\tc\rd\xe4\xff\x01\n");
+    QTest::newRow("trailing spaces") << QByteArray("line \nend ");
+    QTest::newRow("crlf") << QByteArray("one\r\ntwo\r\n");
+    QTest::newRow("long line") << QByteArray(200, 'x');
+    QTest::newRow("long line with escapes") << QByteArray("<p style=\"color: red\">").repeated(10) + "\xc3\xa4 ";
+    QTest::newRow("break at the end") << QByteArray(71, 'x') + '\n';
+    QByteArray bytes;
+    for (int i = 0; i < 1000; ++i) {
+        bytes += char(i * 7 % 256);
+    }
+    QTest::newRow("all bytes") << bytes;
+}
+
+void ContentTest::testQuotedPrintable()
+{
+    QFETCH(QByteArray, data);
+
+    // encoding and decoding are the same as with KCodecs
+    const QByteArray expected = KCodecs::quotedPrintableEncode(data, false);
+
+    Content c;
+    c.contentType()->setMimeType("application/octet-stream");
+    c.contentTransferEncoding()->setEncoding(Headers::CEquPr);
+    c.contentTransferEncoding()->setDecoded(true);
+    c.setBody(data);
+    QCOMPARE(c.encodedBody(), expected);
+
+    // decodedContent() drops a final line break of quoted-printable
+    c.contentTransferEncoding()->setDecoded(false);
+    for (const QByteArray &body : {expected, QByteArray(expected).replace('\n', "\r\n"), QByteArray("=3d=3D=\n=\r\nx"),
+                                   QByteArray("broken =ZZ escape"), QByteArray("ends with ="), QByteArray("soft break at the end=\n")}) {
+        c.setBody(body);
+        QByteArray decoded = KCodecs::quotedPrintableDecode(body);
+        if (decoded.endsWith('\n')) {
+            decoded.chop(1);
+        }
+        QCOMPARE(c.decodedContent(), decoded);
+    }
+}
+
+void ContentTest::benchmarkQuotedPrintable()
+{
+    QByteArray html;
+    while (html.size() < 1024 * 1024) {
+        html += "<tr><td style=\"padding: 0 8px;\">Gr\xc3\xbc\xc3\x9f""e aus Berlin</td></tr>\n";
+    }
+    Content c;
+    c.contentType()->setMimeType("text/html");
+    c.contentTransferEncoding()->setEncoding(Headers::CEquPr);
+    c.contentTransferEncoding()->setDecoded(true);
+    QBENCHMARK {
+        c.setBody(html);
+        const QByteArray encoded = c.encodedBody();
+        c.contentTransferEncoding()->setDecoded(false);
+        c.setBody(encoded);
+        QCOMPARE(c.decodedContent(), html.left(html.size() - 1));
+        c.contentTransferEncoding()->setDecoded(true);
+    }
+}
+
+void ContentTest::testDecodedTextCharsets_data()
+{
+    QTest::addColumn<QByteArray>("charset");
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("utf-8 ascii") << QByteArray("utf-8") << QByteArray("Hello World, this is plain ASCII");
+    QTest::newRow("utf-8") << QByteArray("utf-8") << QByteArray("Gr\xc3\xbc\xc3\x9f""e \xe2\x82\xac \xf0\x9f\x98\x80");
+    QTest::newRow("utf-8 invalid") << QByteArray("utf-8") << QByteArray("Gr\xc3(e \xe2\x82");
+    QTest::newRow("utf-8 overlong") << QByteArray("utf-8") << QByteArray("\xc0\xaf\xe0\x80\xaf");
+    QTest::newRow("utf-8 surrogate") << QByteArray("utf-8") << QByteArray("\xed\xa0\x80");
+    QTest::newRow("utf-8 bom") << QByteArray("utf-8") << QByteArray("\xef\xbb\xbfHello");
+    QTest::newRow("iso-8859-1") << QByteArray("iso-8859-1") << QByteArray("Gr\xfc\xdf""e");
+    QTest::newRow("iso-8859-2") << QByteArray("iso-8859-2") << QByteArray("\xa3\xf3d\xbc");
+    QTest::newRow("iso-8859-15") << QByteArray("ISO-8859-15") << QByteArray("5 \xa4");
+    QTest::newRow("windows-1252") << QByteArray("windows-1252") << QByteArray("\x93quoted\x94 \x80 \x81");
+    QTest::newRow("koi8-r") << QByteArray("koi8-r") << QByteArray("\xf0\xd2\xc9\xd7\xc5\xd4");
+    QByteArray bytes;
+    for (int i = 0; i < 256; ++i) {
+        bytes += char(i);
+    }
+    QTest::newRow("windows-1251 all bytes") << QByteArray("windows-1251") << bytes;
+    QTest::newRow("iso-8859-7 all bytes") << QByteArray("iso-8859-7") << bytes;
+}
+
+void ContentTest::testDecodedTextCharsets()
+{
+    QFETCH(QByteArray, charset);
+    QFETCH(QByteArray, data);
+
+    // the text is the same as with the QTextCodec
+    bool ok = false;
+    const QTextCodec *codec = KCharsets::charsets()->codecForName(QLatin1String(charset), ok);
+    QVERIFY(ok && codec);
+
+    Content c;
+    c.contentType()->setMimeType("text/plain");
+    c.contentType()->setCharset(charset);
+    c.setBody(data + '\n');
+    QCOMPARE(c.decodedText(), codec->toUnicode(data));
+    // the cached conversion gives the same result again
+    QCOMPARE(c.decodedText(), codec->toUnicode(data));
+}
+
+void ContentTest::benchmarkDecodedText()
+{
+    QByteArray text;
+    while (text.size() < 1024 * 1024) {
+        text += "Liebe Gr\xc3\xbc\xc3\x9f""e aus Berlin, and some more ASCII text to go with it.\n";
+    }
+    Content c;
+    c.contentType()->setMimeType("text/plain");
+    c.contentType()->setCharset("utf-8");
+    c.setBody(text);
+    QBENCHMARK {
+        QCOMPARE(c.decodedText().size(), text.size() - text.count("\xc3") - 1);
+    }
+}
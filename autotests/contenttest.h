@@ -27,10 +27,38 @@ private Q_SLOTS:
       MIME structure is created.
     */
     void testParsingUuencoded();
-    // TODO: grab samples from http://www.yenc.org/develop.htm and make a Yenc test
+    /**
+      Tests that every part of a message with several
+      uuencoded files only contains its own data.
+    */
+    void testParsingMultipleUuencoded();
+    /**
+      Tests that a yEnc encoded message is decoded correctly,
+      including escaped characters, and that its CRC32 is verified.
+    */
+    void testParsingYenc_data();
+    void testParsingYenc();
+    void benchmarkParsingYenc();
     void testParent();
     void testFreezing();
     void testContentTypeMimetype_data();
     void testContentTypeMimetype();
+    void testClassification();
+    void testAssembleKeepsUnmodifiedHeaders();
+    void testEncodedBodyCache();
+    void testMoveSetters_data();
+    void testMoveSetters();
+    void testTakeBody();
+    void testClone();
+    void testBodySource();
+    void testBase64_data();
+    void testBase64();
+    void benchmarkBase64Decode();
+    void testQuotedPrintable_data();
+    void testQuotedPrintable();
+    void benchmarkQuotedPrintable();
+    void testDecodedTextCharsets_data();
+    void testDecodedTextCharsets();
+    void benchmarkDecodedText();
 };
 
@@ -0,0 +1,235 @@
+/*
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_envelope.h"
+#include "kmime_message.h"
+#include "kmime_util.h"
+
+#include <QObject>
+#include <QTest>
+
+using namespace KMime;
+
+class EnvelopeTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testHeaders();
+    void testFoldedCrLfHeaders();
+    void testFlags_data();
+    void testFlags();
+};
+
+void EnvelopeTest::testHeaders()
+{
+    const QByteArray raw =
+        "From: Alice Example <alice@example.org>\n"
+        "Sender: list-owner@example.org\n"
+        "To: bob@example.org, \"Carol\" <carol@example.org>\n"
+        "Cc: Team: dave@example.org, erin@example.org;\n"
+        "Reply-To: list@example.org\n"
+        "Subject: =?utf-8?q?Gr=C3=BC=C3=9Fe?= aus Berlin\n"
+        "Date: Fri, 21 Nov 1997 09:55:06 -0600\n"
+        "Message-ID: <1234@local.machine.example>\n"
+        "In-Reply-To: <1233@local.machine.example>\n"
+        "References: <1232@local.machine.example> <1233@local.machine.example>\n"
+        "X-Subject: ignored\n"
+        "Content-Type: Text/Plain; charset=utf-8\n"
+        "\n"
+        "From: not a header\n";
+
+    const Envelope envelope = extractEnvelope(raw);
+    QCOMPARE(envelope.from.size(), 1);
+    QCOMPARE(envelope.from.constFirst().name(), QStringLiteral("Alice Example"));
+    QCOMPARE(envelope.from.constFirst().address(), QByteArray("alice@example.org"));
+    QCOMPARE(envelope.sender.address(), QByteArray("list-owner@example.org"));
+    QCOMPARE(envelope.to.size(), 2);
+    QCOMPARE(envelope.to.at(1).name(), QStringLiteral("Carol"));
+    QCOMPARE(envelope.cc.size(), 2);
+    QCOMPARE(envelope.cc.at(1).address(), QByteArray("erin@example.org"));
+    QVERIFY(envelope.bcc.isEmpty());
+    QCOMPARE(envelope.replyTo.size(), 1);
+    QCOMPARE(envelope.subject, QStringLiteral("Grüße aus Berlin"));
+    QCOMPARE(envelope.date, Q_INT64_C(880127706));
+    QCOMPARE(envelope.messageId, QByteArray("1234@local.machine.example"));
+    QCOMPARE(envelope.inReplyTo, QVector<QByteArray>({"1233@local.machine.example"}));
+    QCOMPARE(envelope.references.size(), 2);
+    QCOMPARE(envelope.contentType, QByteArray("text/plain"));
+    QVERIFY(!envelope.hasAttachment);
+    QVERIFY(!envelope.isSigned);
+    QVERIFY(!envelope.isEncrypted);
+
+    // the same values as from the Headers classes
+    Message msg;
+    msg.setContent(raw);
+    msg.parse();
+    QCOMPARE(envelope.subject, msg.subject()->asUnicodeString());
+    QCOMPARE(envelope.date, msg.date()->dateTime().toSecsSinceEpoch());
+    QCOMPARE(envelope.messageId, msg.messageID()->identifier());
+    QCOMPARE(envelope.references, msg.references()->identifiers());
+}
+
+void EnvelopeTest::testFoldedCrLfHeaders()
+{
+    const QByteArray raw =
+        "Subject: a folded\r\n"
+        " subject\r\n"
+        "To: first@example.org,\r\n"
+        "\tsecond@example.org\r\n"
+        "\r\n"
+        "body\r\n";
+
+    const Envelope envelope = extractEnvelope(raw);
+    QCOMPARE(envelope.subject, QStringLiteral("a folded subject"));
+    QCOMPARE(envelope.to.size(), 2);
+    QCOMPARE(envelope.to.at(1).address(), QByteArray("second@example.org"));
+    QVERIFY(envelope.contentType.isEmpty());
+    QCOMPARE(envelope.date, Q_INT64_C(0));
+}
+
+void EnvelopeTest::testFlags_data()
+{
+    QTest::addColumn<QByteArray>("raw");
+
+    QTest::newRow("plain") << QByteArray(
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n");
+
+    QTest::newRow("single attachment") << QByteArray(
+        "Content-Type: application/pdf; name=\"doc.pdf\"\n"
+        "\n"
+        "data\n");
+
+    QTest::newRow("mixed") << QByteArray(
+        "Content-Type: multipart/mixed; boundary=\"outer\"\n"
+        "\n"
+        "preamble\n"
+        "--outer\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n"
+        "--outer\n"
+        "Content-Type: image/png\n"
+        "Content-Disposition: attachment;\n"
+        " filename=\"image.png\"\n"
+        "\n"
+        "data\n"
+        "--outer--\n");
+
+    QTest::newRow("alternative and related") << QByteArray(
+        "Content-Type: multipart/alternative; boundary=\"alt\"\n"
+        "\n"
+        "--alt\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n"
+        "--alt\n"
+        "Content-Type: multipart/related; boundary=\"rel\"\n"
+        "\n"
+        "--rel\n"
+        "Content-Type: text/html\n"
+        "\n"
+        "<img src=\"cid:image\">\n"
+        "--rel\n"
+        "Content-Type: image/png; name=\"image.png\"\n"
+        "Content-ID: <image>\n"
+        "\n"
+        "data\n"
+        "--rel--\n"
+        "--alt--\n");
+
+    QTest::newRow("signed") << QByteArray(
+        "Content-Type: multipart/signed; protocol=\"application/pgp-signature\";\n"
+        " micalg=pgp-sha1; boundary=\"sig\"\n"
+        "\n"
+        "--sig\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n"
+        "--sig\n"
+        "Content-Type: application/pgp-signature; name=\"signature.asc\"\n"
+        "\n"
+        "-----BEGIN PGP SIGNATURE-----\n"
+        "--sig--\n");
+
+    QTest::newRow("signed attachment in mixed") << QByteArray(
+        "Content-Type: multipart/mixed; boundary=\"outer\"\n"
+        "\n"
+        "--outer\n"
+        "Content-Type: multipart/signed; protocol=\"application/pgp-signature\";\n"
+        " boundary=\"sig\"\n"
+        "\n"
+        "--sig\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "text\n"
+        "--sig\n"
+        "Content-Type: application/pgp-signature\n"
+        "\n"
+        "signature\n"
+        "--sig--\n"
+        "--outer\n"
+        "Content-Type: application/zip\n"
+        "Content-Disposition: attachment; filename=\"a.zip\"\n"
+        "\n"
+        "data\n"
+        "--outer--\n");
+
+    QTest::newRow("encrypted") << QByteArray(
+        "Content-Type: multipart/encrypted; protocol=\"application/pgp-encrypted\";\n"
+        " boundary=\"enc\"\n"
+        "\n"
+        "--enc\n"
+        "Content-Type: application/pgp-encrypted\n"
+        "\n"
+        "Version: 1\n"
+        "--enc\n"
+        "Content-Type: application/octet-stream\n"
+        "Content-Disposition: inline; filename=\"msg.asc\"\n"
+        "\n"
+        "-----BEGIN PGP MESSAGE-----\n"
+        "--enc--\n");
+
+    QTest::newRow("forwarded message") << QByteArray(
+        "Content-Type: multipart/mixed; boundary=\"outer\"\n"
+        "\n"
+        "--outer\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "see below\n"
+        "--outer\n"
+        "Content-Type: message/rfc822\n"
+        "\n"
+        "Subject: inner\n"
+        "Content-Type: multipart/mixed; boundary=\"inner\"\n"
+        "\n"
+        "--inner\n"
+        "Content-Type: text/plain\n"
+        "\n"
+        "inner text\n"
+        "--inner--\n"
+        "--outer--\n");
+}
+
+void EnvelopeTest::testFlags()
+{
+    QFETCH(QByteArray, raw);
+
+    const Envelope envelope = extractEnvelope(raw);
+
+    Message::Ptr msg(new Message);
+    msg->setContent(raw);
+    msg->parse();
+    QCOMPARE(envelope.contentType, msg->contentType()->mimeType());
+    QCOMPARE(envelope.hasAttachment, KMime::hasAttachment(msg.data()));
+    QCOMPARE(envelope.isSigned, KMime::isSigned(msg.data()));
+    QCOMPARE(envelope.isEncrypted, KMime::isEncrypted(msg.data()));
+}
+
+QTEST_MAIN(EnvelopeTest)
+
+#include "envelopetest.moc"
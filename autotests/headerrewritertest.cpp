@@ -0,0 +1,171 @@
+/*
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_headerrewriter.h"
+#include "kmime_message.h"
+
+#include <QBuffer>
+#include <QObject>
+#include <QTest>
+
+using namespace KMime;
+
+class HeaderRewriterTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testRewrite_data();
+    void testRewrite();
+    void testCrLf();
+    void testDevice();
+    void testOverride();
+};
+
+void HeaderRewriterTest::testRewrite_data()
+{
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<QByteArray>("output");
+
+    const QByteArray body =
+        "\n"
+        "X-Spam-Score: in the body\n"
+        "Subject: not a header either\n";
+
+    QTest::newRow("message") << QByteArray(
+        "From: alice@example.org\n"
+        "x-spam-score: 9.9\n"
+        "Subject: a folded\n"
+        " subject\n"
+        "X-Spam-Flag: YES\n"
+        "X-Spam-Score : 5.0\n"
+        "Received: from a\n"
+        "Received: from b\n" + body) << QByteArray(
+        "From: alice@example.org\n"
+        "X-Spam-Score: 0.3\n"
+        "Subject: new subject\n"
+        "Received: from a\n"
+        "Received: from b\n"
+        "X-Mailer: test\n"
+        "X-Tag: 1\n" + body);
+
+    QTest::newRow("missing fields") << QByteArray(
+        "From: alice@example.org\n" + body) << QByteArray(
+        "From: alice@example.org\n"
+        "X-Spam-Score: 0.3\n"
+        "Subject: new subject\n"
+        "X-Mailer: test\n"
+        "X-Tag: 1\n" + body);
+
+    QTest::newRow("no body") << QByteArray(
+        "From: alice@example.org") << QByteArray(
+        "From: alice@example.org\n"
+        "X-Spam-Score: 0.3\n"
+        "Subject: new subject\n"
+        "X-Mailer: test\n"
+        "X-Tag: 1\n");
+
+    QTest::newRow("no header") << body << QByteArray(
+        "X-Spam-Score: 0.3\n"
+        "Subject: new subject\n"
+        "X-Mailer: test\n"
+        "X-Tag: 1\n" + body);
+}
+
+void HeaderRewriterTest::testRewrite()
+{
+    QFETCH(QByteArray, input);
+    QFETCH(QByteArray, output);
+
+    HeaderRewriter rewriter;
+    QVERIFY(rewriter.isEmpty());
+    rewriter.setHeader("X-Spam-Score", "0.3");
+    rewriter.setHeader("Subject", "new subject");
+    rewriter.removeHeader("X-Spam-Flag");
+    rewriter.appendHeader("X-Mailer", "test");
+    rewriter.appendHeader("X-Tag", "1");
+    QVERIFY(!rewriter.isEmpty());
+    QCOMPARE(rewriter.apply(input), output);
+
+    rewriter.clear();
+    QVERIFY(rewriter.isEmpty());
+    QCOMPARE(rewriter.apply(input), input);
+}
+
+void HeaderRewriterTest::testCrLf()
+{
+    const QByteArray input =
+        "From: alice@example.org\r\n"
+        "Subject: a folded\r\n"
+        "\tsubject\r\n"
+        "\r\n"
+        "body\r\n";
+
+    HeaderRewriter rewriter;
+    rewriter.setHeader("Subject", "=?utf-8?q?Gr=C3=BC=C3=9Fe?=");
+    rewriter.appendHeader("References",
+                          "<first.message.id@example.org> <second.message.id@example.org> "
+                          "<third.message.id@example.org>");
+    const QByteArray output = rewriter.apply(input);
+    QVERIFY(output.startsWith("From: alice@example.org\r\n"
+                              "Subject: =?utf-8?q?Gr=C3=BC=C3=9Fe?=\r\n"
+                              "References:"));
+    QVERIFY(output.endsWith("\r\n\r\nbody\r\n"));
+    // the References field is folded, with CRLF as well
+    QVERIFY(output.count('\n') > 5);
+    QCOMPARE(output.count("\r\n"), output.count('\n'));
+
+    Message msg;
+    msg.setContent(output);
+    msg.parse();
+    QCOMPARE(msg.subject()->asUnicodeString(), QStringLiteral("Grüße"));
+    QCOMPARE(msg.references()->identifiers().size(), 3);
+}
+
+void HeaderRewriterTest::testDevice()
+{
+    const QByteArray input =
+        "Subject: test\n"
+        "\n" + QByteArray(1 << 16, 'x');
+
+    HeaderRewriter rewriter;
+    rewriter.setHeader("X-Spam-Score", "0.0");
+
+    QByteArray result;
+    QBuffer buffer(&result);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(rewriter.apply(input, &buffer));
+    QCOMPARE(result, rewriter.apply(input));
+    QVERIFY(result.startsWith("Subject: test\nX-Spam-Score: 0.0\n\nxxx"));
+    QVERIFY(result.endsWith(input.mid(input.indexOf("\n\n"))));
+
+    // a device that is not writable
+    QBuffer readOnly(&result);
+    QVERIFY(readOnly.open(QIODevice::ReadOnly));
+    QTest::ignoreMessage(QtWarningMsg, "QIODevice::write (QBuffer): ReadOnly device");
+    QVERIFY(!rewriter.apply(input, &readOnly));
+}
+
+void HeaderRewriterTest::testOverride()
+{
+    const QByteArray input =
+        "Subject: test\n"
+        "X-Tag: old\n"
+        "\n"
+        "body\n";
+
+    HeaderRewriter rewriter;
+    rewriter.appendHeader("X-Tag", "a");
+    rewriter.setHeader("x-tag", "b");
+    QCOMPARE(rewriter.apply(input), QByteArray("Subject: test\nx-tag: b\n\nbody\n"));
+    rewriter.removeHeader("X-TAG");
+    QCOMPARE(rewriter.apply(input), QByteArray("Subject: test\n\nbody\n"));
+    rewriter.appendHeader("X-Tag", "c");
+    QCOMPARE(rewriter.apply(input), QByteArray("Subject: test\nX-Tag: c\n\nbody\n"));
+}
+
+QTEST_MAIN(HeaderRewriterTest)
+
+#include "headerrewritertest.moc"
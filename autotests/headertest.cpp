@@ -8,6 +8,7 @@
 
 #include <QTest>
 
+#include <kmime_header_parsing.h>
 #include <kmime_headers.h>
 
 using namespace KMime;
@@ -505,8 +506,20 @@ void HeaderTest::testParametrizedHeader()
     QCOMPARE(h->as7BitString(false), QByteArray("boundary=\"simple boundary\""));
     delete h;
 
+    // case-insensitive key-names, sorted output, replacing values
+    h = new Parametrized();
+    h->setParameter(QStringLiteral("Name"), QStringLiteral("a"));
+    h->setParameter(QStringLiteral("CHARSET"), QStringLiteral("utf-8"));
+    h->setParameter(QStringLiteral("name"), QStringLiteral("Grüße"));
+    QCOMPARE(h->parameter(QStringLiteral("NAME")), QStringLiteral("Grüße"));
+    QCOMPARE(h->parameter(QStringLiteral("charset")), QStringLiteral("utf-8"));
+    QVERIFY(h->parameter(QStringLiteral("boundary")).isNull());
+    QVERIFY(h->as7BitString(false).startsWith("charset=\"utf-8\"; name*="));
+    h->setParameter(QStringLiteral("name"), QStringLiteral("b"));
+    QCOMPARE(h->as7BitString(false), QByteArray("charset=\"utf-8\"; name=\"b\""));
+    delete h;
+
     // TODO: test RFC 2047 encoded values
-    // TODO: test case-insensitive key-names
 }
 
 void HeaderTest::testContentDispositionHeader()
@@ -615,6 +628,16 @@ void HeaderTest::testContentTypeHeader()
     h->setId("bla");
     h->setCharset("us-ascii");
     QCOMPARE(h->as7BitString(false), QByteArray("text/plain; charset=\"us-ascii\"; id=\"bla\""));
+    QCOMPARE(h->charset(), QByteArray("us-ascii"));
+    QCOMPARE(h->parameter(QStringLiteral("Charset")), QStringLiteral("us-ascii"));
+    h->setBoundary("=_b\xe4");
+    QCOMPARE(h->boundary(), QByteArray("=_b\xe4"));
+    QCOMPARE(h->parameter(QStringLiteral("boundary")), QStringLiteral("=_bä"));
+    h->setBoundary("simple");
+    QCOMPARE(h->boundary(), QByteArray("simple"));
+    h->setBoundary(QByteArray());
+    QVERIFY(h->hasParameter(QStringLiteral("boundary")));
+    QVERIFY(h->boundary().isEmpty());
 
     // clear header
     h->clear();
@@ -662,6 +685,33 @@ void HeaderTest::testContentTypeHeader()
     QCOMPARE(h->mimeType(), QByteArray("MULTIPART/MIXED"));
     QCOMPARE(h->mediaType(), QByteArray("MULTIPART"));
     QCOMPARE(h->subType(), QByteArray("MIXED"));
+    QCOMPARE(h->mediaTypeView(), QByteArray("MULTIPART"));
+    QCOMPARE(h->subTypeView(), QByteArray("MIXED"));
+    QVERIFY(!h->isText());
+    h->setMimeType("Text/HTML");
+    QVERIFY(h->isText());
+    QVERIFY(h->isHTMLText());
+    QVERIFY(!h->isPlainText());
+    QVERIFY(!h->isMultipart());
+    QCOMPARE(h->mediaTypeView(), QByteArray("Text"));
+    QCOMPARE(h->subTypeView(), QByteArray("HTML"));
+    h->setMimeType("image");
+    QVERIFY(h->isImage());
+    QVERIFY(h->isMediatype("image"));
+    QVERIFY(!h->isSubtype(""));
+    QCOMPARE(h->mediaTypeView(), QByteArray("image"));
+    QVERIFY(h->subTypeView().isEmpty());
+    h->setMimeType("texts/plain");
+    QVERIFY(!h->isText());
+    QVERIFY(!h->isPlainText());
+    h->clear();
+    QVERIFY(h->isPlainText());
+    QVERIFY(h->mediaTypeView().isEmpty());
+    h->from7BitString("Message/Partial; number=2; total=3");
+    QVERIFY(h->isPartial());
+    QVERIFY(h->isMediatype("message"));
+    QCOMPARE(h->subTypeView(), QByteArray("partial"));
+    QCOMPARE(h->partialNumber(), 2);
     delete h;
 
 }
@@ -1000,6 +1050,197 @@ void HeaderTest::testReturnPath()
     delete h;
 }
 
+void HeaderTest::testHeaderIterator()
+{
+    const QByteArray head("From: foo@example.org\n"
+                          "Subject: a folded\n"
+                          "  subject\n"
+                          "X-Empty:\n"
+                          "no colon here\n"
+                          "To:bar@example.org\r\n"
+                          "\n"
+                          "Body: not a header\n");
+
+    HeaderParsing::HeaderIterator it(head);
+    QVector<HeaderParsing::HeaderView> fields;
+    while (it.hasNext()) {
+        fields.append(it.next());
+    }
+    QCOMPARE(fields.size(), 4);
+
+    const auto bytes = [](const QPair<const char *, int> &span) {
+        return QByteArray(span.first, span.second);
+    };
+    QCOMPARE(bytes(fields.at(0).name), QByteArray("From"));
+    QCOMPARE(bytes(fields.at(0).value), QByteArray("foo@example.org"));
+    QVERIFY(!fields.at(0).folded);
+    // the spans point into the head
+    QCOMPARE(fields.at(0).name.first, head.constData());
+
+    QCOMPARE(bytes(fields.at(1).name), QByteArray("Subject"));
+    QCOMPARE(bytes(fields.at(1).value), QByteArray("a folded\n  subject"));
+    QVERIFY(fields.at(1).folded);
+    QCOMPARE(fields.at(1).unfoldedValue(), QByteArray("a folded subject"));
+
+    QCOMPARE(bytes(fields.at(2).name), QByteArray("X-Empty"));
+    QCOMPARE(fields.at(2).value.second, 0);
+
+    QCOMPARE(bytes(fields.at(3).name), QByteArray("To"));
+    QCOMPARE(bytes(fields.at(3).value), QByteArray("bar@example.org"));
+
+    QVERIFY(!HeaderParsing::HeaderIterator(QByteArray()).hasNext());
+}
+
+void HeaderTest::testAdjacentEncodedWords_data()
+{
+    QTest::addColumn<QByteArray>("subject");
+    QTest::addColumn<QString>("decoded");
+    QTest::addColumn<QByteArray>("charset");
+
+    // characters split between encoded-words, as sent by some mailers
+    QTest::newRow("utf-8") << QByteArray(
+        "=?UTF-8?B?44CQ6YeN6KaB4w==?=\n =?UTF-8?B?gJHmnaXpgLHjgQ==?=\n =?UTF-8?B?ruS8muitsOizhw==?=\n"
+        " =?UTF-8?B?5paZ44Gr44Gk4w==?=\n =?UTF-8?B?gYTjgabvvIjnrA==?=\n =?UTF-8?B?rDLlm57vvInjgQ==?=\n"
+        " =?UTF-8?B?lOeiuuiqjeOBjw==?=\n =?UTF-8?B?44Gg44GV44GE?=")
+        << QString::fromUtf8("【重要】来週の会議資料について（第2回）ご確認ください") << QByteArray("UTF-8");
+    QTest::newRow("gb2312") << QByteArray(
+        "=?gb2312?B?udjT2s/C1g==?= =?gb2312?B?3M/uxL/GwA==?= =?gb2312?B?yfO74dLptQ==?= "
+        "=?gb2312?B?xLCyxcXNqA==?= =?gb2312?B?1qo=?=")
+        << QString::fromUtf8("关于下周项目评审会议的安排通知") << QByteArray("gb2312");
+    QTest::newRow("with text") << QByteArray("Re: =?utf-8?q?caf=C3?= =?utf-8?q?=A9?= (2)")
+                               << QString::fromUtf8("Re: café (2)") << QByteArray("utf-8");
+    QTest::newRow("charset change") << QByteArray("=?utf-8?q?caf=C3?= =?utf-8?q?=A9?=  =?iso-8859-1?q?_=E9t=E9?=")
+                                    << QString::fromUtf8("café été") << QByteArray("UTF-8");
+    // nothing to merge
+    QTest::newRow("single word") << QByteArray("Re: =?iso-8859-1?q?caf=E9?= (2)")
+                                 << QString::fromUtf8("Re: café (2)") << QByteArray("iso-8859-1");
+    QTest::newRow("different charsets") << QByteArray("=?iso-8859-1?q?caf=E9?= =?utf-8?q?_=C3=A9t=C3=A9?=")
+                                        << QString::fromUtf8("café été") << QByteArray("UTF-8");
+}
+
+void HeaderTest::testAdjacentEncodedWords()
+{
+    QFETCH(QByteArray, subject);
+    QFETCH(QString, decoded);
+    QFETCH(QByteArray, charset);
+
+    Headers::Subject h;
+    h.from7BitString(subject);
+    QCOMPARE(h.asUnicodeString(), decoded);
+    QCOMPARE(h.rfc2047Charset().toLower(), charset.toLower());
+
+    // display names are phrases
+    Headers::From from;
+    from.from7BitString("=?UTF-8?B?5bGx55Q=?= =?UTF-8?B?sOWkquk=?= =?UTF-8?B?g44=?= <taro@example.org>");
+    QCOMPARE(from.displayNames(), QStringList(QString::fromUtf8("山田太郎")));
+}
+
+void HeaderTest::benchmarkAdjacentEncodedWords()
+{
+    const QByteArray subject =
+        "=?UTF-8?B?44CQ6YeN6KaB4w==?=\n =?UTF-8?B?gJHmnaXpgLHjgQ==?=\n =?UTF-8?B?ruS8muitsOizhw==?=\n"
+        " =?UTF-8?B?5paZ44Gr44Gk4w==?=\n =?UTF-8?B?gYTjgabvvIjnrA==?=\n =?UTF-8?B?rDLlm57vvInjgQ==?=\n"
+        " =?UTF-8?B?lOeiuuiqjeOBjw==?=\n =?UTF-8?B?44Gg44GV44GE?=";
+    Headers::Subject h;
+    QBENCHMARK {
+        h.from7BitString(subject);
+    }
+    QCOMPARE(h.asUnicodeString().size(), 27);
+}
+
+void HeaderTest::testAddressListForms_data()
+{
+    QTest::addColumn<QByteArray>("input");
+
+    QTest::newRow("bare address") << QByteArray("joe@example.com");
+    QTest::newRow("angle-addr") << QByteArray("<joe@example.com>");
+    QTest::newRow("phrase") << QByteArray("Joe Q. Public <john.q.public@example.com>");
+    QTest::newRow("quoted name") << QByteArray("\"Public, Joe\" <joe@example.com>, \"\\\"Q\\\" \" <q@example.com>");
+    QTest::newRow("encoded-word") << QByteArray("=?UTF-8?Q?J=C3=B6rg?= <joerg@example.com>");
+    QTest::newRow("adjacent encoded-words") << QByteArray("=?UTF-8?B?5bGx55Sw?= =?UTF-8?B?5aSq6YOO?= <taro@example.jp>");
+    QTest::newRow("encoded-word and atoms") << QByteArray("Dr. =?ISO-8859-1?Q?M=FCller?= \"Jr.\" <m@example.com>");
+    QTest::newRow("8bit name") << QByteArray("J\xc3\xb6rg <joerg@example.com>");
+    QTest::newRow("bidi") << QByteArray("=?UTF-8?Q?=E2=80=AEevil?= <evil@example.com>");
+    QTest::newRow("list") << QByteArray("a@example.com, B <b@example.com>,\n c@example.com ,, ; D <d@example.com>");
+    QTest::newRow("no commas") << QByteArray("a@example.com b@example.com");
+    QTest::newRow("trailing dot") << QByteArray("a@example.com., B <b@example.>");
+    QTest::newRow("odd dots") << QByteArray("a..b@example.com, .c@example.com");
+    QTest::newRow("comment") << QByteArray("a@example.com (Joe), Joe (X) <b@example.com>, <c@example.com> (C)");
+    QTest::newRow("quoted local-part") << QByteArray("\"a b\"@example.com, C <\"c\\\"d\"@example.com>");
+    QTest::newRow("domain literal") << QByteArray("a@[127.0.0.1], B <b@[::1]>");
+    QTest::newRow("spaces in addr-spec") << QByteArray("B < b @ example.com >");
+    QTest::newRow("obs-route") << QByteArray("B <@relay.example.com:b@example.com>");
+    QTest::newRow("group") << QByteArray("Friends: a@example.com, B <b@example.com>;, c@example.com");
+    QTest::newRow("empty group") << QByteArray("undisclosed-recipients:;");
+    QTest::newRow("folded") << QByteArray("Joe\n Public <joe@example.com>,\r\n\t\"Q\" <q@example.com>");
+}
+
+void HeaderTest::testAddressListForms()
+{
+    QFETCH(QByteArray, input);
+    const Types::Mailbox::List expected = Types::Mailbox::listFrom7BitString(input);
+
+    QStringList expectedNames;
+    QVector<QByteArray> expectedAddresses;
+    for (const Types::Mailbox &mbox : expected) {
+        expectedNames.append(mbox.hasName() ? mbox.name() : QString::fromLatin1(mbox.address()));
+        expectedAddresses.append(mbox.address());
+    }
+
+    To to;
+    to.from7BitString(input);
+    QCOMPARE(to.addresses(), expectedAddresses);
+    QCOMPARE(to.displayNames(), expectedNames);
+    QCOMPARE(to.isEmpty(), expected.isEmpty() && !input.contains(':'));
+    const Types::Mailbox::List mailboxes = to.mailboxes();
+    QCOMPARE(mailboxes.size(), expected.size());
+    for (int i = 0; i < mailboxes.size(); ++i) {
+        QCOMPARE(mailboxes.at(i).addrSpec().localPart, expected.at(i).addrSpec().localPart);
+        QCOMPARE(mailboxes.at(i).addrSpec().domain, expected.at(i).addrSpec().domain);
+        QCOMPARE(mailboxes.at(i).name(), expected.at(i).name());
+    }
+
+    From from;
+    from.from7BitString(input);
+    QCOMPARE(from.addresses(), expectedAddresses);
+    QCOMPARE(from.displayNames(), expectedNames);
+    QCOMPARE(from.asUnicodeString(), Types::Mailbox::listToUnicodeString(expected));
+}
+
+void HeaderTest::benchmarkAddressList()
+{
+    QByteArray input;
+    for (int i = 0; i < 2000; ++i) {
+        input += "Recipient " + QByteArray::number(i) + " <recipient" + QByteArray::number(i) + "@example.com>,\n ";
+    }
+    To to;
+    QBENCHMARK {
+        to.from7BitString(input);
+    }
+    QCOMPARE(to.addresses().size(), 2000);
+    QCOMPARE(to.addresses().last(), QByteArray("recipient1999@example.com"));
+}
+
+void HeaderTest::benchmarkAddressListRead()
+{
+    // what a message list does on every repaint, after parsing once
+    From from;
+    from.from7BitString("=?utf-8?q?J=C3=BCrgen_M=C3=BCller?= <juergen@example.com>");
+    To to;
+    QByteArray input;
+    for (int i = 0; i < 200; ++i) {
+        input += "\"Recipient " + QByteArray::number(i) + "\" <recipient" + QByteArray::number(i) + "@example.com>,\n ";
+    }
+    to.from7BitString(input);
+    QBENCHMARK {
+        QCOMPARE(from.displayString(), QString::fromUtf8("Jürgen Müller"));
+        QCOMPARE(from.mailboxes().size(), 1);
+        QVERIFY(to.displayString().endsWith(QLatin1String("Recipient 199")));
+        QCOMPARE(to.displayNames().size(), 200);
+        QCOMPARE(to.mailboxes().size(), 200);
+    }
+}
+
 void HeaderTest::noAbstractHeaders()
 {
     From *h2 = new From(); delete h2;
@@ -35,6 +35,14 @@ private Q_SLOTS:
     void testBug271192();
     void testBug271192_data();
     void testMissingQuotes();
+    void testHeaderIterator();
+    void testAdjacentEncodedWords_data();
+    void testAdjacentEncodedWords();
+    void benchmarkAdjacentEncodedWords();
+    void testAddressListForms_data();
+    void testAddressListForms();
+    void benchmarkAddressList();
+    void benchmarkAddressListRead();
 
     // makes sure we don't accidentally have an abstract header class that's not
     // meant to be abstract
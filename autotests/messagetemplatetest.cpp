@@ -0,0 +1,145 @@
+/*
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_messagetemplate.h"
+
+#include <QObject>
+#include <QTest>
+
+using namespace KMime;
+
+class MessageTemplateTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testInstantiate();
+    void testSinglePart();
+    void testAttachmentName();
+    void benchmarkInstantiate();
+    void benchmarkAssemble();
+};
+
+namespace
+{
+
+// Builds the same message with either the values or placeholders.
+Message::Ptr createMessage(const QString &to, const QString &name, const QString &fileName = QStringLiteral("news.pdf"))
+{
+    Message::Ptr msg(new Message);
+    msg->from()->fromUnicodeString(QStringLiteral("News <news@example.org>"), "utf-8");
+    if (to.startsWith(QLatin1String("{{"))) {
+        auto header = new Headers::Generic("To");
+        header->fromUnicodeString(to, "utf-8");
+        msg->setHeader(header);
+    } else {
+        msg->to()->fromUnicodeString(to, "utf-8");
+    }
+    msg->subject()->fromUnicodeString(QStringLiteral("Neuigkeiten für ") + name, "utf-8");
+    msg->date()->from7BitString("Sun, 21 Mar 1993 23:56:48 -0800");
+    msg->contentType()->setMimeType("multipart/mixed");
+    msg->contentType()->setBoundary("boundary");
+
+    auto text = new Content;
+    text->contentType()->setMimeType("text/plain");
+    text->contentType()->setCharset("utf-8");
+    text->contentTransferEncoding()->setEncoding(Headers::CEquPr);
+    text->fromUnicodeString(QStringLiteral("Hallo ") + name + QStringLiteral(",\n\nanbei die Neuigkeiten.\n"));
+    msg->addContent(text);
+
+    auto attachment = new Content;
+    attachment->contentType()->setMimeType("application/pdf");
+    attachment->contentType()->setName(fileName, "utf-8");
+    attachment->contentTransferEncoding()->setEncoding(Headers::CEbase64);
+    attachment->setBody(QByteArray(1 << 16, 'x'));
+    msg->addContent(attachment);
+    return msg;
+}
+
+} // namespace
+
+void MessageTemplateTest::testInstantiate()
+{
+    const MessageTemplate tmpl(createMessage(QStringLiteral("{{to}}"), QStringLiteral("{{name}}")));
+    QCOMPARE(tmpl.placeholders(), QStringList({QStringLiteral("to"), QStringLiteral("name")}));
+
+    for (const auto &name : {QStringLiteral("Bob"), QStringLiteral("Jürgen"), QString()}) {
+        const QString to = name + QStringLiteral(" <recipient@example.org>");
+        const QByteArray result = tmpl.instantiate({{QStringLiteral("to"), to}, {QStringLiteral("name"), name}});
+
+        auto expected = createMessage(to, name);
+        expected->assemble();
+        QCOMPARE(result, expected->encodedContent());
+        QCOMPARE(tmpl.instantiate({{QStringLiteral("to"), to}, {QStringLiteral("name"), name}}, true),
+                 expected->encodedContent(true));
+    }
+}
+
+void MessageTemplateTest::testSinglePart()
+{
+    // 7 bit US-ASCII text with placeholders is sent as quoted-printable UTF-8
+    Message::Ptr msg(new Message);
+    msg->from()->fromUnicodeString(QStringLiteral("news@example.org"), "utf-8");
+    msg->date()->from7BitString("Sun, 21 Mar 1993 23:56:48 -0800");
+    msg->contentType()->setMimeType("text/plain");
+    msg->setBody("Hello {{name}}, {{not a placeholder}} {{}}\n");
+    const MessageTemplate tmpl(msg);
+    QCOMPARE(tmpl.placeholders(), QStringList({QStringLiteral("name")}));
+
+    Message result;
+    result.setContent(tmpl.instantiate({{QStringLiteral("name"), QStringLiteral("Jürgen")}}));
+    result.parse();
+    QCOMPARE(result.contentType()->charset(), QByteArray("utf-8"));
+    QCOMPARE(result.contentTransferEncoding()->encoding(), Headers::CEquPr);
+    QCOMPARE(result.decodedText(), QStringLiteral("Hello Jürgen, {{not a placeholder}} {{}}\n"));
+
+    // the template message is not modified
+    QCOMPARE(msg->body(), QByteArray("Hello {{name}}, {{not a placeholder}} {{}}\n"));
+}
+
+void MessageTemplateTest::testAttachmentName()
+{
+    // the attachment keeps its body when only its head has placeholders
+    const MessageTemplate tmpl(createMessage(QStringLiteral("{{to}}"), QStringLiteral("{{name}}"), QStringLiteral("{{name}}.pdf")));
+    QCOMPARE(tmpl.placeholders(), QStringList({QStringLiteral("to"), QStringLiteral("name")}));
+
+    const QString to = QStringLiteral("Bob <bob@example.org>");
+    const QByteArray result = tmpl.instantiate({{QStringLiteral("to"), to}, {QStringLiteral("name"), QStringLiteral("Bob")}});
+    auto expected = createMessage(to, QStringLiteral("Bob"), QStringLiteral("Bob.pdf"));
+    expected->assemble();
+    QCOMPARE(result, expected->encodedContent());
+
+    Message parsed;
+    parsed.setContent(result);
+    parsed.parse();
+    QCOMPARE(parsed.contents().size(), 2);
+    QCOMPARE(parsed.contents().at(1)->contentType()->name(), QStringLiteral("Bob.pdf"));
+    QCOMPARE(parsed.contents().at(1)->decodedContent(), QByteArray(1 << 16, 'x'));
+}
+
+void MessageTemplateTest::benchmarkInstantiate()
+{
+    const MessageTemplate tmpl(createMessage(QStringLiteral("{{to}}"), QStringLiteral("{{name}}")));
+    const QHash<QString, QString> values = {{QStringLiteral("to"), QStringLiteral("Jürgen <j@example.org>")},
+                                            {QStringLiteral("name"), QStringLiteral("Jürgen")}};
+    QBENCHMARK {
+        const QByteArray result = tmpl.instantiate(values);
+        Q_UNUSED(result)
+    }
+}
+
+void MessageTemplateTest::benchmarkAssemble()
+{
+    QBENCHMARK {
+        auto msg = createMessage(QStringLiteral("Jürgen <j@example.org>"), QStringLiteral("Jürgen"));
+        msg->assemble();
+        const QByteArray result = msg->encodedContent();
+        Q_UNUSED(result)
+    }
+}
+
+QTEST_MAIN(MessageTemplateTest)
+
+#include "messagetemplatetest.moc"
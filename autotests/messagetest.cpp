@@ -311,7 +311,8 @@ void MessageTest::testUtf16()
         "From: foo@bar.com\n"
         "Subject: UTF-16 Test\n"
         "MIME-Version: 1.0\n"
-        "Content-Type: text/plain; charset=\"utf-16\"\n"
+        "Content-Type: Text/Plain;\n"
+        "  charset=\"utf-16\"\n"
         "Content-Transfer-Encoding: base64\n"
         "To: =?ISO-8859-1?Q?Fr=E4nz_T=F6ster?= <test@test.de>\n"
         "\n"
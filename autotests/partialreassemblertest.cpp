@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_partialreassembler.h"
+
+#include <QBuffer>
+#include <QObject>
+#include <QTest>
+
+using namespace KMime;
+
+static NewsArticle::Ptr makeArticle(const QByteArray &subject, const QByteArray &body)
+{
+    NewsArticle::Ptr article(new NewsArticle);
+    article->setContent("From: poster@example.net\n"
+                        "Newsgroups: alt.binaries.test\n"
+                        "Subject: " + subject + "\n"
+                        "\n" + body);
+    article->parse();
+    return article;
+}
+
+// the 300 bytes encoded in the test parts below
+static QByteArray joinedData()
+{
+    QByteArray data;
+    for (int i = 0; i < 300; ++i) {
+        data.append(static_cast<char>((i * 37 + 11) % 256));
+    }
+    return data;
+}
+
+static const QByteArray yencPart1 =
+        "=ybegin part=1 total=2 line=64 size=300 name=joined.bin\n"
+        "=ypart begin=1 end=150\n"
+        "5Z\177\244\311\356\0238]\202\247\314\361\026;`\205\252\317\364\031>c\210\255\322\367\034Af\213\260\325\372\037Di\216\263\330\375\"Gl\221\266\333=@%Jo\224\271\336\003(Mr\227\274\341\006+\n"
+        "Pu\232\277\344\011.Sx\235\302\347\0141V{\240\305\352\0174Y~\243\310\355\0227\\\201\246\313\360\025:_\204\251\316\363\030=}b\207\254\321\366\033@e\212\257\324\371\036Ch\215\262\327\374!F\n"
+        "k\220\265\332\377$In\223\270\335\002'Lq\226\273\340\005*Ot\231\276\n"
+        "=yend size=150 part=1 pcrc32=361dece0 crc32=32ec5e76\n";
+
+static const QByteArray yencPart2 =
+        "=ybegin part=2 total=2 line=64 size=300 name=joined.bin\n"
+        "=ypart begin=151 end=300\n"
+        "\343\010-Rw\234\301\346\0130Uz\237\304\351\0163X}\242\307\354\0216[\200\245\312\357\0249^\203\250\315\362\027<a\206\253\320\365\032\?d\211\256\323\370\035Bg\214\261\326\373 Ej\217\264\331\376\n"
+        "#Hm\222\267\334\001&Kp\225\272\337\004)Ns\230\275\342\007,Qv\233\300\345=J/Ty\236\303\350=M2W|\241\306\353\0205Z\177\244\311\356\0238]\202\247\314\361\026;`\205\252\317\364\n"
+        "\031>c\210\255\322\367\034Af\213\260\325\372\037Di\216\263\330\375\"Gl\n"
+        "=yend size=150 part=2 pcrc32=eb53359d crc32=32ec5e76\n";
+
+static const QByteArray uuPart1 =
+        "Here is the file.\n"
+        "\n"
+        "begin 644 joined.bin\n"
+        "M\"S!5>I_$Z0XS6'VBQ^P1-EN`I<KO%#E>@ZC-\\A<\\88:KT/4:/V2)KM/X'4)G\n"
+        "MC+'6^R!%:H^TV\?XC2&V2M]P!)DMPE;K\?!\"E.<YB]X@<L47:;P.4*+U1YGL/H\n"
+        "M#3)7\?*'&ZQ`U6G^DR>X3.%V\"I\\SQ%CM@A:K/]!D^8XBMTO<<06:+L-7Z'T1I\n"
+        "MCK/8_2)';)&VVP`E2F^4N=X#*$URE[SA!BM0=9J_Y`DN4WB=PN<,,59[H,7J\n";
+
+static const QByteArray uuPart2 =
+        "M#S19\?J/([1(W7(&FR_`5.E^$J<[S&#UBAZS1]AM`98JOU/D>0VB-LM\?\\(49K\n"
+        "MD+7:_R1);I.XW0(G3'&6N^`%*D]TF;[C\"\"U2=YS!Y@LP57J\?Q.D.,UA]HL\?L\n"
+        ">$39;@*7*[Q0Y7H.HS\?(7/&&&J]#U&C]DB:[3^!U\"\n"
+        "`\n"
+        "end\n";
+
+class PartialReassemblerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+
+    void testYencParts()
+    {
+        PartialReassembler reassembler;
+        // parts may arrive in any order
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (2/2)", yencPart2)));
+        QVERIFY(!reassembler.isComplete("joined.bin"));
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (1/2)", yencPart1)));
+
+        QCOMPARE(reassembler.files(), QVector<QByteArray>{"joined.bin"});
+        QCOMPARE(reassembler.partCount("joined.bin"), 2);
+        QCOMPARE(reassembler.receivedPartCount("joined.bin"), 2);
+        QVERIFY(reassembler.isComplete("joined.bin"));
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QCOMPARE(reassembler.writeTo("joined.bin", &buffer), PartialReassembler::Success);
+        QCOMPARE(buffer.data(), joinedData());
+    }
+
+    void testUuencodedParts()
+    {
+        PartialReassembler reassembler;
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (1/2)", uuPart1)));
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (2/2)", uuPart2)));
+
+        // uuencoded parts are grouped by their subject
+        QCOMPARE(reassembler.files(), QVector<QByteArray>{"joined.bin"});
+        QVERIFY(reassembler.isComplete("joined.bin"));
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QCOMPARE(reassembler.writeTo("joined.bin", &buffer), PartialReassembler::Success);
+        QCOMPARE(buffer.data(), joinedData());
+    }
+
+    void testIncomplete()
+    {
+        PartialReassembler reassembler;
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (1/2)", yencPart1)));
+        // adding the same part twice replaces it
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (1/2)", yencPart1)));
+        QCOMPARE(reassembler.receivedPartCount("joined.bin"), 1);
+        QVERIFY(!reassembler.isComplete("joined.bin"));
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QCOMPARE(reassembler.writeTo("joined.bin", &buffer), PartialReassembler::Incomplete);
+        QVERIFY(buffer.data().isEmpty());
+
+        reassembler.removeFile("joined.bin");
+        QVERIFY(reassembler.files().isEmpty());
+    }
+
+    void testCorruptPart()
+    {
+        QByteArray corrupted = yencPart2;
+        corrupted.replace("pcrc32=eb53359d", "pcrc32=eb53359e");
+
+        PartialReassembler reassembler;
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (1/2)", yencPart1)));
+        QVERIFY(reassembler.addPart(makeArticle("joined.bin (2/2)", corrupted)));
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QCOMPARE(reassembler.writeTo("joined.bin", &buffer), PartialReassembler::CorruptPart);
+    }
+
+    void testNoBinaryPart()
+    {
+        PartialReassembler reassembler;
+        QVERIFY(!reassembler.addPart(makeArticle("Question (1/2)", "Just some text.\n")));
+        QVERIFY(!reassembler.addPart(NewsArticle::Ptr()));
+        QVERIFY(reassembler.files().isEmpty());
+    }
+};
+
+QTEST_MAIN(PartialReassemblerTest)
+
+#include "partialreassemblertest.moc"
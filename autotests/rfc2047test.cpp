@@ -32,3 +32,71 @@ void RFC2047Test::testRFC2047encode()
     QCOMPARE(KCodecs::decodeRFC2047String(QString::fromUtf8(result)), input);
     QVERIFY(result.contains("utf-8"));
 }
+
+void RFC2047Test::testEncodedWords_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<QByteArray>("charset");
+    QTest::addColumn<QByteArray>("encoding");
+
+    QTest::newRow("latin1") << QString::fromUtf8("Ingo Klöcker") << QByteArray("ISO-8859-1") << QByteArray("Q");
+    QTest::newRow("mostly ascii") << QString::fromUtf8("Überweisungsbestätigung") << QByteArray("utf-8") << QByteArray("Q");
+    QTest::newRow("mostly non-ascii") << QString::fromUtf8("Grüße") << QByteArray("utf-8") << QByteArray("B");
+    QTest::newRow("cyrillic") << QString::fromUtf8("Привет из Москвы") << QByteArray("utf-8") << QByteArray("B");
+    QTest::newRow("long japanese") << QString::fromUtf8("【重要】来週の会議資料について（第2回）ご確認ください。よろしくお願いいたします。")
+                                   << QByteArray("utf-8") << QByteArray("B");
+    QTest::newRow("long latin1") << QString::fromUtf8("Ümläute überall: äöü ÄÖÜ äöü ÄÖÜ äöü ÄÖÜ äöü ÄÖÜ äöü ÄÖÜ äöü ÄÖÜ")
+                                 << QByteArray("ISO-8859-1") << QByteArray("Q");
+    QTest::newRow("shift_jis") << QString::fromUtf8("来週の会議資料について来週の会議資料について来週の会議資料について")
+                               << QByteArray("Shift_JIS") << QByteArray("B");
+}
+
+void RFC2047Test::testEncodedWords()
+{
+    QFETCH(QString, input);
+    QFETCH(QByteArray, charset);
+    QFETCH(QByteArray, encoding);
+
+    const QByteArray result = KMime::encodeRFC2047String(input, charset);
+    QCOMPARE(KCodecs::decodeRFC2047String(QString::fromLatin1(result)), input);
+
+    const QByteArray start = "=?" + charset + '?';
+    int words = 0;
+    for (const QByteArray &word : result.split(' ')) {
+        if (!word.startsWith(start)) {
+            continue;
+        }
+        ++words;
+        QVERIFY(word.size() <= 75);
+        QCOMPARE(word.mid(start.size(), 1), encoding);
+    }
+    QVERIFY(words > 0);
+    // the parts of long strings are decoded one by one by some readers
+    if (result.size() > 75) {
+        QVERIFY(words > 1);
+    }
+}
+
+void RFC2047Test::testEncodeMany()
+{
+    const QStringList names = {QStringLiteral("John Doe"), QString::fromUtf8("Jöhn Döe"), QString::fromUtf8("Grüße")};
+    const QVector<QByteArray> encoded = KMime::encodeRFC2047Strings(names, "utf-8", true);
+    QCOMPARE(encoded.size(), names.size());
+    for (int i = 0; i < names.size(); ++i) {
+        QCOMPARE(encoded.at(i), KMime::encodeRFC2047String(names.at(i), "utf-8", true));
+    }
+    QCOMPARE(encoded.at(0), QByteArray("John Doe"));
+}
+
+void RFC2047Test::benchmarkEncode()
+{
+    QStringList names;
+    for (int i = 0; i < 100; ++i) {
+        names.append(QString::fromUtf8("Jöhn Döe %1").arg(i));
+        names.append(QString::fromUtf8("山田太郎 %1").arg(i));
+    }
+    QBENCHMARK {
+        const QVector<QByteArray> encoded = KMime::encodeRFC2047Strings(names, "utf-8", true);
+        QCOMPARE(encoded.size(), names.size());
+    }
+}
@@ -13,6 +13,10 @@ class RFC2047Test : public QObject
     Q_OBJECT
 private Q_SLOTS:
     void testRFC2047encode();
+    void testEncodedWords_data();
+    void testEncodedWords();
+    void testEncodeMany();
+    void benchmarkEncode();
 };
 
 
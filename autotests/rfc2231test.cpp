@@ -9,6 +9,7 @@
 #include "rfc2231test.h"
 
 #include <kmime_util.h>
+#include <kmime_header_parsing.h>
 #include <kmime_codecs.cpp>
 #include <QDebug>
 using namespace KMime;
@@ -83,3 +84,75 @@ void RFC2231Test::testRFC2231encode()
     QCOMPARE(KMime::encodeRFC2231String(QString::fromUtf8("with accents Ã²Ã³Ã¨Ã©Ã¤Ã¯Ã±"), "utf-8").constData(),
              "utf-8''with%20accents%20%C3%83%C2%B2%C3%83%C2%B3%C3%83%C2%A8%C3%83%C2%A9%C3%83%C2%A4%C3%83%C2%AF%C3%83%C2%B1");
 }
+
+void RFC2231Test::testParameterList_data()
+{
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QByteArray>("charset");
+
+    QTest::newRow("plain") << QByteArray("name=\"Ingo Kloecker\"") << QStringLiteral("Ingo Kloecker") << QByteArray();
+    QTest::newRow("encoded") << QByteArray("name*=utf-8''Ingo%20Kl%C3%B6cker") << QString::fromUtf8("Ingo Klöcker")
+                             << QByteArray("utf-8");
+    QTest::newRow("language") << QByteArray("name*=iso-8859-1'de'Andr%E9s%20Ot%F3n") << QString::fromUtf8("Andrés Otón")
+                              << QByteArray("iso-8859-1");
+    QTest::newRow("continued") << QByteArray("name*0=\"Ingo \"; name*1=\"Kl\"; name*2=ocker") << QStringLiteral("Ingo Klocker")
+                               << QByteArray();
+    // a multibyte sequence split over two sections
+    QTest::newRow("continued encoded") << QByteArray("name*0*=utf-8''Ingo%20Kl%C3; name*1*=%B6cker; name*2=\".txt\"")
+                                       << QString::fromUtf8("Ingo Klöcker.txt") << QByteArray("utf-8");
+    QTest::newRow("out of order") << QByteArray("name*1*=%B6cker; name*0*=utf-8''Ingo%20Kl%C3") << QString::fromUtf8("Ingo Klöcker")
+                                  << QByteArray("utf-8");
+    QByteArray manySections;
+    QString manyName;
+    for (int i = 11; i >= 0; --i) {
+        manySections += "name*" + QByteArray::number(i) + "=" + QByteArray::number(i) + "; ";
+    }
+    for (int i = 0; i < 12; ++i) {
+        manyName += QString::number(i);
+    }
+    QTest::newRow("more than ten sections") << manySections << manyName << QByteArray();
+    QTest::newRow("continued wins") << QByteArray("name=a; name*0=b; name*1=c") << QStringLiteral("bc") << QByteArray();
+    QTest::newRow("similar names") << QByteArray("name*0=a; name*1=b; name2=c") << QStringLiteral("ab") << QByteArray();
+    QTest::newRow("rfc2047") << QByteArray("name=\"=?ISO-8859-1?Q?lor=E9m_ipsum=2Etxt?=\"") << QString::fromUtf8("lorém ipsum.txt")
+                             << QByteArray("iso-8859-1");
+    QTest::newRow("malformed escape") << QByteArray("name*=utf-8''100%25%2") << QStringLiteral("100%%2") << QByteArray("utf-8");
+    QTest::newRow("no charset") << QByteArray("name*=Ingo%20") << QStringLiteral("Ingo%20") << QByteArray();
+}
+
+void RFC2231Test::testParameterList()
+{
+    QFETCH(QByteArray, input);
+    QFETCH(QString, name);
+    QFETCH(QByteArray, charset);
+
+    const char *scursor = input.constData();
+    QMap<QString, QString> result;
+    QByteArray usedCharset;
+    QVERIFY(HeaderParsing::parseParameterListWithCharset(scursor, input.constData() + input.size(), result, usedCharset));
+    QCOMPARE(result.value(QStringLiteral("name")), name);
+    if (!charset.isEmpty()) {
+        QCOMPARE(usedCharset.toLower(), charset);
+    }
+}
+
+void RFC2231Test::benchmarkParameterList()
+{
+    // a long file name, split into sections like some clients do
+    QByteArray input = "attachment; filename*0*=utf-8''Ingo%20Kl%C3%B6cker";
+    for (int i = 1; i < 40; ++i) {
+        input += ";\n filename*" + QByteArray::number(i) + "*=%20Ingo%20Kl%C3%B6cker";
+    }
+    input += ";\n size=1234";
+    const char *const start = input.constData() + input.indexOf(';') + 1;
+    const char *const send = input.constData() + input.size();
+
+    QMap<QString, QString> result;
+    QBENCHMARK {
+        result.clear();
+        const char *scursor = start;
+        QByteArray charset;
+        QVERIFY(HeaderParsing::parseParameterListWithCharset(scursor, send, result, charset));
+    }
+    QCOMPARE(result.value(QStringLiteral("filename")).size(), 12 + 13 * 39);
+}
@@ -15,6 +15,9 @@ private Q_SLOTS:
     void testRFC2231decode();
     void testInvalidDecode();
     void testRFC2231encode();
+    void testParameterList_data();
+    void testParameterList();
+    void benchmarkParameterList();
 };
 
 
@@ -28,7 +28,7 @@ private Q_SLOTS:
         qDebug() << sizeof(Content);
         QVERIFY(sizeof(Content) <= 16);
         qDebug() << sizeof(ContentPrivate);
-        QVERIFY(sizeof(ContentPrivate) <= (sizeof(QByteArray) * 5 + sizeof(QVector<Content*>) * 2 + 32));
+        QVERIFY(sizeof(ContentPrivate) <= (sizeof(QByteArray) * 6 + sizeof(QVector<Content*>) * 2 + sizeof(void *) + 32));
         qDebug() << sizeof(Message);
         QCOMPARE(sizeof(Message), sizeof(Content));
     }
@@ -67,24 +67,24 @@ private Q_SLOTS:
 
     void testHeadersPrivate()
     {
-        VERIFYSIZE(BasePrivate, sizeof(QByteArray));
+        VERIFYSIZE(BasePrivate, sizeof(QByteArray) * 2 + sizeof(void *));
         VERIFYSIZE(UnstructuredPrivate, sizeof(BasePrivate) + sizeof(QString));
         VERIFYSIZE(StructuredPrivate, sizeof(BasePrivate));     // empty
         VERIFYSIZE(AddressPrivate, sizeof(StructuredPrivate));
-        VERIFYSIZE(MailboxListPrivate, sizeof(BasePrivate) + sizeof(QVector<Types::Mailbox>));
+        VERIFYSIZE(MailboxListPrivate, sizeof(BasePrivate) + sizeof(HeaderParsing::CompactMailboxList));
         VERIFYSIZE(SingleMailboxPrivate, sizeof(MailboxListPrivate));
-        VERIFYSIZE(AddressListPrivate, sizeof(BasePrivate) + sizeof(KMime::Types::AddressList));
-        VERIFYSIZE(IdentPrivate, sizeof(AddressListPrivate) + sizeof(KMime::Types::AddrSpecList) + sizeof(QByteArray));
+        VERIFYSIZE(AddressListPrivate, sizeof(BasePrivate) + sizeof(HeaderParsing::CompactMailboxList));
+        VERIFYSIZE(IdentPrivate, sizeof(AddressPrivate) + sizeof(KMime::Types::AddressList) + sizeof(KMime::Types::AddrSpecList) + sizeof(QByteArray));
         VERIFYSIZE(SingleIdentPrivate, sizeof(IdentPrivate));
         VERIFYSIZE(TokenPrivate, sizeof(StructuredPrivate) + sizeof(QByteArray));
         VERIFYSIZE(PhraseListPrivate, sizeof(StructuredPrivate) + sizeof(QStringList));
         VERIFYSIZE(DotAtomPrivate, sizeof(StructuredPrivate) + sizeof(QByteArray));
-        VERIFYSIZE(ParametrizedPrivate, sizeof(StructuredPrivate) + sizeof(QMap<QString, QString>));
+        VERIFYSIZE(ParametrizedPrivate, sizeof(StructuredPrivate) + sizeof(QVector<ParametrizedPrivate::Parameter>));
         VERIFYSIZE(ReturnPathPrivate, sizeof(AddressPrivate) + sizeof(Types::Mailbox));
         VERIFYSIZE(MailCopiesToPrivate, sizeof(AddressListPrivate) + 8);
         VERIFYSIZE(ContentTransferEncodingPrivate, sizeof(TokenPrivate) + 8);
         VERIFYSIZE(ContentIDPrivate, sizeof(SingleIdentPrivate));
-        VERIFYSIZE(ContentTypePrivate, sizeof(ParametrizedPrivate) + sizeof(QByteArray) + 8);
+        VERIFYSIZE(ContentTypePrivate, sizeof(ParametrizedPrivate) + sizeof(QByteArray) + 16);
         VERIFYSIZE(GenericPrivate, sizeof(UnstructuredPrivate) + 8);
         VERIFYSIZE(ControlPrivate, sizeof(StructuredPrivate) + 2*sizeof(QByteArray));
         VERIFYSIZE(DatePrivate, sizeof(StructuredPrivate) + 8);
@@ -0,0 +1,209 @@
+/*
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_message.h"
+#include "kmime_smtpwriter.h"
+
+#include <QBuffer>
+#include <QObject>
+#include <QTest>
+
+using namespace KMime;
+
+class SmtpWriterTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testData_data();
+    void testData();
+    void testBdat();
+    void testChunks();
+    void testAbort();
+    void testBodyType();
+    void testBinary_data();
+    void testBinary();
+};
+
+namespace
+{
+
+Message::Ptr createMessage(const QByteArray &body)
+{
+    Message::Ptr msg(new Message);
+    msg->from()->from7BitString("alice@example.org");
+    msg->date()->from7BitString("Sun, 21 Mar 1993 23:56:48 -0800");
+    msg->subject()->from7BitString("test");
+    msg->setBody(body);
+    msg->assemble();
+    return msg;
+}
+
+QByteArray writeAll(SmtpWriter::Mode mode, Content *content, int chunkSize = 16)
+{
+    QByteArray result;
+    bool lastSeen = false;
+    SmtpWriter writer(mode, chunkSize, [&](const QByteArray &chunk, bool last) {
+        if (lastSeen || (!last && chunk.size() != chunkSize) || chunk.size() > chunkSize) {
+            return false;
+        }
+        lastSeen = last;
+        result += chunk;
+        return true;
+    });
+    if (!writer.write(content) || !lastSeen) {
+        return QByteArray();
+    }
+    return result;
+}
+
+} // namespace
+
+void SmtpWriterTest::testData_data()
+{
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("plain") << QByteArray("line 1\nline 2\n") << QByteArray("line 1\r\nline 2\r\n.\r\n");
+    QTest::newRow("dots") << QByteArray(".\n..x\nx.\n.") << QByteArray("..\r\n...x\r\nx.\r\n..\r\n.\r\n");
+    QTest::newRow("no final line break") << QByteArray("text") << QByteArray("text\r\n.\r\n");
+    QTest::newRow("crlf") << QByteArray("line 1\r\n.line 2\r\n") << QByteArray("line 1\r\n..line 2\r\n.\r\n");
+}
+
+void SmtpWriterTest::testData()
+{
+    QFETCH(QByteArray, body);
+    QFETCH(QByteArray, expected);
+
+    auto msg = createMessage(body);
+    const QByteArray head = msg->head();
+    const QByteArray result = writeAll(SmtpWriter::Data, msg.data());
+    QCOMPARE(result, LFtoCRLF(head) + "\r\n" + expected);
+}
+
+void SmtpWriterTest::testBdat()
+{
+    auto msg = createMessage(".line 1\nline 2\n");
+    const QByteArray result = writeAll(SmtpWriter::Bdat, msg.data());
+    QCOMPARE(result, msg->encodedContent(true));
+    QVERIFY(result.endsWith("\r\n.line 1\r\nline 2\r\n"));
+}
+
+void SmtpWriterTest::testChunks()
+{
+    // a multipart message with a streamed body
+    Message::Ptr msg(new Message);
+    msg->from()->from7BitString("alice@example.org");
+    msg->contentType()->setMimeType("multipart/mixed");
+    msg->contentType()->setBoundary("boundary");
+    auto text = new Content;
+    text->contentType()->setMimeType("text/plain");
+    text->setBody(".\n");
+    msg->addContent(text);
+    auto attachment = new Content;
+    attachment->contentType()->setMimeType("application/octet-stream");
+    auto data = new QBuffer;
+    data->setData(QByteArray(100000, '\0'));
+    QVERIFY(data->open(QIODevice::ReadOnly));
+    QVERIFY(attachment->setBodySource(data));
+    msg->addContent(attachment);
+    msg->assemble();
+
+    const QByteArray expected = msg->encodedContent(true);
+    for (int chunkSize : {1, 7, 1000, 4096, 1 << 20}) {
+        QCOMPARE(writeAll(SmtpWriter::Bdat, msg.data(), chunkSize), expected);
+        QByteArray unstuffed = writeAll(SmtpWriter::Data, msg.data(), chunkSize);
+        QVERIFY(unstuffed.endsWith("\r\n.\r\n"));
+        unstuffed.chop(3);
+        unstuffed.replace("\n..", "\n.");
+        QCOMPARE(unstuffed, expected);
+    }
+}
+
+void SmtpWriterTest::testAbort()
+{
+    auto msg = createMessage(QByteArray(1000, 'x'));
+    int calls = 0;
+    SmtpWriter writer(SmtpWriter::Bdat, 100, [&calls](const QByteArray &, bool) {
+        return ++calls < 3;
+    });
+    QVERIFY(!writer.write(msg.data()));
+    QCOMPARE(calls, 3);
+}
+
+void SmtpWriterTest::testBodyType()
+{
+    Message msg;
+    msg.contentType()->setMimeType("multipart/mixed");
+    auto text = new Content;
+    text->contentType()->setMimeType("text/plain");
+    text->contentTransferEncoding()->setEncoding(Headers::CEquPr);
+    msg.addContent(text);
+    auto other = new Content;
+    other->contentType()->setMimeType("text/plain");
+    msg.addContent(other);
+    QCOMPARE(SmtpWriter::bodyType(&msg), SmtpWriter::SevenBit);
+
+    other->contentTransferEncoding()->setEncoding(Headers::CE8Bit);
+    QCOMPARE(SmtpWriter::bodyType(&msg), SmtpWriter::EightBitMime);
+
+    text->contentTransferEncoding()->setEncoding(Headers::CEbinary);
+    QCOMPARE(SmtpWriter::bodyType(&msg), SmtpWriter::BinaryMime);
+}
+
+void SmtpWriterTest::testBinary_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("line breaks") << QByteArray("\x01\n.\n\r\n\x80\xff\nend", 12);
+    // the CR must not be taken for the one of the following delimiter
+    QTest::newRow("trailing cr") << QByteArray("\x01\x80\xff\nend\r", 8);
+    QTest::newRow("trailing crlf") << QByteArray("\x01\x80\xff\nend\r\n", 9);
+}
+
+void SmtpWriterTest::testBinary()
+{
+    QFETCH(QByteArray, data);
+
+    Message::Ptr msg(new Message);
+    msg->from()->from7BitString("alice@example.org");
+    msg->contentType()->setMimeType("multipart/mixed");
+    msg->contentType()->setBoundary("boundary");
+    auto text = new Content;
+    text->contentType()->setMimeType("text/plain");
+    text->setBody("line 1\nline 2\n");
+    msg->addContent(text);
+    auto binary = new Content;
+    binary->contentType()->setMimeType("application/octet-stream");
+    binary->contentTransferEncoding()->setEncoding(Headers::CEbinary);
+    binary->setBody(data);
+    msg->addContent(binary);
+    msg->assemble();
+    QCOMPARE(SmtpWriter::bodyType(msg.data()), SmtpWriter::BinaryMime);
+
+    // everything but the binary body gets CRLF line breaks
+    const QByteArray encoded = msg->encodedContent();
+    const int pos = encoded.indexOf(data);
+    QVERIFY(pos > 0);
+    const QByteArray expected = LFtoCRLF(encoded.left(pos)) + data + LFtoCRLF(encoded.mid(pos + data.size()));
+    QVERIFY(expected.endsWith(data + "\r\n--boundary--\r\n"));
+    for (int chunkSize : {1, 5, 4096}) {
+        QCOMPARE(writeAll(SmtpWriter::Bdat, msg.data(), chunkSize), expected);
+        QCOMPARE(writeAll(SmtpWriter::Bdat, binary, chunkSize), LFtoCRLF(binary->head()) + "\r\n" + data);
+    }
+
+    // binary data cannot be sent with DATA
+    int calls = 0;
+    SmtpWriter writer(SmtpWriter::Data, 16, [&calls](const QByteArray &, bool) {
+        ++calls;
+        return true;
+    });
+    QVERIFY(!writer.write(msg.data()));
+    QCOMPARE(calls, 0);
+}
+
+QTEST_MAIN(SmtpWriterTest)
+
+#include "smtpwritertest.moc"
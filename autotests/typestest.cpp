@@ -48,6 +48,50 @@ private Q_SLOTS:
         mboxes.push_back(mbox);
         QCOMPARE(Types::Mailbox::listToUnicodeString(mboxes), QStringLiteral("name@example.local, First Last <name@example.local>"));
     }
+
+    void testIdnCache()
+    {
+        Types::AddrSpec addrSpec;
+        addrSpec.localPart = QStringLiteral("user");
+        addrSpec.domain = QStringLiteral("xn--bcher-kva.example");
+
+        auto before = Types::idnCacheStatistics();
+        QCOMPARE(addrSpec.asPrettyString(), QString::fromUtf8("user@b\xc3\xbc" "cher.example"));
+        auto after = Types::idnCacheStatistics();
+        QCOMPARE(after.misses, before.misses + 1);
+        QCOMPARE(after.hits, before.hits);
+        QCOMPARE(addrSpec.asPrettyString(), QString::fromUtf8("user@b\xc3\xbc" "cher.example"));
+        QCOMPARE(Types::idnCacheStatistics().hits, after.hits + 1);
+
+        // domains without IDN are not looked up
+        before = Types::idnCacheStatistics();
+        Types::Mailbox mbox;
+        mbox.setAddress("name@example.local");
+        QCOMPARE(mbox.as7BitString("utf-8"), QByteArray("name@example.local"));
+        QCOMPARE(mbox.addrSpec().asPrettyString(), QStringLiteral("name@example.local"));
+        after = Types::idnCacheStatistics();
+        QCOMPARE(after.hits, before.hits);
+        QCOMPARE(after.misses, before.misses);
+
+        // non-ASCII domains are encoded for sending
+        addrSpec.domain = QString::fromUtf8("b\xc3\xbc" "cher.example");
+        mbox.setAddress(addrSpec);
+        mbox.setName(QStringLiteral("Name"));
+        QCOMPARE(mbox.as7BitString("utf-8"), QByteArray("Name <user@xn--bcher-kva.example>"));
+        QCOMPARE(Types::idnCacheStatistics().misses, after.misses + 1);
+
+        // the least recently used domains are dropped
+        addrSpec.domain = QStringLiteral("xn--bcher-kva.example");
+        for (int i = 0; i < 1000; ++i) {
+            Types::AddrSpec other;
+            other.localPart = QStringLiteral("user");
+            other.domain = QStringLiteral("xn--bcher-kva.example%1").arg(i);
+            (void)other.asPrettyString();
+        }
+        before = Types::idnCacheStatistics();
+        QCOMPARE(addrSpec.asPrettyString(), QString::fromUtf8("user@b\xc3\xbc" "cher.example"));
+        QCOMPARE(Types::idnCacheStatistics().misses, before.misses + 1);
+    }
 };
 
 QTEST_MAIN(TypesTest)
@@ -149,6 +149,56 @@ void UtilTest::testExtractHeader()
     QCOMPARE(extractHeader("From:<toma@kovoks.nl>", "From"), QByteArray("<toma@kovoks.nl>"));
 }
 
+void UtilTest::testExtractHeaders()
+{
+    const QByteArray header("To: <foo@bla.org>\n"
+                            "Subject: =?UTF-8?Q?_Notification_for_appointment:?=\n"
+                            " =?UTF-8?Q?_Test?=\n"
+                            "Continuation: =?UTF-8?Q?_TEST\n"
+                            "=20CONT1?= =?UTF-8?Q?_TEST\n"
+                            "=09CONT2?=\n"
+                            "X-To: <bar@bla.org>\n"
+                            "to: <second@bla.org>\n"
+                            "Empty:\n"
+                            "MIME-Version: 1.0");
+
+    const QVector<QByteArray> names = {"mime-version", "Foo", "Subject", "To", "Continuation", "Empty", "TO"};
+    const QVector<QByteArray> values = extractHeaders(header, names);
+    QCOMPARE(values.size(), names.size());
+    for (int i = 0; i < names.size(); ++i) {
+        QCOMPARE(values.at(i), extractHeader(header, names.at(i)));
+    }
+    QCOMPARE(values.at(0), QByteArray("1.0"));
+    QVERIFY(values.at(1).isNull());
+    QCOMPARE(values.at(3), QByteArray("<foo@bla.org>"));
+    QCOMPARE(values.at(6), QByteArray("<foo@bla.org>"));
+    QVERIFY(values.at(5).isEmpty());
+
+    QVERIFY(extractHeaders(QByteArray(), names).at(0).isNull());
+    QVERIFY(extractHeaders(header, {}).isEmpty());
+}
+
+void UtilTest::testExtractHeaders_performance()
+{
+    QByteArray header;
+    for (int i = 0; i < 200; ++i) {
+        header += "Received: from host" + QByteArray::number(i) + ".example.org by mx.example.org;\n"
+                  " Fri, 21 Nov 1997 09:55:06 -0600\n";
+    }
+    header += "From: someone@example.org\n"
+              "To: someone.else@example.org\n"
+              "Subject: test\n"
+              "Date: Fri, 21 Nov 1997 09:55:06 -0600\n"
+              "Message-ID: <1234@local.machine.example>\n";
+
+    const QVector<QByteArray> names = {"From", "To", "Subject", "Date", "Message-ID"};
+    QVector<QByteArray> values;
+    QBENCHMARK {
+        values = extractHeaders(header, names);
+    }
+    QCOMPARE(values.at(2), QByteArray("test"));
+}
+
 void UtilTest::testBalanceBidiState()
 {
     QFETCH(QString, input);
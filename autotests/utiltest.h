@@ -15,6 +15,8 @@ private Q_SLOTS:
     void testUnfoldHeader();
     void testFoldHeader();
     void testExtractHeader();
+    void testExtractHeaders();
+    void testExtractHeaders_performance();
     void testBalanceBidiState();
     void testBalanceBidiState_data();
     void testAddQuotes();
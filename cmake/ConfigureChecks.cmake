@@ -32,9 +32,3 @@ check_cxx_source_compiles("
 int main() { struct tm tm; tm.tm_gmtoff=1; return 0; }
 "
   HAVE_TM_GMTOFF)
-
-check_cxx_source_compiles("
-#include <string.h>
-int main() { strcasestr(\"\", \"\"); }
-"
-    HAVE_STRCASESTR)
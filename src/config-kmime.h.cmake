@@ -2,6 +2,3 @@
 
 /* Define if you have a tm_gmtoff member in struct tm */
 #cmakedefine01 HAVE_TM_GMTOFF
-
-/* Define if you have strcasestr in string.h */
-#cmakedefine01 HAVE_STRCASESTR
@@ -66,6 +66,18 @@ CharFreq::CharFreq(const char *buf, size_t len)
     }
 }
 
+CharFreq::CharFreq()
+    : CharFreq(nullptr, 0)
+{
+}
+
+void CharFreq::add(const char *buf, size_t len)
+{
+    if (buf && len > 0) {
+        count(buf, len);
+    }
+}
+
 //@cond PRIVATE
 static inline bool isWS(char ch)
 {
@@ -142,7 +154,7 @@ void CharFreq::count(const char *it, size_t len)
         mTrailingWS = true;
     }
 
-    mTotal = len;
+    mTotal += len;
 }
 
 bool CharFreq::isEightBitData() const
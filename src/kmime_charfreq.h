@@ -81,6 +81,23 @@ public:
     */
     CharFreq(const char *buf, size_t len);
 
+    /**
+      Constructs a Character Frequency instance without any data, to be
+      passed in with add().
+      @since 5.23
+    */
+    CharFreq();
+
+    /**
+      Adds the next @p len chars of the data at @p buf to the counts, so
+      that large data can be read and counted in chunks. The data must be
+      split at line boundaries, i.e. every chunk except the last one has
+      to end with LF; otherwise lines crossing chunks are counted as two
+      lines.
+      @since 5.23
+    */
+    void add(const char *buf, size_t len);
+
     /**
       The different types of data.
     */
@@ -0,0 +1,206 @@
+/*
+    kmime_charsetconversion.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_charsetconversion_p.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QTextCodec>
+#include <QVector>
+
+#include <cstring>
+
+using namespace KMime;
+
+namespace
+{
+
+// How the text of a QTextCodec is converted.
+struct Decoder {
+    enum Kind {
+        Codec, ///< by the QTextCodec
+        Utf8, ///< by decodeUtf8()
+        Latin1, ///< by QString::fromLatin1()
+        Table ///< by looking up every byte in table
+    };
+    Kind kind = Codec;
+    QVector<ushort> table;
+};
+
+// The MIBs of the single-byte charsets: US-ASCII, ISO-8859-1 to -16,
+// KOI8-R, KOI8-U and windows-1250 to -1258.
+bool isSingleByteMib(int mib)
+{
+    return (mib >= 3 && mib <= 13) || (mib >= 109 && mib <= 112) || mib == 2084 || mib == 2088 || (mib >= 2250 && mib <= 2258);
+}
+
+Decoder makeDecoder(const QTextCodec *codec)
+{
+    Decoder decoder;
+    const int mib = codec->mibEnum();
+    if (mib == 106) {
+        decoder.kind = Decoder::Utf8;
+        return decoder;
+    }
+    if (!isSingleByteMib(mib)) {
+        return decoder;
+    }
+
+    // ask the codec for every character once
+    QVector<ushort> table(256);
+    bool isLatin1 = true;
+    for (int i = 0; i < 256; ++i) {
+        const char c = char(i);
+        const QString s = codec->toUnicode(&c, 1);
+        if (s.size() != 1) {
+            return decoder;
+        }
+        table[i] = s.at(0).unicode();
+        isLatin1 = isLatin1 && table[i] == i;
+    }
+    if (isLatin1) {
+        decoder.kind = Decoder::Latin1;
+    } else {
+        decoder.kind = Decoder::Table;
+        decoder.table = table;
+    }
+    return decoder;
+}
+
+// The decoder for @p codec; valid until the next call in this thread.
+const Decoder &decoderFor(const QTextCodec *codec)
+{
+    thread_local const QTextCodec *lastCodec = nullptr;
+    thread_local Decoder lastDecoder;
+    if (codec != lastCodec) {
+        static QMutex mutex;
+        static QHash<const QTextCodec *, Decoder> decoders;
+        QMutexLocker locker(&mutex);
+        auto it = decoders.find(codec);
+        if (it == decoders.end()) {
+            it = decoders.insert(codec, makeDecoder(codec));
+        }
+        lastDecoder = it.value();
+        lastCodec = codec;
+    }
+    return lastDecoder;
+}
+
+const quint64 highBits = 0x8080808080808080ULL;
+
+// Converts valid UTF-8. Returns false for everything QTextCodec may
+// convert differently: invalid or incomplete sequences, overlong forms,
+// surrogates, noncharacters and a byte order mark at the start.
+bool decodeUtf8(const char *data, int size, QString &result)
+{
+    auto p = reinterpret_cast<const uchar *>(data);
+    const uchar *const end = p + size;
+    if (size >= 3 && p[0] == 0xef && p[1] == 0xbb && p[2] == 0xbf) {
+        return false;
+    }
+
+    // never more UTF-16 code units than bytes
+    result.resize(size);
+    auto out = reinterpret_cast<ushort *>(result.data());
+    while (p < end) {
+        // ASCII, eight bytes at a time
+        if (end - p >= 8) {
+            quint64 x;
+            memcpy(&x, p, 8);
+            if ((x & highBits) == 0) {
+                for (int i = 0; i < 8; ++i) {
+                    out[i] = p[i];
+                }
+                p += 8;
+                out += 8;
+                continue;
+            }
+        }
+        const uint c = *p;
+        if (c < 0x80) {
+            *out++ = c;
+            ++p;
+            continue;
+        }
+
+        int continuations;
+        uint uc;
+        if (c >= 0xc2 && c <= 0xdf) {
+            continuations = 1;
+            uc = c & 0x1f;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            continuations = 2;
+            uc = c & 0x0f;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            continuations = 3;
+            uc = c & 0x07;
+        } else {
+            return false;
+        }
+        if (end - p <= continuations) {
+            return false;
+        }
+        for (int i = 1; i <= continuations; ++i) {
+            if ((p[i] & 0xc0) != 0x80) {
+                return false;
+            }
+            uc = uc << 6 | (p[i] & 0x3f);
+        }
+        if ((continuations == 2 && (uc < 0x800 || (uc >= 0xd800 && uc <= 0xdfff)))
+            || (continuations == 3 && (uc < 0x10000 || uc > 0x10ffff))
+            || (uc >= 0xfdd0 && uc <= 0xfdef) || (uc & 0xfffe) == 0xfffe) {
+            return false;
+        }
+        p += continuations + 1;
+
+        if (QChar::requiresSurrogates(uc)) {
+            *out++ = QChar::highSurrogate(uc);
+            *out++ = QChar::lowSurrogate(uc);
+        } else {
+            *out++ = uc;
+        }
+    }
+    result.truncate(out - reinterpret_cast<ushort *>(result.data()));
+    return true;
+}
+
+QString decodeTable(const QVector<ushort> &table, const char *data, int size)
+{
+    QString result(size, Qt::Uninitialized);
+    auto out = reinterpret_cast<ushort *>(result.data());
+    const ushort *const t = table.constData();
+    for (int i = 0; i < size; ++i) {
+        out[i] = t[uchar(data[i])];
+    }
+    return result;
+}
+
+} // namespace
+
+QString CharsetConversion::toUnicode(const QTextCodec *codec, const char *data, int size)
+{
+    const Decoder &decoder = decoderFor(codec);
+    switch (decoder.kind) {
+    case Decoder::Utf8: {
+        QString result;
+        if (decodeUtf8(data, size, result)) {
+            return result;
+        }
+        break;
+    }
+    case Decoder::Latin1:
+        return QString::fromLatin1(data, size);
+    case Decoder::Table:
+        return decodeTable(decoder.table, data, size);
+    case Decoder::Codec:
+        break;
+    }
+    return codec->toUnicode(data, size);
+}
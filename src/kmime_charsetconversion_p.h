@@ -0,0 +1,50 @@
+/*
+    kmime_charsetconversion_p.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+// @cond PRIVATE
+
+#include <QByteArray>
+#include <QString>
+
+class QTextCodec;
+
+/* Internal helper functions. Not part of the public API. */
+
+namespace KMime
+{
+
+namespace CharsetConversion
+{
+
+/**
+  Returns the @p size bytes at @p data converted to Unicode, the same as
+  codec->toUnicode(data, size).
+
+  UTF-8 and single-byte charsets like ISO-8859-x, windows-125x and KOI8
+  are converted without calling @p codec: UTF-8 by KMime's own decoder,
+  the others with a table of all 256 characters that is built from
+  @p codec once. Input the UTF-8 decoder cannot handle exactly like
+  QTextCodec, e.g. invalid sequences or a byte order mark, and all other
+  charsets are passed to @p codec.
+*/
+QString toUnicode(const QTextCodec *codec, const char *data, int size);
+
+inline QString toUnicode(const QTextCodec *codec, const QByteArray &data)
+{
+    return toUnicode(codec, data.constData(), data.size());
+}
+
+} // namespace CharsetConversion
+
+} // namespace KMime
+
+// @endcond
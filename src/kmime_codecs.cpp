@@ -12,135 +12,249 @@
 #include "kmime_debug.h"
 #include <KCharsets>
 
+#include <QStringList>
+#include <QStringView>
 #include <QTextCodec>
+#include <QVector>
+
+#include <algorithm>
+#include <array>
 
 namespace KMime {
 
 static const char reservedCharacters[] = "\"()<>@,.;:\\[]=";
 
-QByteArray encodeRFC2047String(const QString &src, const QByteArray &charset,
-                               bool addressHeader, bool allow8BitHeaders)
+namespace {
+
+// Classification of characters for RFC 2047 encoding.
+enum CharClass : quint8 {
+    QLiteral = 1, // copied as it is into Q encoded-words
+    NeedsEncoding = 2, // 8 bit characters and the escape character, for japanese encodings
+    Reserved = 4, // special in address headers
+};
+
+const std::array<quint8, 256> &charClasses()
 {
-    QByteArray result;
-    int start = 0;
-    int end = 0;
-    bool nonAscii = false;
-    bool ok = true;
-    bool useQEncoding = false;
+    static const auto classes = [] {
+        std::array<quint8, 256> c{};
+        for (int i = 0; i < 256; ++i) {
+            // paranoid mode, encode *all* special chars to avoid problems
+            // with "From" & "To" headers
+            if ((i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || (i >= '0' && i <= '9')) {
+                c[i] |= QLiteral;
+            }
+            if (i >= 128 || i == '\033') {
+                c[i] |= NeedsEncoding;
+            }
+        }
+        for (const char *r = reservedCharacters; *r; ++r) {
+            c[uchar(*r)] |= Reserved;
+        }
+        return c;
+    }();
+    return classes;
+}
 
-    // fromLatin1() is safe here, codecForName() uses toLatin1() internally
-    const QTextCodec *codec = KCharsets::charsets()->codecForName(QString::fromLatin1(charset), ok);
+struct Rfc2047Codec {
+    const QTextCodec *codec = nullptr;
+    QByteArray charset;
+};
 
-    QByteArray usedCS;
+Rfc2047Codec rfc2047Codec(const QByteArray &charset)
+{
+    Rfc2047Codec result;
+    bool ok = true;
+    // fromLatin1() is safe here, codecForName() uses toLatin1() internally
+    result.codec = KCharsets::charsets()->codecForName(QString::fromLatin1(charset), ok);
     if (!ok) {
         //no codec available => try local8Bit and hope the best ;-)
-        usedCS = QTextCodec::codecForLocale()->name();
-        codec = KCharsets::charsets()->codecForName(QString::fromLatin1(usedCS), ok);
+        result.charset = QTextCodec::codecForLocale()->name();
+        result.codec = KCharsets::charsets()->codecForName(QString::fromLatin1(result.charset), ok);
     } else {
-        Q_ASSERT(codec);
+        Q_ASSERT(result.codec);
         if (charset.isEmpty()) {
-            usedCS = codec->name();
+            result.charset = result.codec->name();
         } else {
-            usedCS = charset;
+            result.charset = charset;
         }
     }
+    return result;
+}
 
+// Converts @p src, falling back to UTF-8 if the codec cannot encode it.
+QByteArray fromUnicode(const QChar *src, int length, Rfc2047Codec &codec)
+{
     QTextCodec::ConverterState converterState(QTextCodec::IgnoreHeader);
-    QByteArray encoded8Bit = codec->fromUnicode(src.constData(), src.length(), &converterState);
-    if (converterState.invalidChars > 0) {
-        usedCS = "utf-8";
-        codec = QTextCodec::codecForName(usedCS);
-        encoded8Bit = codec->fromUnicode(src);
-    }
-
-    if (usedCS.contains("8859-")) {     // use "B"-Encoding for non iso-8859-x charsets
-        useQEncoding = true;
-    }
-
-    if (allow8BitHeaders) {
-        return encoded8Bit;
+    const QByteArray encoded = codec.codec->fromUnicode(src, length, &converterState);
+    if (converterState.invalidChars == 0) {
+        return encoded;
     }
+    codec.charset = "utf-8";
+    codec.codec = QTextCodec::codecForName(codec.charset);
+    return codec.codec->fromUnicode(src, length);
+}
 
-    int encoded8BitLength = encoded8Bit.length();
-    for (int i = 0; i < encoded8BitLength; i++) {
-        if (encoded8Bit[i] == ' ') {   // encoding starts at word boundaries
-            start = i + 1;
+// Returns for each byte of @p encoded, the conversion of @p src, whether a
+// character starts there, i.e. an encoded-word may end before it. Only the
+// start and the end are returned if they are not known.
+QVector<bool> characterStarts(const QChar *src, int length, const QByteArray &encoded, const QTextCodec *codec)
+{
+    QVector<bool> starts(encoded.size() + 1, false);
+    starts[0] = starts[encoded.size()] = true;
+    if (codec->mibEnum() == 106) { // UTF-8
+        for (int i = 1; i < encoded.size(); ++i) {
+            starts[i] = (uchar(encoded[i]) & 0xC0) != 0x80;
         }
-
-        // encode escape character, for japanese encodings...
-        if (((signed char)encoded8Bit[i] < 0) || (encoded8Bit[i] == '\033') ||
-                (addressHeader && (strchr("\"()<>@,.;:\\[]=", encoded8Bit[i]) != nullptr))) {
-            end = start;   // non us-ascii char found, now we determine where to stop encoding
-            nonAscii = true;
-            break;
+    } else if (encoded.size() == length) { // single byte charsets
+        starts.fill(true);
+    } else {
+        // convert the characters one by one, stateful encodings like
+        // iso-2022-jp do not add up and are not split
+        int pos = 0;
+        for (int i = 0; i < length && pos <= encoded.size(); ++i) {
+            const int n = src[i].isHighSurrogate() && i + 1 < length ? 2 : 1;
+            QTextCodec::ConverterState converterState(QTextCodec::IgnoreHeader);
+            pos += codec->fromUnicode(src + i, n, &converterState).size();
+            i += n - 1;
+            if (pos < encoded.size()) {
+                starts[pos] = true;
+            }
         }
-    }
-
-    if (nonAscii) {
-        while ((end < encoded8Bit.length()) && (encoded8Bit[end] != ' ')) {
-            // we encode complete words
-            end++;
+        if (pos != encoded.size()) {
+            starts.fill(false);
+            starts[0] = starts[encoded.size()] = true;
         }
+    }
+    return starts;
+}
 
-        for (int x = end; x < encoded8Bit.length(); x++) {
-            if (((signed char)encoded8Bit[x] < 0) || (encoded8Bit[x] == '\033') ||
-                    (addressHeader && (strchr(reservedCharacters, encoded8Bit[x]) != nullptr))) {
-                end = x;     // we found another non-ascii word
+// Appends @p encoded as encoded-words of at most 75 characters, each split
+// at a character boundary and Q or B encoded, whichever is shorter.
+void appendEncodedWords(QByteArray &result, const QByteArray &encoded, const QVector<bool> &starts, const QByteArray &charset)
+{
+    static const char hexChars[] = "0123456789ABCDEF";
+    const auto &classes = charClasses();
+    // use "B"-Encoding for non iso-8859-x charsets only
+    const bool forceQ = charset.contains("8859-");
+    const int budget = std::max(75 - int(charset.size()) - 7, 4);
 
-                while ((end < encoded8Bit.length()) && (encoded8Bit[end] != ' ')) {
-                    // we encode complete words
-                    end++;
-                }
+    int pos = 0;
+    while (pos < encoded.size()) {
+        int wordEnd = pos;
+        int wordQLength = 0;
+        int qLength = 0;
+        for (int i = pos; i < encoded.size();) {
+            const uchar c = encoded[i++];
+            qLength += ((classes[c] & QLiteral) || c == ' ') ? 1 : 3;
+            if (!starts[i]) {
+                continue;
+            }
+            const int bLength = (i - pos + 2) / 3 * 4;
+            const bool fits = qLength <= budget || (!forceQ && bLength <= budget);
+            if (!fits && wordEnd > pos) {
+                break;
+            }
+            wordEnd = i;
+            wordQLength = qLength;
+            if (!fits) {
+                break; // a single character longer than an encoded-word
             }
         }
 
-        result = encoded8Bit.left(start) + "=?" + usedCS;
-
+        const int length = wordEnd - pos;
+        const bool useQEncoding = forceQ || wordQLength <= (length + 2) / 3 * 4;
+        if (pos > 0) {
+            result += ' ';
+        }
+        result += "=?";
+        result += charset;
         if (useQEncoding) {
             result += "?Q?";
-
-            char c;
-            char hexcode; // "Q"-encoding implementation described in RFC 2047
-            for (int i = start; i < end; i++) {
-                c = encoded8Bit[i];
-                if (c == ' ') {   // make the result readable with not MIME-capable readers
+            for (int i = pos; i < wordEnd; ++i) {
+                const uchar c = encoded[i];
+                if (c == ' ') { // make the result readable with not MIME-capable readers
                     result += '_';
+                } else if (classes[c] & QLiteral) {
+                    result += char(c);
                 } else {
-                    if (((c >= 'a') && (c <= 'z')) ||        // paranoid mode, encode *all* special chars to avoid problems
-                            ((c >= 'A') && (c <= 'Z')) ||        // with "From" & "To" headers
-                            ((c >= '0') && (c <= '9'))) {
-                        result += c;
-                    } else {
-                        result += '=';                 // "stolen" from KMail ;-)
-                        hexcode = ((c & 0xF0) >> 4) + 48;
-                        if (hexcode >= 58) {
-                            hexcode += 7;
-                        }
-                        result += hexcode;
-                        hexcode = (c & 0x0F) + 48;
-                        if (hexcode >= 58) {
-                            hexcode += 7;
-                        }
-                        result += hexcode;
-                    }
+                    const char hex[] = {'=', hexChars[c >> 4], hexChars[c & 0x0F]};
+                    result.append(hex, 3);
                 }
             }
         } else {
-            result += "?B?" + encoded8Bit.mid(start, end - start).toBase64();
+            result += "?B?";
+            result += QByteArray::fromRawData(encoded.constData() + pos, length).toBase64();
         }
-
         result += "?=";
-        result += encoded8Bit.right(encoded8Bit.length() - end);
-    } else {
-        result = encoded8Bit;
+        pos = wordEnd;
+    }
+}
+
+QByteArray encodeRFC2047String(const QString &src, Rfc2047Codec codec, bool addressHeader, bool allow8BitHeaders)
+{
+    const QChar *data = src.constData();
+    const int length = src.length();
+    if (allow8BitHeaders) {
+        return fromUnicode(data, length, codec);
+    }
+
+    // encoding starts and ends at word boundaries: find the first and the
+    // last character that needs it
+    const auto &classes = charClasses();
+    const quint8 mask = addressHeader ? (NeedsEncoding | Reserved) : NeedsEncoding;
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < length; ++i) {
+        const ushort c = data[i].unicode();
+        if (c >= 256 || (classes[c] & mask)) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    if (first < 0) {
+        return fromUnicode(data, length, codec);
+    }
+    const int start = src.lastIndexOf(QLatin1Char(' '), first) + 1;
+    int end = src.indexOf(QLatin1Char(' '), last);
+    if (end < 0) {
+        end = length;
     }
 
+    const QByteArray encoded = fromUnicode(data + start, end - start, codec);
+    QByteArray result;
+    result.reserve(start + encoded.size() * 3 + length - end + 16);
+    result += QStringView(data, start).toLatin1();
+    appendEncodedWords(result, encoded, characterStarts(data + start, end - start, encoded, codec.codec), codec.charset);
+    result += QStringView(data + end, length - end).toLatin1();
+    return result;
+}
+
+} // namespace
+
+QByteArray encodeRFC2047String(const QString &src, const QByteArray &charset,
+                               bool addressHeader, bool allow8BitHeaders)
+{
+    return encodeRFC2047String(src, rfc2047Codec(charset), addressHeader, allow8BitHeaders);
+}
+
+QVector<QByteArray> encodeRFC2047Strings(const QStringList &src, const QByteArray &charset,
+                                         bool addressHeader, bool allow8BitHeaders)
+{
+    const Rfc2047Codec codec = rfc2047Codec(charset);
+    QVector<QByteArray> result;
+    result.reserve(src.size());
+    for (const QString &s : src) {
+        result.append(encodeRFC2047String(s, codec, addressHeader, allow8BitHeaders));
+    }
     return result;
 }
 
 QByteArray encodeRFC2047Sentence(const QString &src, const QByteArray &charset)
 {
     QByteArray result;
+    const Rfc2047Codec codec = rfc2047Codec(charset);
     const QChar *ch = src.constData();
     const int length = src.length();
     int pos = 0;
@@ -157,7 +271,7 @@ QByteArray encodeRFC2047Sentence(const QString &src, const QByteArray &charset)
             const int wordSize = pos - wordStart;
             if (wordSize > 0) {
                 const QString word = src.mid(wordStart, wordSize);
-                result += encodeRFC2047String(word, charset);
+                result += encodeRFC2047String(word, codec, false, false);
             }
 
             result += ch->toLatin1();
@@ -171,7 +285,7 @@ QByteArray encodeRFC2047Sentence(const QString &src, const QByteArray &charset)
     const int wordSize = pos - wordStart;
     if (wordSize > 0) {
         const QString word = src.mid(wordStart, pos - wordStart);
-        result += encodeRFC2047String(word, charset);
+        result += encodeRFC2047String(word, codec, false, false);
     }
 
     return result;
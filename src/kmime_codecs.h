@@ -11,6 +11,8 @@
 
 #include <QByteArray>
 #include <QString>
+#include <QStringList>
+#include <QVector>
 
 namespace KMime
 {
@@ -24,6 +26,10 @@ namespace KMime
   Therefore don't use this function for input strings that contain semantically meaningful characters,
   like the quoting marks in this example.
 
+  Text that is too long for one encoded word is split into several encoded words of at most
+  75 characters, at character boundaries. Each of them uses the Q or the B encoding, whichever
+  is shorter; iso-8859-x charsets always use the Q encoding.
+
   @param src           source string.
   @param charset       charset to use. If it can't encode the string, UTF-8 will be used instead.
   @param addressHeader if this flag is true, all special chars
@@ -34,6 +40,15 @@ namespace KMime
 */
 Q_REQUIRED_RESULT QByteArray encodeRFC2047String(const QString &src, const QByteArray &charset, bool addressHeader = false, bool allow8bitHeaders = false);
 
+/**
+  Encodes each string of @p src like encodeRFC2047String(), e.g. the display
+  names of many recipients, but looks up the codec for @p charset only once.
+
+  @return the encoded strings, in the same order as @p src.
+  @since 5.23
+*/
+Q_REQUIRED_RESULT QVector<QByteArray> encodeRFC2047Strings(const QStringList &src, const QByteArray &charset, bool addressHeader = false, bool allow8bitHeaders = false);
+
 /**
  * Same as encodeRFC2047String(), but with a crucial difference: Instead of encoding the complete
  * string as a single encoded word, the string will be split up at control characters, and only parts of
@@ -22,18 +22,30 @@
 */
 #include "kmime_content.h"
 #include "kmime_content_p.h"
+#include "kmime_charfreq.h"
+#include "kmime_charsetconversion_p.h"
 #include "kmime_message.h"
+#include "kmime_newsarticle.h"
 #include "kmime_header_parsing.h"
 #include "kmime_header_parsing_p.h"
+#include "kmime_headers_p.h"
 #include "kmime_parsers.h"
+#include "kmime_transferencoding_p.h"
 #include "kmime_util_p.h"
+#include "kmime_debug.h"
 
 #include <KCharsets>
 #include <KCodecs>
 
 
+#include <QAtomicInteger>
+#include <QBuffer>
+#include <QFile>
 #include <QTextCodec>
 
+#include <algorithm>
+#include <memory>
+
 using namespace KMime;
 
 namespace KMime
@@ -56,13 +68,45 @@ Content::~Content()
 
 bool Content::hasContent() const
 {
-    return !d_ptr->head.isEmpty() || !d_ptr->body.isEmpty() || !d_ptr->contents().isEmpty();
+    return !d_ptr->head.isEmpty() || !d_ptr->body.isEmpty() || d_ptr->bodySource || !d_ptr->contents().isEmpty();
 }
 
 void Content::setContent(const QByteArray &s)
 {
     Q_D(Content);
     KMime::HeaderParsing::extractHeaderAndBody(s, d->head, d->body);
+    d->clearBodySource();
+    d->invalidateEncodedBody(this);
+}
+
+void Content::setContent(QByteArray &&s)
+{
+    Q_D(Content);
+    d->clearBodySource();
+    // Same split as HeaderParsing::extractHeaderAndBody(), but the body
+    // keeps the buffer of s: removing the head from an unshared QByteArray
+    // moves the data within it.
+    int bodyStart = 1; // empty header
+    if (!s.startsWith('\n')) {
+        const int pos = s.indexOf("\n\n");
+        if (pos == -1) {
+            d->head = std::move(s);
+            d->body.clear();
+            d->invalidateEncodedBody(this);
+            return;
+        }
+        bodyStart = pos + 2;
+        if (bodyStart < s.size() && s.at(bodyStart) == '\n') {
+            // keep the empty line, see extractHeaderAndBody()
+            --bodyStart;
+        }
+        d->head = s.left(pos + 1);
+    } else {
+        d->head.clear();
+    }
+    s.remove(0, bodyStart);
+    d->body = std::move(s);
+    d->invalidateEncodedBody(this);
 }
 
 QByteArray Content::head() const
@@ -72,10 +116,28 @@ QByteArray Content::head() const
 
 void Content::setHead(const QByteArray &head)
 {
-    d_ptr->head = head;
-    if (!head.endsWith('\n')) {
+    setHead(QByteArray(head));
+}
+
+void Content::setHead(QByteArray &&head)
+{
+    d_ptr->head = std::move(head);
+    if (!d_ptr->head.endsWith('\n')) {
         d_ptr->head += '\n';
     }
+    if (d_ptr->parent) {
+        d_ptr->invalidateEncodedBody(d_ptr->parent);
+    }
+}
+
+QByteArray Content::takeHead()
+{
+    QByteArray head = std::move(d_ptr->head);
+    d_ptr->head.clear();
+    if (d_ptr->parent) {
+        d_ptr->invalidateEncodedBody(d_ptr->parent);
+    }
+    return head;
 }
 
 QByteArray Content::body() const
@@ -86,6 +148,92 @@ QByteArray Content::body() const
 void Content::setBody(const QByteArray &body)
 {
     d_ptr->body = body;
+    d_ptr->clearBodySource();
+    d_ptr->invalidateEncodedBody(this);
+}
+
+void Content::setBody(QByteArray &&body)
+{
+    d_ptr->body = std::move(body);
+    d_ptr->clearBodySource();
+    d_ptr->invalidateEncodedBody(this);
+}
+
+QByteArray Content::takeBody()
+{
+    QByteArray body = std::move(d_ptr->body);
+    d_ptr->body.clear();
+    d_ptr->invalidateEncodedBody(this);
+    return body;
+}
+
+const QByteArray &Content::bodyView() const
+{
+    return d_ptr->body;
+}
+
+bool Content::setBodySource(QIODevice *device)
+{
+    Q_D(Content);
+    if (!device || !device->isReadable() || device->isSequential() || !device->seek(0)) {
+        return false;
+    }
+
+    // Count the data in chunks of whole lines, as CharFreq expects.
+    const qint64 chunkSize = 64 * 1024;
+    CharFreq cf;
+    QByteArray pending;
+    while (true) {
+        const QByteArray chunk = device->read(chunkSize);
+        if (chunk.isEmpty()) {
+            break;
+        }
+        pending += chunk;
+        int end = pending.lastIndexOf('\n') + 1;
+        if (end == 0 && pending.size() >= chunkSize) {
+            // such a long line is not text anyway, but keep CRLF together
+            end = pending.endsWith('\r') ? pending.size() - 1 : pending.size();
+        }
+        cf.add(pending.constData(), end);
+        pending.remove(0, end);
+    }
+    if (!device->atEnd()) {
+        return false;
+    }
+    cf.add(pending.constData(), pending.size());
+
+    Headers::contentEncoding encoding = Headers::CEbase64;
+    const auto allowed = encodingsForCharFreq(cf);
+    for (Headers::contentEncoding e : allowed) {
+        if (e != Headers::CE8Bit) {
+            encoding = e;
+            break;
+        }
+    }
+
+    d->clearBodySource();
+    d->bodySource = device;
+    d->body.clear();
+    Headers::ContentTransferEncoding *enc = contentTransferEncoding();
+    enc->setEncoding(encoding);
+    enc->setDecoded(true);
+    d->invalidateEncodedBody(this);
+    return true;
+}
+
+bool Content::setBodySource(const QString &fileName)
+{
+    auto file = new QFile(fileName);
+    if (!file->open(QIODevice::ReadOnly) || !setBodySource(file)) {
+        delete file;
+        return false;
+    }
+    return true;
+}
+
+bool Content::hasBodySource() const
+{
+    return d_ptr->bodySource;
 }
 
 QByteArray Content::preamble() const
@@ -96,6 +244,13 @@ QByteArray Content::preamble() const
 void Content::setPreamble(const QByteArray &preamble)
 {
     d_ptr->preamble = preamble;
+    d_ptr->invalidateEncodedBody(this);
+}
+
+void Content::setPreamble(QByteArray &&preamble)
+{
+    d_ptr->preamble = std::move(preamble);
+    d_ptr->invalidateEncodedBody(this);
 }
 
 QByteArray Content::epilogue() const
@@ -106,16 +261,27 @@ QByteArray Content::epilogue() const
 void Content::setEpilogue(const QByteArray &epilogue)
 {
     d_ptr->epilogue = epilogue;
+    d_ptr->invalidateEncodedBody(this);
+}
+
+void Content::setEpilogue(QByteArray &&epilogue)
+{
+    d_ptr->epilogue = std::move(epilogue);
+    d_ptr->invalidateEncodedBody(this);
 }
 
 void Content::parse()
 {
     Q_D(Content);
+    ClassificationDeferrer deferrer(this);
 
     // Clean up old headers and parse them again.
     qDeleteAll(d->headers);
     d->headers.clear();
     d->headers = HeaderParsing::parseHeaders(d->head);
+    for (Headers::Base *h : std::as_const(d->headers)) {
+        Headers::BasePrivate::setOwner(h, this);
+    }
 
     // If we are frozen, save the body as-is. This is done because parsing
     // changes the content (it loses preambles and epilogues, converts uuencode->mime, etc.)
@@ -157,7 +323,7 @@ void Content::parse()
         // or something like that
         if (bodyIsMessage()) {
             d->bodyAsMessage = Message::Ptr(new Message);
-            d->bodyAsMessage->setContent(d->body);
+            d->bodyAsMessage->setContent(std::move(d->body));
             d->bodyAsMessage->setFrozen(d->frozen);
             d->bodyAsMessage->parse();
             d->bodyAsMessage->d_ptr->parent = this;
@@ -167,6 +333,8 @@ void Content::parse()
             d->body.clear();
         }
     }
+
+    d->invalidateEncodedBody(this);
 }
 
 bool Content::isFrozen() const
@@ -177,6 +345,7 @@ bool Content::isFrozen() const
 void Content::setFrozen(bool frozen)
 {
     d_ptr->frozen = frozen;
+    d_ptr->invalidateEncodedBody(this);
 }
 
 void Content::assemble()
@@ -186,20 +355,48 @@ void Content::assemble()
         return;
     }
 
-    d->head = assembleHeaders();
+    const QByteArray newHead = assembleHeaders();
+    if (newHead != d->head) {
+        d->head = newHead;
+        // the head is part of the encoded body of the parent
+        if (d->parent) {
+            d->invalidateEncodedBody(d->parent);
+        }
+    }
     const auto contentsList = contents();
     for (Content *c : contentsList) {
         c->assemble();
     }
 }
 
+// Headers the encoded body of a Content depends on.
+static bool affectsEncoding(const char *type)
+{
+    return qstricmp(type, Headers::ContentType::staticType()) == 0 ||
+           qstricmp(type, Headers::ContentTransferEncoding::staticType()) == 0;
+}
+
+// Headers the classification of a Content depends on.
+static bool affectsClassification(const char *type)
+{
+    return qstricmp(type, Headers::ContentType::staticType()) == 0 ||
+           qstricmp(type, Headers::ContentDisposition::staticType()) == 0;
+}
+
 QByteArray Content::assembleHeaders()
 {
     Q_D(Content);
     QByteArray newHead;
-    for (const Headers::Base *h : std::as_const(d->headers)) {
+    for (Headers::Base *h : std::as_const(d->headers)) {
         if (!h->isEmpty()) {
-            newHead += foldHeader(h->as7BitString()) + '\n';
+            // unmodified headers are kept as they were parsed or last assembled,
+            // which also keeps signatures over them (e.g. DKIM) valid
+            QByteArray raw = h->rawField();
+            if (raw.isNull()) {
+                raw = foldHeader(h->as7BitString());
+                Headers::BasePrivate::setRawField(h, raw);
+            }
+            newHead += raw + '\n';
         }
     }
 
@@ -209,11 +406,33 @@ QByteArray Content::assembleHeaders()
 void Content::clear()
 {
     Q_D(Content);
+    ClassificationDeferrer deferrer(this);
     qDeleteAll(d->headers);
     d->headers.clear();
     clearContents();
     d->head.clear();
     d->body.clear();
+    d->clearBodySource();
+    d->invalidateEncodedBody(this);
+}
+
+// Returns an empty Content of the same class as @p content.
+static Content *createEmptyCopy(const Content *content)
+{
+    if (dynamic_cast<const NewsArticle *>(content)) {
+        return new NewsArticle;
+    } else if (dynamic_cast<const Message *>(content)) {
+        return new Message;
+    }
+    return new Content;
+}
+
+Content *Content::clone() const
+{
+    Content *copy = createEmptyCopy(this);
+    d_ptr->cloneInto(copy);
+    copy->d_ptr->updateClassification(copy);
+    return copy;
 }
 
 void Content::clearContents(bool del)
@@ -224,6 +443,8 @@ void Content::clearContents(bool del)
     }
     d->multipartContents.clear();
     d->clearBodyMessage();
+    d->updateClassification(this);
+    d->invalidateEncodedBody(this);
 }
 
 QByteArray Content::encodedContent(bool useCrLf)
@@ -252,6 +473,10 @@ QByteArray Content::encodedContent(bool useCrLf)
 QByteArray Content::encodedBody()
 {
     Q_D(Content);
+    if (d->encodedBodyValid()) {
+        return d->encodedBody;
+    }
+
     QByteArray e;
     // Body.
     if (d->frozen) {
@@ -268,19 +493,19 @@ QByteArray Content::encodedBody()
         // No encoding needed, as the ContentTransferEncoding can only be 7bit
         // for encapsulated messages
         e += d->bodyAsMessage->encodedContent();
+    } else if (d->bodySource) {
+        // The body is read from a device.
+        QByteArray encoded;
+        QBuffer buffer(&encoded);
+        buffer.open(QIODevice::WriteOnly);
+        d->writeBodySource(this, &buffer, false);
+        e += encoded;
     } else if (!d->body.isEmpty()) {
         // This is a single-part Content.
         Headers::ContentTransferEncoding *enc = contentTransferEncoding();
 
         if (enc->needToEncode()) {
-            if (enc->encoding() == Headers::CEquPr) {
-                e += KCodecs::quotedPrintableEncode(d->body, false);
-            } else {
-                QByteArray encoded;
-                KCodecs::base64Encode(d->body, encoded, true);
-                e += encoded;
-                e += '\n';
-            }
+            e += TransferEncoding::encode(d->body, enc->encoding());
         } else {
             e += d->body;
         }
@@ -307,9 +532,20 @@ QByteArray Content::encodedBody()
             e += d->epilogue;
         }
     }
+    // Only encoded single-part bodies are kept: a multipart body is put
+    // together from the cached parts again, and the encoded data of body
+    // sources is not kept in memory.
+    if (d->multipartContents.isEmpty() && !d->bodyAsMessage && !d->bodySource) {
+        d->encodedBody = e;
+    }
     return e;
 }
 
+bool Content::writeEncodedContent(QIODevice *device, bool useCrLf)
+{
+    return d_ptr->writeContent(this, device, useCrLf);
+}
+
 QByteArray Content::decodedContent()
 {
     QByteArray ret;
@@ -325,31 +561,13 @@ QByteArray Content::decodedContent()
         //Laurent Fix bug #311267
         //removeTrailingNewline = true;
     } else {
+        ret = TransferEncoding::decode(d_ptr->body, ec->encoding());
         switch (ec->encoding()) {
-        case Headers::CEbase64 : {
-            KCodecs::Codec *codec = KCodecs::Codec::codecForName("base64");
-            Q_ASSERT(codec);
-            ret.resize(codec->maxDecodedSizeFor(d_ptr->body.size()));
-            QScopedPointer<KCodecs::Decoder> decoder(codec->makeDecoder());
-            QByteArray::const_iterator inputIt = d_ptr->body.constBegin();
-            QByteArray::iterator resultIt = ret.begin();
-            decoder->decode(inputIt, d_ptr->body.constEnd(), resultIt, ret.constEnd());
-            ret.truncate(resultIt - ret.begin());
-            break;
-        }
-        case Headers::CEquPr :
-            ret = KCodecs::quotedPrintableDecode(d_ptr->body);
-            removeTrailingNewline = true;
-            break;
+        case Headers::CEbase64 :
         case Headers::CEuuenc :
-            KCodecs::uudecode(d_ptr->body, ret);
-            break;
         case Headers::CEbinary :
-            ret = d_ptr->body;
-            removeTrailingNewline = false;
             break;
         default :
-            ret = d_ptr->body;
             removeTrailingNewline = true;
         }
     }
@@ -376,7 +594,7 @@ QString Content::decodedText(bool trimText, bool removeTrailingNewlines)
         contentType()->setCharset(chset);
     }
 
-    QString s = codec->toUnicode(d_ptr->body.data(), d_ptr->body.length());
+    QString s = CharsetConversion::toUnicode(codec, d_ptr->body);
 
     if (trimText || removeTrailingNewlines) {
         int i;
@@ -415,47 +633,28 @@ void Content::fromUnicodeString(const QString &s)
 
     d_ptr->body = codec->fromUnicode(s);
     contentTransferEncoding()->setDecoded(true);   //text is always decoded
+    d_ptr->invalidateEncodedBody(this);
 }
 
 Content *Content::textContent()
 {
-    Content *ret = nullptr;
-
-    //return the first content with mimetype=text/*
-    if (contentType()->isText()) {
-        ret = this;
-    } else {
-        const auto contents = d_ptr->contents();
-        for (Content *c : contents) {
-            if ((ret = c->textContent()) != nullptr) {
-                break;
-            }
-        }
-    }
-    return ret;
+    Q_D(Content);
+    return d->findTextContent(this);
 }
 
 QVector<Content*> Content::attachments()
 {
+    Q_D(Content);
     QVector<Content*> result;
-
-    auto ct = contentType(false);
-    if (ct && ct->isMultipart() &&
-        !ct->isSubtype("related") /* && !ct->isSubtype("alternative")*/) {
-      const QVector<Content *> contentsList = contents();
-      result.reserve(contentsList.count());
-      for (Content *child : contentsList) {
-        if (isAttachment(child)) {
-          result.push_back(child);
-        } else {
-          result += child->attachments();
-        }
-      }
-    }
-
+    d->collectAttachments(result);
     return result;
 }
 
+Content::Classification Content::classification() const
+{
+    return Classification(QFlag(d_ptr->classification & ~(ContentPrivate::TextPartFlag | ContentPrivate::ContainsTextFlag)));
+}
+
 QVector<Content*> Content::contents() const
 {
     return d_ptr->contents();
@@ -475,6 +674,8 @@ void Content::replaceContent(Content *oldContent, Content *newContent)
       // If the content was part of something else, this will remove it from there.
       newContent->setParent( this );
     }
+    d->updateClassification(this);
+    d->invalidateEncodedBody(this);
 }
 
 
@@ -484,6 +685,7 @@ void Content::addContent(Content *c, bool prepend)
 
     // This method makes no sense for encapsulated messages
     Q_ASSERT(!bodyIsMessage());
+    ClassificationDeferrer deferrer(this);
 
     // If this message is single-part; make it multipart first.
     if (d->multipartContents.isEmpty() && !contentType()->isMultipart()) {
@@ -508,7 +710,7 @@ void Content::addContent(Content *c, bool prepend)
         main->contentType()->setCategory(Headers::CCmixedPart);
 
         // Move the body to the new subcontent.
-        main->setBody(d->body);
+        main->setBody(std::move(d->body));
         d->body.clear();
 
         // Add the subcontent.
@@ -535,6 +737,7 @@ void Content::addContent(Content *c, bool prepend)
         // If the content was part of something else, this will remove it from there.
         c->setParent(this);
     }
+    d->invalidateEncodedBody(this);
 }
 
 void Content::removeContent(Content *c, bool del)
@@ -547,12 +750,14 @@ void Content::removeContent(Content *c, bool del)
     // This method makes no sense for encapsulated messages.
     // Should be covered by the above assert already, though.
     Q_ASSERT(!bodyIsMessage());
+    ClassificationDeferrer deferrer(this);
 
     d->multipartContents.removeAll(c);
     if (del) {
         delete c;
     } else {
         c->d_ptr->parent = nullptr;
+        c->d_ptr->updateClassification(c);
     }
 
     // If only one content is left, turn this content into a single-part.
@@ -574,6 +779,7 @@ void Content::removeContent(Content *c, bool del)
         delete main;
         d->multipartContents.clear();
     }
+    d->invalidateEncodedBody(this);
 }
 
 void Content::changeEncoding(Headers::contentEncoding e)
@@ -595,9 +801,10 @@ void Content::changeEncoding(Headers::contentEncoding e)
     } else {
         // This is non-textual content.  Re-encode it.
         if (e == Headers::CEbase64) {
-            KCodecs::base64Encode(decodedContent(), d_ptr->body, true);
+            d_ptr->body = TransferEncoding::base64Encode(decodedContent());
             enc->setEncoding(e);
             enc->setDecoded(false);
+            d_ptr->invalidateEncodedBody(this);
         } else {
             // It only makes sense to convert binary stuff to base64.
             Q_ASSERT(false);
@@ -614,13 +821,7 @@ Headers::Base *Content::headerByType(const char *type) const
 {
     Q_ASSERT(type  && *type);
 
-    for (Headers::Base *h : std::as_const(d_ptr->headers)) {
-        if (h->is(type)) {
-            return h; // Found.
-        }
-    }
-
-    return nullptr; // Not found.
+    return d_ptr->findHeader(type);
 }
 
 QVector<Headers::Base*> Content::headersByType(const char *type) const
@@ -649,6 +850,13 @@ void Content::appendHeader(Headers::Base *h)
 {
     Q_D(Content);
     d->headers.append(h);
+    Headers::BasePrivate::setOwner(h, this);
+    if (affectsClassification(h->type())) {
+        d->updateClassification(this);
+    }
+    if (affectsEncoding(h->type())) {
+        d->invalidateEncodedBody(this);
+    }
 }
 
 bool Content::removeHeader(const char *type)
@@ -659,6 +867,12 @@ bool Content::removeHeader(const char *type)
         if ((*it)->is(type)) {
             delete(*it);
             d->headers.erase(it);
+            if (affectsClassification(type)) {
+                d->updateClassification(this);
+            }
+            if (affectsEncoding(type)) {
+                d->invalidateEncodedBody(this);
+            }
             return true;
         }
     }
@@ -668,7 +882,7 @@ bool Content::removeHeader(const char *type)
 
 bool Content::hasHeader(const char* type) const
 {
-    return headerByType(type) != nullptr;
+    return d_ptr->findHeader(type) != nullptr;
 }
 
 int Content::size()
@@ -676,8 +890,7 @@ int Content::size()
     int ret = d_ptr->body.length();
 
     if (contentTransferEncoding()->encoding() == Headers::CEbase64) {
-        KCodecs::Codec *codec = KCodecs::Codec::codecForName("base64");
-        return codec->maxEncodedSizeFor(ret);
+        return TransferEncoding::codec(Headers::CEbase64)->maxEncodedSizeFor(ret);
     }
 
     // Not handling quoted-printable here since that requires actually
@@ -724,6 +937,186 @@ int Content::lineCount() const
     return ret;
 }
 
+void ContentPrivate::clearBodySource()
+{
+    delete bodySource;
+    bodySource = nullptr;
+}
+
+bool ContentPrivate::containsBodySource() const
+{
+    if (bodySource) {
+        return true;
+    }
+    const auto children = contents();
+    return std::any_of(children.cbegin(), children.cend(), [](Content *child) {
+        return child->d_ptr->containsBodySource();
+    });
+}
+
+bool ContentPrivate::writeContent(Content *q, QIODevice *device, bool useCrLf)
+{
+    const auto write = [device, useCrLf](const QByteArray &data) {
+        const QByteArray out = useCrLf ? LFtoCRLF(data) : data;
+        return device->write(out) == out.size();
+    };
+
+    if (frozen || !containsBodySource()) {
+        return write(q->encodedContent());
+    }
+
+    // The head, separated from the body as in Content::encodedContent().
+    const QByteArray boundary = "\n--" + q->contentType()->boundary();
+    QByteArray bodyStart;
+    if (bodySource) {
+        if (q->contentTransferEncoding()->encoding() != Headers::CEbase64 && bodySource->seek(0)) {
+            bodyStart = bodySource->peek(2);
+        }
+    } else if (bodyAsMessage) {
+        bodyStart = bodyAsMessage->head().left(2);
+    } else {
+        bodyStart = (preamble + boundary).left(2);
+    }
+    QByteArray start = head;
+    if (!start.endsWith("\n\n") && !bodyStart.startsWith("\n\n") &&
+        !(start.endsWith('\n') && bodyStart.startsWith('\n'))) {
+        start += '\n';
+    }
+    if (!write(start)) {
+        return false;
+    }
+
+    // The body, as in Content::encodedBody().
+    if (bodySource) {
+        return writeBodySource(q, device, useCrLf);
+    }
+    if (bodyAsMessage) {
+        return bodyAsMessage->d_ptr->writeContent(bodyAsMessage.data(), device, useCrLf);
+    }
+    if (!preamble.isEmpty() && !write(preamble)) {
+        return false;
+    }
+    for (Content *c : std::as_const(multipartContents)) {
+        if (!write(boundary + '\n') || !c->d_ptr->writeContent(c, device, useCrLf)) {
+            return false;
+        }
+    }
+    return write(boundary + "--\n") && (epilogue.isEmpty() || write(epilogue));
+}
+
+bool ContentPrivate::writeBodySource(Content *q, QIODevice *device, bool useCrLf)
+{
+    if (!bodySource->seek(0)) {
+        return false;
+    }
+
+    // multiples of 57 bytes fill whole base64 lines
+    const int chunkSize = 57 * 1024;
+    const Headers::contentEncoding encoding = q->contentTransferEncoding()->encoding();
+    if (encoding != Headers::CEbase64 && encoding != Headers::CEquPr) {
+        while (true) {
+            const QByteArray chunk = bodySource->read(chunkSize);
+            if (chunk.isEmpty()) {
+                return bodySource->atEnd();
+            }
+            const QByteArray out = useCrLf ? LFtoCRLF(chunk) : chunk;
+            if (device->write(out) != out.size()) {
+                return false;
+            }
+        }
+    }
+
+    const KCodecs::Codec *codec = TransferEncoding::codec(encoding);
+    const KCodecs::Codec::NewlineType newline = useCrLf ? KCodecs::Codec::NewlineCRLF : KCodecs::Codec::NewlineLF;
+    std::unique_ptr<KCodecs::Encoder> encoder(codec->makeEncoder(newline));
+    QByteArray out(codec->maxEncodedSizeFor(chunkSize, newline), Qt::Uninitialized);
+    char *const outBegin = out.data();
+    const char *const outEnd = outBegin + out.size();
+    char last = '\n';
+    const auto flush = [&](const char *dcursor) {
+        const qint64 length = dcursor - outBegin;
+        if (length > 0) {
+            last = dcursor[-1];
+        }
+        return device->write(outBegin, length) == length;
+    };
+
+    while (true) {
+        const QByteArray chunk = bodySource->read(chunkSize);
+        if (chunk.isEmpty()) {
+            if (!bodySource->atEnd()) {
+                return false;
+            }
+            break;
+        }
+        const char *scursor = chunk.constData();
+        const char *const send = scursor + chunk.size();
+        while (scursor != send) {
+            char *dcursor = outBegin;
+            encoder->encode(scursor, send, dcursor, outEnd);
+            if (!flush(dcursor)) {
+                return false;
+            }
+        }
+    }
+    bool finished = false;
+    while (!finished) {
+        char *dcursor = outBegin;
+        finished = encoder->finish(dcursor, outEnd);
+        if (!flush(dcursor)) {
+            return false;
+        }
+    }
+    // Content::encodedBody() ends base64 data with a line break as well
+    if (encoding == Headers::CEbase64 && last != '\n') {
+        const QByteArray lineBreak = useCrLf ? "\r\n" : "\n";
+        return device->write(lineBreak) == lineBreak.size();
+    }
+    return true;
+}
+
+void ContentPrivate::cloneInto(Content *copy) const
+{
+    ContentPrivate *const cd = copy->d_ptr;
+    cd->head = head;
+    cd->body = body;
+    cd->frozenBody = frozenBody;
+    cd->preamble = preamble;
+    cd->epilogue = epilogue;
+    cd->encodedBody = encodedBody;
+    cd->frozen = frozen;
+    if (bodySource) {
+        // a file is opened again, any other device is read into memory
+        auto file = qobject_cast<QFile *>(bodySource);
+        std::unique_ptr<QFile> fileCopy(file ? new QFile(file->fileName()) : nullptr);
+        if (fileCopy && fileCopy->open(QIODevice::ReadOnly)) {
+            cd->bodySource = fileCopy.release();
+        } else if (bodySource->seek(0)) {
+            cd->body = bodySource->readAll();
+        }
+    }
+
+    cd->headers.reserve(headers.size());
+    for (const Headers::Base *h : headers) {
+        Headers::Base *headerCopy = Headers::BasePrivate::clone(h);
+        cd->headers.append(headerCopy);
+        Headers::BasePrivate::setOwner(headerCopy, copy);
+    }
+
+    cd->multipartContents.reserve(multipartContents.size());
+    for (const Content *c : multipartContents) {
+        Content *contentCopy = createEmptyCopy(c);
+        c->d_ptr->cloneInto(contentCopy);
+        contentCopy->d_ptr->parent = copy;
+        cd->multipartContents.append(contentCopy);
+    }
+    if (bodyAsMessage) {
+        cd->bodyAsMessage = Message::Ptr(static_cast<Message *>(createEmptyCopy(bodyAsMessage.data())));
+        bodyAsMessage->d_ptr->cloneInto(cd->bodyAsMessage.data());
+        cd->bodyAsMessage->d_ptr->parent = copy;
+    }
+}
+
 bool ContentPrivate::decodeText(Content *q)
 {
     Headers::ContentTransferEncoding *enc = q->contentTransferEncoding();
@@ -735,25 +1128,12 @@ bool ContentPrivate::decodeText(Content *q)
         return true; //nothing to do
     }
 
-    switch (enc->encoding()) {
-    case Headers::CEbase64 :
-        body = KCodecs::base64Decode(body);
-        break;
-    case Headers::CEquPr :
-        body = KCodecs::quotedPrintableDecode(body);
-        break;
-    case Headers::CEuuenc :
-        body = KCodecs::uudecode(body);
-        break;
-    case Headers::CEbinary :
-        // nothing to decode
-    default :
-        break;
-    }
+    body = TransferEncoding::decode(body, enc->encoding());
     if (!body.endsWith("\n")) {
         body.append("\n");
     }
     enc->setDecoded(true);
+    invalidateEncodedBody(q);
     return true;
 }
 
@@ -809,6 +1189,7 @@ void Content::setParent(Content *parent)
         if (!oldParent->contents().isEmpty() && oldParent->contents().contains(this)) {
             oldParent->removeContent(this);
         }
+        d_ptr->invalidateEncodedBody(oldParent);
     }
 
     d_ptr->parent = parent;
@@ -816,7 +1197,9 @@ void Content::setParent(Content *parent)
         if (!parent->contents().isEmpty() && !parent->contents().contains(this)) {
             parent->addContent(this);
         }
+        d_ptr->invalidateEncodedBody(parent);
     }
+    d_ptr->updateClassification(this);
 }
 
 Content *Content::parent() const
@@ -857,11 +1240,8 @@ Message::Ptr Content::bodyAsMessage() const
 
 bool Content::bodyIsMessage() const
 {
-    // Use const_case here to work around API issue that neither header() nor hasHeader() are
-    // const, even though they should be
-    return const_cast<Content *>(this)->header<Headers::ContentType>(false) &&
-           const_cast<Content *>(this)->header<Headers::ContentType>(true)
-           ->mimeType().toLower() == "message/rfc822";
+    const auto ct = d_ptr->contentTypeHeader();
+    return ct && ct->mimeType().toLower() == "message/rfc822";
 }
 
 // @cond PRIVATE
@@ -895,6 +1275,264 @@ QVector<Content*> ContentPrivate::contents() const
     }
 }
 
+Headers::Base *ContentPrivate::findHeader(const char *type) const
+{
+    for (Headers::Base *h : std::as_const(headers)) {
+        if (h->is(type)) {
+            return h; // Found.
+        }
+    }
+
+    return nullptr; // Not found.
+}
+
+Headers::ContentType *ContentPrivate::contentTypeHeader() const
+{
+    return static_cast<Headers::ContentType *>(findHeader(Headers::ContentType::staticType()));
+}
+
+quint32 ContentPrivate::nextGeneration()
+{
+    // shared by all trees, so that a Content moved to another tree never
+    // finds its old generation there
+    static QAtomicInteger<quint32> lastGeneration;
+    return lastGeneration.fetchAndAddRelaxed(1) + 1;
+}
+
+void ContentPrivate::invalidateEncodedBody(Content *q)
+{
+    for (Content *c = q; c; c = c->d_ptr->parent) {
+        c->d_ptr->encodedBody.clear();
+    }
+}
+
+bool ContentPrivate::encodedBodyValid() const
+{
+    return !encodedBody.isNull();
+}
+
+void ContentPrivate::headerModified(Content *q, const Headers::Base *header)
+{
+    const char *const type = header->type();
+    if (affectsClassification(type)) {
+        q->d_ptr->updateClassification(q);
+    }
+    if (affectsEncoding(type)) {
+        q->d_ptr->invalidateEncodedBody(q);
+    }
+}
+
+void ContentPrivate::updateClassification(Content *q)
+{
+    Content *top = q->topLevel();
+    ContentPrivate *topD = top->d_ptr;
+    if (topD->classificationDeferred) {
+        return;
+    }
+
+    const quint32 currentGeneration = nextGeneration();
+    topD->classifyText();
+    Content *mainText = topD->findTextContent(top);
+    topD->classify(top, mainText, currentGeneration);
+
+    // Contents with a parent that does not list them as child are not
+    // reached from the top-level Content, classify the outermost of them
+    Content *unreached = nullptr;
+    for (Content *c = q; c != top; c = c->d_ptr->parent) {
+        if (c->d_ptr->generation != currentGeneration) {
+            unreached = c;
+        }
+    }
+    if (unreached) {
+        unreached->d_ptr->classifyText();
+        unreached->d_ptr->classify(unreached, mainText, currentGeneration);
+    }
+}
+
+ClassificationDeferrer::ClassificationDeferrer(Content *q)
+    : q(q)
+    , topD(q->topLevel()->d_ptr)
+    , wasDeferred(topD->classificationDeferred)
+{
+    topD->classificationDeferred = true;
+}
+
+ClassificationDeferrer::~ClassificationDeferrer()
+{
+    topD->classificationDeferred = wasDeferred;
+    q->d_ptr->updateClassification(q);
+}
+
+Content *ContentPrivate::findTextContent(Content *q) const
+{
+    // the first Content with mimetype text/*
+    const ContentPrivate *c = this;
+    while (!(c->classification & TextPartFlag)) {
+        const auto children = c->contents();
+        const auto it = std::find_if(children.cbegin(), children.cend(), [](Content *child) {
+            return child->d_ptr->classification & ContainsTextFlag;
+        });
+        if (it == children.cend()) {
+            return nullptr;
+        }
+        q = *it;
+        c = q->d_ptr;
+    }
+    return q;
+}
+
+void ContentPrivate::classifyText()
+{
+    // a missing Content-Type means text/plain
+    const auto ct = contentTypeHeader();
+    classification = (!ct || ct->isText()) ? (TextPartFlag | ContainsTextFlag) : 0;
+
+    const auto children = contents();
+    for (Content *child : children) {
+        child->d_ptr->classifyText();
+        classification |= child->d_ptr->classification & ContainsTextFlag;
+    }
+}
+
+void ContentPrivate::classify(Content *q, Content *mainText, quint32 currentGeneration)
+{
+    const auto children = contents();
+    for (Content *child : children) {
+        child->d_ptr->classify(child, mainText, currentGeneration);
+    }
+
+    const auto ct = contentTypeHeader();
+    const auto cd = static_cast<Headers::ContentDisposition *>(findHeader(Headers::ContentDisposition::staticType()));
+    const bool multipart = ct && ct->isMultipart();
+    Content::Classification flags;
+
+    // crypto parts: either an encrypted part or a signature
+    if (ct && ct->isMediatype("application")) {
+        const QByteArray lowerSubType = ct->subTypeView().toLower();
+        if (lowerSubType == "pgp-encrypted" ||
+            lowerSubType == "pgp-signature" ||
+            lowerSubType == "pkcs7-mime" ||
+            lowerSubType == "x-pkcs7-mime" ||
+            lowerSubType == "pkcs7-signature" ||
+            lowerSubType == "x-pkcs7-signature") {
+            flags |= Content::CryptoPart;
+        } else if (lowerSubType == "octet-stream" && cd) {
+            const auto fileName = cd->filename().toLower();
+            if (fileName == QLatin1String("msg.asc") || fileName == QLatin1String("encrypted.asc")) {
+                flags |= Content::CryptoPart;
+            }
+        }
+    }
+
+    // attachments: multipart/* is never an attachment itself, message/rfc822 always is,
+    // the main body part and crypto parts are not; otherwise a file name or the
+    // "attachment" disposition are good indicators
+    bool attachment = false;
+    if (ct && ct->isMimeType("message/rfc822")) {
+        attachment = true;
+    } else if (!multipart && !(parent && q == mainText) && !(flags & Content::CryptoPart)) {
+        attachment = (cd && !cd->filename().isEmpty()) ||
+                     (ct && !ct->name().isEmpty()) ||
+                     (cd && cd->disposition() == Headers::CDattachment);
+    }
+
+    if (attachment) {
+        flags |= Content::Attachment | Content::ContainsAttachment;
+    } else if (multipart && !ct->isSubtype("related")) {
+        for (Content *child : children) {
+            if (child->d_ptr->classification & Content::ContainsAttachment) {
+                flags |= Content::ContainsAttachment;
+                break;
+            }
+        }
+    }
+
+    // iTIP invitations
+    if (ct && ct->isMediatype("text") && ct->isSubtype("calendar")) {
+        flags |= Content::Invitation | Content::ContainsInvitation;
+    } else if (multipart) {
+        for (Content *child : children) {
+            if (child->d_ptr->classification & Content::ContainsInvitation) {
+                flags |= Content::ContainsInvitation;
+                break;
+            }
+        }
+    }
+
+    if ((ct && (ct->isSubtype("signed") ||
+                ct->isSubtype("pgp-signature") ||
+                ct->isSubtype("pkcs7-signature") ||
+                ct->isSubtype("x-pkcs7-signature"))) ||
+        mainBodyPartIsOneOf({"multipart/signed",
+                             "application/pgp-signature",
+                             "application/pkcs7-signature",
+                             "application/x-pkcs7-signature"})) {
+        flags |= Content::Signed;
+    }
+
+    if ((ct && (ct->isSubtype("encrypted") ||
+                ct->isSubtype("pgp-encrypted") ||
+                ct->isSubtype("pkcs7-mime") ||
+                ct->isSubtype("x-pkcs7-mime"))) ||
+        mainBodyPartIsOneOf({"multipart/encrypted",
+                             "application/pgp-encrypted",
+                             "application/pkcs7-mime",
+                             "application/x-pkcs7-mime"})) {
+        flags |= Content::Encrypted;
+    }
+
+    classification = (classification & (TextPartFlag | ContainsTextFlag)) | int(flags);
+    generation = currentGeneration;
+}
+
+// Same walk as Message::mainBodyPart(), for several types at once.
+bool ContentPrivate::mainBodyPartIsOneOf(std::initializer_list<const char *> types) const
+{
+    const auto isOneOf = [&types](const ContentPrivate *part) {
+        const auto ct = part->contentTypeHeader();
+        const QByteArray mimeType = ct ? ct->mimeType() : QByteArray();
+        return std::any_of(types.begin(), types.end(), [&mimeType](const char *type) {
+            return mimeType == type;
+        });
+    };
+
+    const ContentPrivate *c = this;
+    while (true) {
+        const auto ct = c->contentTypeHeader();
+        if (!ct || !ct->isMultipart()) {
+            return isOneOf(c);
+        }
+
+        const auto children = c->contents();
+        if (children.isEmpty()) {
+            return false;
+        }
+
+        if (ct->subTypeView() == "alternative") {
+            return std::any_of(children.cbegin(), children.cend(), [&isOneOf](Content *child) {
+                return isOneOf(child->d_ptr);
+            });
+        }
+
+        c = children.constFirst()->d_ptr;
+    }
+}
+
+void ContentPrivate::collectAttachments(QVector<Content *> &result) const
+{
+    const auto ct = contentTypeHeader();
+    if (ct && ct->isMultipart() && !ct->isSubtype("related") /* && !ct->isSubtype("alternative")*/) {
+        const auto children = contents();
+        for (Content *child : children) {
+            if (child->d_ptr->classification & Content::Attachment) {
+                result.push_back(child);
+            } else {
+                child->d_ptr->collectAttachments(result);
+            }
+        }
+    }
+}
+
 bool ContentPrivate::parseUuencoded(Content *q)
 {
     Parser::UUEncoded uup(body, KMime::extractHeader(head, "Subject"));
@@ -913,7 +1551,6 @@ bool ContentPrivate::parseUuencoded(Content *q)
         q->contentTransferEncoding()->setEncoding(Headers::CE7Bit);
     } else {
         // This is a complete message, so treat it as "multipart/mixed".
-        const auto prevBody = body;
         body.clear();
         ct->setMimeType("multipart/mixed");
         ct->setBoundary(multiPartBoundary());
@@ -933,16 +1570,20 @@ bool ContentPrivate::parseUuencoded(Content *q)
         }
 
         // Now add each of the binary parts as sub-Contents.
-        for (int i = 0; i < uup.binaryParts().count(); ++i) {
+        const auto binaryParts = uup.binaryParts();
+        const auto mimeTypes = uup.mimeTypes();
+        const auto filenames = uup.filenames();
+        for (int i = 0; i < binaryParts.count(); ++i) {
             auto *c = new Content(q);
-            c->contentType()->setMimeType(uup.mimeTypes().at(i));
-            c->contentType()->setName(QLatin1String(uup.filenames().at(i)), QByteArray(/*charset*/));
+            c->contentType()->setMimeType(mimeTypes.at(i));
+            c->contentType()->setName(QLatin1String(filenames.at(i)), QByteArray(/*charset*/));
             c->contentTransferEncoding()->setEncoding(Headers::CEuuenc);
             c->contentTransferEncoding()->setDecoded(false);
             c->contentDisposition()->setDisposition(Headers::CDattachment);
-            c->contentDisposition()->setFilename(QLatin1String(uup.filenames().at(i)));
-            // uup.binaryParts().at(i) does no longer have the uuencode header, which makes KCodecs fail since 5c66308c4786ef7fbf77b0e306e73f7d4ac3431b
-            c->setBody(prevBody);
+            c->contentDisposition()->setFilename(QLatin1String(filenames.at(i)));
+            // Each binary part only holds its own "begin" ... "end" range, so
+            // every attachment is decoded exactly once from its own data.
+            c->setBody(binaryParts.at(i));
             c->changeEncoding(Headers::CEbase64);   // Convert to base64.
             multipartContents.append(c);
         }
@@ -990,6 +1631,9 @@ bool ContentPrivate::parseYenc(Content *q)
 
         // Now add each of the binary parts as sub-Contents.
         for (int i = 0; i < yenc.binaryParts().count(); i++) {
+            if (yenc.verifications().at(i) == Parser::NonMimeParser::VerificationFailed) {
+                qCWarning(KMIME_LOG) << "CRC32 mismatch in yEnc encoded" << yenc.filenames().at(i);
+            }
             auto *c = new Content(q);
             c->contentType()->setMimeType(yenc.mimeTypes().at(i));
             c->contentType()->setName(QLatin1String(yenc.filenames().at(i)), QByteArray(/*charset*/));
@@ -44,6 +44,7 @@ TODO: possible glossary terms:
 #include <QSharedPointer>
 #include <QMetaType>
 
+class QIODevice;
 
 namespace KMime
 {
@@ -104,6 +105,23 @@ public:
     */
     typedef QVector<KMime::Content *> List;
 
+    /**
+      Describes the role of a Content within its MIME tree.
+      @see classification()
+      @since 5.23
+    */
+    enum ClassificationFlag {
+        NoClassification = 0x00,
+        Attachment = 0x01, ///< KMime::isAttachment() is true for this Content
+        ContainsAttachment = 0x02, ///< KMime::hasAttachment() is true for this Content
+        Invitation = 0x04, ///< KMime::isInvitation() is true for this Content
+        ContainsInvitation = 0x08, ///< KMime::hasInvitation() is true for this Content
+        CryptoPart = 0x10, ///< KMime::isCryptoPart() is true for this Content
+        Signed = 0x20, ///< this Content or its main body part is signed, see KMime::isSigned()
+        Encrypted = 0x40 ///< this Content or its main body part is encrypted, see KMime::isEncrypted()
+    };
+    Q_DECLARE_FLAGS(Classification, ClassificationFlag)
+
     /**
       Creates an empty Content object with a specified parent.
       @param parent the parent Content object
@@ -136,6 +154,15 @@ public:
     */
     void setContent(const QByteArray &s);
 
+    /**
+      Same as setContent(const QByteArray &), but takes over the data of
+      @p s; if it is not shared, the body is moved into this Content
+      without being copied.
+
+      @since 5.23
+    */
+    void setContent(QByteArray &&s);
+
     /**
      * Parses the Content.
      *
@@ -214,6 +241,27 @@ public:
     */
     void clearContents(bool del = true);
 
+    /**
+      Returns a deep copy of this Content and all its sub-Contents and
+      encapsulated messages, without assembling or parsing it.
+
+      The copy is of the same class as this Content (Content, Message or
+      NewsArticle) and has no parent. The raw head and body data is
+      implicitly shared with this Content, so it is only copied once either
+      of them modifies it. Headers are copied from their 7 bit
+      representation; headers that have not been modified since they were
+      parsed or assembled stay unmodified in the copy.
+
+      @code
+      auto copy = static_cast<KMime::Message *>(message->clone());
+      @endcode
+
+      The caller takes ownership of the returned Content.
+
+      @since 5.23
+    */
+    Q_REQUIRED_RESULT Content *clone() const;
+
     /**
       Returns the Content header raw data.
 
@@ -233,6 +281,22 @@ public:
     */
     void setHead(const QByteArray &head);
 
+    /**
+      Same as setHead(const QByteArray &), but takes over the data of @p head.
+
+      @since 5.23
+    */
+    void setHead(QByteArray &&head);
+
+    /**
+      Returns the Content header raw data and leaves the head of this
+      Content empty, without copying the data.
+
+      @since 5.23
+      @see head(), setHead().
+    */
+    Q_REQUIRED_RESULT QByteArray takeHead();
+
     /**
      * Returns all headers.
      * @since 5.7
@@ -394,6 +458,73 @@ public:
     */
     void setBody(const QByteArray &body);
 
+    /**
+      Same as setBody(const QByteArray &), but takes over the data of @p body,
+      so a large body can be passed in without being copied.
+
+      @since 5.23
+    */
+    void setBody(QByteArray &&body);
+
+    /**
+      Returns the Content body raw data and leaves the body of this Content
+      empty, without copying the data.
+
+      @since 5.23
+      @see body(), setBody().
+    */
+    Q_REQUIRED_RESULT QByteArray takeBody();
+
+    /**
+      Returns a reference to the Content body raw data.
+
+      Unlike body(), this does not create a copy that shares the data, so
+      modifying this Content afterwards does not have to detach it. The
+      reference is valid until the body of this Content changes.
+
+      @since 5.23
+      @see body().
+    */
+    Q_REQUIRED_RESULT const QByteArray &bodyView() const;
+
+    /**
+      Sets the decoded body of this Content to the data of @p device, which
+      is only read when the Content is encoded, in chunks. This allows to
+      send large attachments without holding them in memory, see
+      writeEncodedContent().
+
+      The data is read once right away to choose the Content-Transfer-Encoding:
+      7bit for 7 bit text, otherwise the more compact one of quoted-printable
+      and base64. It can be changed with contentTransferEncoding() afterwards.
+
+      This Content takes ownership of @p device, which must be open for reading
+      and not sequential. The data of the device must not change until it is
+      encoded. While a body source is set, body() and decodedContent() are empty.
+      Setting a body or content removes the body source.
+
+      @return false if the device is not usable; this Content does not take
+      ownership in that case.
+      @since 5.23
+    */
+    bool setBodySource(QIODevice *device);
+
+    /**
+      Same as setBodySource(QIODevice *), with the data of the file
+      @p fileName.
+
+      @return false if the file cannot be opened.
+      @since 5.23
+    */
+    bool setBodySource(const QString &fileName);
+
+    /**
+      Returns whether the body of this Content is read from a device, see
+      setBodySource().
+
+      @since 5.23
+    */
+    Q_REQUIRED_RESULT bool hasBodySource() const;
+
     /**
       Returns the MIME preamble.
 
@@ -414,6 +545,14 @@ public:
 
     void setPreamble(const QByteArray &preamble);
 
+    /**
+      Same as setPreamble(const QByteArray &), but takes over the data of
+      @p preamble.
+
+      @since 5.23
+     */
+    void setPreamble(QByteArray &&preamble);
+
     /**
       Returns the MIME preamble.
 
@@ -433,6 +572,14 @@ public:
      */
     void setEpilogue(const QByteArray &epilogue);
 
+    /**
+      Same as setEpilogue(const QByteArray &), but takes over the data of
+      @p epilogue.
+
+      @since 5.23
+     */
+    void setEpilogue(QByteArray &&epilogue);
+
     /**
       Returns a QByteArray containing the encoded Content, including the
       Content header and all sub-Contents.
@@ -457,6 +604,22 @@ public:
      */
     Q_REQUIRED_RESULT QByteArray encodedBody();
 
+    /**
+      Writes the same data as encodedContent() to @p device, which must be
+      open for writing.
+
+      The bodies of Contents with a body source, see setBodySource(), are
+      read and encoded in chunks while they are written, so they are never
+      held in memory as a whole. All other parts are written as by
+      encodedContent().
+
+      @param device the device to write to.
+      @param useCrLf If true, use @ref CRLF instead of @ref LF for linefeeds.
+      @return false if reading a body source or writing to @p device failed.
+      @since 5.23
+    */
+    bool writeEncodedContent(QIODevice *device, bool useCrLf = false);
+
     /**
      * Returns the decoded Content body.
      *
@@ -517,6 +680,22 @@ public:
      */
     Q_REQUIRED_RESULT QVector<Content*> attachments();
 
+    /**
+      Returns how this Content is classified within its MIME tree.
+
+      The classification of all Contents of a tree is computed together by
+      parse() and kept up to date by every modification of the tree: adding,
+      removing or replacing sub-Contents and headers, and modifying the
+      Content-Type or Content-Disposition header. Reading it, here and in the
+      predicates built on it (KMime::isAttachment(), KMime::hasAttachment(),
+      KMime::isSigned(), ... as well as textContent() and attachments()), does
+      not modify the Content, so a parsed message can be queried from several
+      threads at once.
+
+      @since 5.23
+    */
+    Q_REQUIRED_RESULT Classification classification() const;
+
     /**
      * For multipart contents, this will return a list of all multipart child contents.
      * For contents that are of mimetype message/rfc822, this will return a list with one entry,
@@ -696,5 +875,6 @@ template <typename T> bool Content::removeHeader()
 
 } // namespace KMime
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(KMime::Content::Classification)
 Q_DECLARE_METATYPE(KMime::Content*)
 
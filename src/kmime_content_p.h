@@ -8,8 +8,11 @@
 
 //@cond PRIVATE
 
+#include <QIODevice>
 #include <QSharedPointer>
 
+#include <initializer_list>
+
 namespace KMime
 {
 class Message;
@@ -23,7 +26,8 @@ class ContentPrivate
 {
 public:
     explicit ContentPrivate() :
-        frozen(false)
+        frozen(false),
+        classificationDeferred(false)
     {
     }
 
@@ -31,6 +35,7 @@ public:
     {
         qDeleteAll(multipartContents);
         multipartContents.clear();
+        delete bodySource;
     }
 
     bool parseUuencoded(Content *q);
@@ -40,24 +45,86 @@ public:
 
     bool decodeText(Content *q);
 
+    // Streaming of body sources, see Content::writeEncodedContent().
+    void clearBodySource();
+    bool containsBodySource() const;
+    bool writeContent(Content *q, QIODevice *device, bool useCrLf);
+    bool writeBodySource(Content *q, QIODevice *device, bool useCrLf);
+
+    // Copies the raw data, headers and sub-Contents into the empty Content copy,
+    // which still needs to be classified.
+    void cloneInto(Content *copy) const;
+
     // This one returns the normal multipartContents for multipart contents, but returns
     // a list with just bodyAsMessage in it for contents that are encapsulated messages.
     // That makes it possible to handle encapsulated messages in a transparent way.
     QVector<Content*> contents() const;
 
+    Headers::Base *findHeader(const char *type) const;
+    Headers::ContentType *contentTypeHeader() const;
+
+    // The classification of all Contents of a tree is computed at once, by
+    // every modification of the tree that can change it, including a
+    // modified header, see headerModified(). Reading it never writes.
+    enum {
+        TextPartFlag = 0x4000, // mimetype text/*, or no Content-Type at all
+        ContainsTextFlag = 0x8000 // this or one of its sub-Contents is a text part
+    };
+    static quint32 nextGeneration();
+    // Called by the headers of @p q on every modification.
+    static void headerModified(Content *q, const Headers::Base *header);
+    // Classifies the tree of @p q again, unless deferred by ClassificationDeferrer.
+    void updateClassification(Content *q);
+    Content *findTextContent(Content *q) const;
+    void classifyText();
+    void classify(Content *q, Content *mainText, quint32 currentGeneration);
+    bool mainBodyPartIsOneOf(std::initializer_list<const char *> types) const;
+    void collectAttachments(QVector<Content *> &result) const;
+
+    // Content::encodedBody() of a single-part Content is cached. The cache
+    // is cleared for a Content and all its ancestors on any change of its
+    // body or sub-Contents, of the head of one of its sub-Contents, or of
+    // its Content-Type or Content-Transfer-Encoding header.
+    void invalidateEncodedBody(Content *q);
+    bool encodedBodyValid() const;
+
     QByteArray head;
     QByteArray body;
     QByteArray frozenBody;
     QByteArray preamble;
     QByteArray epilogue;
+    QByteArray encodedBody; // null if not cached
     Content *parent = nullptr;
+    QIODevice *bodySource = nullptr; // owned, see Content::setBodySource()
 
     QVector<Content*> multipartContents;
     MessagePtr bodyAsMessage;
 
     QVector<Headers::Base*> headers;
 
+    // the classification pass that last reached this Content
+    quint32 generation = 0;
+    // Content::Classification plus the private flags above; without any
+    // header a Content is text/plain
+    quint16 classification = TextPartFlag | ContainsTextFlag;
+
     bool frozen : 1;
+    bool classificationDeferred : 1; // top-level Content only, see updateClassification()
+};
+
+// Defers the classification of the tree of a Content to the end of a scope
+// that modifies it several times, such as parsing it.
+class ClassificationDeferrer
+{
+public:
+    explicit ClassificationDeferrer(Content *q);
+    ~ClassificationDeferrer();
+
+private:
+    Content *const q;
+    ContentPrivate *const topD;
+    const bool wasDeferred;
+    Q_DISABLE_COPY(ClassificationDeferrer)
 };
 
 }
@@ -0,0 +1,488 @@
+/*
+    kmime_envelope.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the Envelope structure.
+
+  @brief
+  Defines the Envelope structure and extractEnvelope().
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#include "kmime_envelope.h"
+#include "kmime_content.h"
+#include "kmime_header_parsing.h"
+#include "kmime_header_parsing_p.h"
+#include "kmime_util.h"
+
+#include <QDateTime>
+#include <QMap>
+
+#include <cstring>
+
+using namespace KMime;
+using namespace KMime::HeaderParsing;
+
+namespace
+{
+
+enum Field {
+    FieldFrom,
+    FieldSender,
+    FieldTo,
+    FieldCc,
+    FieldBcc,
+    FieldReplyTo,
+    FieldSubject,
+    FieldDate,
+    FieldMessageId,
+    FieldInReplyTo,
+    FieldReferences,
+    FieldContentType,
+    FieldContentDisposition,
+    FieldOther
+};
+
+Field fieldForName(const char *name, int length)
+{
+    static const struct {
+        const char *name;
+        Field field;
+    } fields[] = {
+        {"From", FieldFrom},
+        {"Sender", FieldSender},
+        {"To", FieldTo},
+        {"Cc", FieldCc},
+        {"Bcc", FieldBcc},
+        {"Reply-To", FieldReplyTo},
+        {"Subject", FieldSubject},
+        {"Date", FieldDate},
+        {"Message-ID", FieldMessageId},
+        {"In-Reply-To", FieldInReplyTo},
+        {"References", FieldReferences},
+        {"Content-Type", FieldContentType},
+        {"Content-Disposition", FieldContentDisposition},
+    };
+    for (const auto &f : fields) {
+        if (int(strlen(f.name)) == length && qstrnicmp(name, f.name, length) == 0) {
+            return f.field;
+        }
+    }
+    return FieldOther;
+}
+
+// Walks the header fields starting at @p cursor up to the empty line ending
+// the header block and calls @p handleField with the type and the folded
+// body of each field. Returns the position after the empty line.
+template <typename Handler>
+const char *forEachField(const char *cursor, const char *const end, Handler handleField)
+{
+    const auto nextLineEnd = [end](const char *pos) {
+        const auto lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        return lineEnd ? lineEnd : end;
+    };
+
+    while (cursor < end) {
+        const char *lineEnd = nextLineEnd(cursor);
+        if (lineEnd == cursor || (lineEnd == cursor + 1 && *cursor == '\r')) {
+            return lineEnd < end ? lineEnd + 1 : end; // end of the header block
+        }
+
+        // the field body continues on lines starting with whitespace
+        const char *fieldEnd = lineEnd;
+        while (fieldEnd + 1 < end && (fieldEnd[1] == ' ' || fieldEnd[1] == '\t')) {
+            fieldEnd = nextLineEnd(fieldEnd + 1);
+        }
+
+        const auto colon = static_cast<const char *>(memchr(cursor, ':', lineEnd - cursor));
+        if (colon) {
+            const char *nameEnd = colon;
+            while (nameEnd > cursor && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t')) {
+                --nameEnd; // obsolete syntax allows WSP before the colon
+            }
+            handleField(fieldForName(cursor, nameEnd - cursor), colon + 1, fieldEnd);
+        }
+        cursor = fieldEnd < end ? fieldEnd + 1 : end;
+    }
+    return end;
+}
+
+void appendMailboxes(const char *scursor, const char *const send, Types::Mailbox::List &result)
+{
+    Types::AddressList addresses;
+    if (!parseAddressList(scursor, send, addresses)) {
+        return;
+    }
+    for (const Types::Address &address : std::as_const(addresses)) {
+        result += address.mailboxList;
+    }
+}
+
+QVector<QByteArray> parseIdentifiers(const char *scursor, const char *const send)
+{
+    // same as Headers::Generics::Ident::parse()
+    QVector<QByteArray> result;
+    while (scursor != send) {
+        eatCFWS(scursor, send, false);
+        if (scursor == send) {
+            break;
+        }
+        if (*scursor == ',') {
+            scursor++;
+            continue;
+        }
+        Types::AddrSpec maybeMsgId;
+        if (!parseAngleAddr(scursor, send, maybeMsgId)) {
+            break;
+        }
+        if (!maybeMsgId.isEmpty()) {
+            result.append(maybeMsgId.asString().toLatin1());
+        }
+    }
+    return result;
+}
+
+// The MIME header fields of a message or body part
+struct PartHeader {
+    QByteArray mimeType; // lower case, empty if missing or invalid
+    QMap<QString, QString> typeParameters;
+    bool hasDisposition = false;
+    bool dispositionAttachment = false;
+    QMap<QString, QString> dispositionParameters;
+
+    void parseContentType(const char *scursor, const char *const send)
+    {
+        // same as Headers::ContentType::parse()
+        eatCFWS(scursor, send, false);
+        QPair<const char *, int> maybeMimeType;
+        QPair<const char *, int> maybeSubType;
+        if (!parseToken(scursor, send, maybeMimeType, ParseTokenNoFlag)) {
+            return;
+        }
+        eatCFWS(scursor, send, false);
+        if (scursor == send || *scursor != '/') {
+            return;
+        }
+        scursor++;
+        eatCFWS(scursor, send, false);
+        if (!parseToken(scursor, send, maybeSubType, ParseTokenNoFlag)) {
+            return;
+        }
+        mimeType = QByteArray(maybeMimeType.first, maybeMimeType.second).toLower()
+                   + '/' + QByteArray(maybeSubType.first, maybeSubType.second).toLower();
+
+        eatCFWS(scursor, send, false);
+        if (scursor != send && *scursor == ';') {
+            scursor++;
+            QByteArray charset;
+            if (!parseParameterListWithCharset(scursor, send, typeParameters, charset)) {
+                typeParameters.clear();
+            }
+        }
+    }
+
+    void parseContentDisposition(const char *scursor, const char *const send)
+    {
+        // same as Headers::ContentDisposition::parse()
+        eatCFWS(scursor, send, false);
+        QPair<const char *, int> maybeToken;
+        if (!parseToken(scursor, send, maybeToken, ParseTokenNoFlag)) {
+            return;
+        }
+        const QByteArray token = QByteArray(maybeToken.first, maybeToken.second).toLower();
+        if (token != "inline" && token != "attachment") {
+            return;
+        }
+        hasDisposition = true;
+        dispositionAttachment = token == "attachment";
+
+        eatCFWS(scursor, send, false);
+        if (scursor != send && *scursor == ';') {
+            scursor++;
+            QByteArray charset;
+            if (!parseParameterListWithCharset(scursor, send, dispositionParameters, charset)) {
+                dispositionParameters.clear();
+            }
+        }
+    }
+
+    bool isMultipart() const
+    {
+        return mimeType.startsWith("multipart/");
+    }
+
+    bool isText() const
+    {
+        return mimeType.isEmpty() || mimeType.startsWith("text/");
+    }
+
+    QByteArray subType() const
+    {
+        return mimeType.mid(mimeType.indexOf('/') + 1);
+    }
+
+    // see KMime::isCryptoPart()
+    bool isCryptoPart() const
+    {
+        if (!mimeType.startsWith("application/")) {
+            return false;
+        }
+        const QByteArray sub = subType();
+        if (sub == "pgp-encrypted" || sub == "pgp-signature" ||
+            sub == "pkcs7-mime" || sub == "x-pkcs7-mime" ||
+            sub == "pkcs7-signature" || sub == "x-pkcs7-signature") {
+            return true;
+        }
+        if (sub == "octet-stream" && hasDisposition) {
+            const QString fileName = dispositionParameters.value(QStringLiteral("filename")).toLower();
+            return fileName == QLatin1String("msg.asc") || fileName == QLatin1String("encrypted.asc");
+        }
+        return false;
+    }
+
+    // see KMime::isAttachment(), @p mainText tells whether this is the main body part
+    bool isAttachment(bool mainText) const
+    {
+        if (isMultipart()) {
+            return false;
+        }
+        if (mimeType == "message/rfc822") {
+            return true;
+        }
+        if (mainText || isCryptoPart()) {
+            return false;
+        }
+        return !dispositionParameters.value(QStringLiteral("filename")).isEmpty() ||
+               !typeParameters.value(QStringLiteral("name")).isEmpty() ||
+               dispositionAttachment;
+    }
+
+    // see KMime::isSigned(), KMime::isEncrypted()
+    bool isSignedType() const
+    {
+        return mimeType == "multipart/signed" || mimeType == "application/pgp-signature" ||
+               mimeType == "application/pkcs7-signature" || mimeType == "application/x-pkcs7-signature";
+    }
+    bool isEncryptedType() const
+    {
+        return mimeType == "multipart/encrypted" || mimeType == "application/pgp-encrypted" ||
+               mimeType == "application/pkcs7-mime" || mimeType == "application/x-pkcs7-mime";
+    }
+};
+
+// A multipart whose body parts are being scanned
+struct Container {
+    QByteArray delimiter; // "--" boundary
+    bool alternative = false;
+    bool onMainPath = false; // reached by Message::mainBodyPart()
+    bool countsAttachments = true; // not inside a multipart/related
+    int partCount = 0;
+};
+
+const char *lineEndOf(const char *pos, const char *const end)
+{
+    const auto lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos));
+    return lineEnd ? lineEnd : end;
+}
+
+// Returns the container a delimiter line belongs to, or -1.
+int delimitedContainer(const QVector<Container> &containers, const char *line, const char *lineEnd, bool *closing)
+{
+    while (lineEnd > line && (lineEnd[-1] == '\r' || lineEnd[-1] == ' ' || lineEnd[-1] == '\t')) {
+        --lineEnd;
+    }
+    const int length = lineEnd - line;
+    for (int i = containers.size() - 1; i >= 0; --i) {
+        const QByteArray &delimiter = containers.at(i).delimiter;
+        if (length < delimiter.size() || memcmp(line, delimiter.constData(), delimiter.size()) != 0) {
+            continue;
+        }
+        if (length == delimiter.size()) {
+            *closing = false;
+            return i;
+        }
+        if (length == delimiter.size() + 2 && line[length - 2] == '-' && line[length - 1] == '-') {
+            *closing = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+namespace KMime
+{
+
+Envelope extractEnvelope(const QByteArray &raw)
+{
+    Envelope envelope;
+    PartHeader top;
+
+    const char *const end = raw.constData() + raw.size();
+    const char *bodyStart = forEachField(raw.constData(), end,
+                                         [&envelope, &top](Field field, const char *fieldBody, const char *fieldEnd) {
+        if (field == FieldOther) {
+            return;
+        }
+        const QByteArray value = unfoldHeader(fieldBody, fieldEnd - fieldBody);
+        const char *scursor = value.constData();
+        const char *const send = scursor + value.size();
+
+        switch (field) {
+        case FieldFrom:
+            appendMailboxes(scursor, send, envelope.from);
+            break;
+        case FieldSender: {
+            Types::Mailbox::List senders;
+            appendMailboxes(scursor, send, senders);
+            if (!senders.isEmpty()) {
+                envelope.sender = senders.constFirst();
+            }
+            break;
+        }
+        case FieldTo:
+            appendMailboxes(scursor, send, envelope.to);
+            break;
+        case FieldCc:
+            appendMailboxes(scursor, send, envelope.cc);
+            break;
+        case FieldBcc:
+            appendMailboxes(scursor, send, envelope.bcc);
+            break;
+        case FieldReplyTo:
+            appendMailboxes(scursor, send, envelope.replyTo);
+            break;
+        case FieldSubject: {
+            QByteArray usedCS;
+            envelope.subject = decodeRFC2047Text(value.trimmed(), usedCS, Content::defaultCharset());
+            break;
+        }
+        case FieldDate: {
+            QDateTime dateTime;
+            if (parseDateTime(scursor, send, dateTime) && dateTime.isValid()) {
+                envelope.date = dateTime.toSecsSinceEpoch();
+            }
+            break;
+        }
+        case FieldMessageId: {
+            const auto ids = parseIdentifiers(scursor, send);
+            if (!ids.isEmpty()) {
+                envelope.messageId = ids.constFirst();
+            }
+            break;
+        }
+        case FieldInReplyTo:
+            envelope.inReplyTo = parseIdentifiers(scursor, send);
+            break;
+        case FieldReferences:
+            envelope.references = parseIdentifiers(scursor, send);
+            break;
+        case FieldContentType:
+            top.parseContentType(scursor, send);
+            break;
+        case FieldContentDisposition:
+            top.parseContentDisposition(scursor, send);
+            break;
+        case FieldOther:
+            break;
+        }
+    });
+
+    envelope.contentType = top.mimeType;
+
+    const auto subType = top.subType();
+    envelope.isSigned = subType == "signed" || subType == "pgp-signature" ||
+                        subType == "pkcs7-signature" || subType == "x-pkcs7-signature";
+    envelope.isEncrypted = subType == "encrypted" || subType == "pgp-encrypted" ||
+                           subType == "pkcs7-mime" || subType == "x-pkcs7-mime";
+
+    const QString topBoundary = top.typeParameters.value(QStringLiteral("boundary"));
+    if (!top.isMultipart() || topBoundary.isEmpty()) {
+        // single part, the top level Content is its own main body part
+        envelope.hasAttachment = top.isAttachment(false);
+        envelope.isSigned = envelope.isSigned || top.isSignedType();
+        envelope.isEncrypted = envelope.isEncrypted || top.isEncryptedType();
+        return envelope;
+    }
+
+    // Scan the body for the delimiter lines of all nested multiparts and
+    // classify each body part by its header
+    QVector<Container> containers;
+    Container topContainer;
+    topContainer.delimiter = "--" + topBoundary.toLatin1();
+    topContainer.alternative = top.subType() == "alternative";
+    topContainer.onMainPath = true;
+    topContainer.countsAttachments = top.subType() != "related";
+    containers.append(topContainer);
+
+    bool seenText = false;
+    const char *cursor = bodyStart;
+    while (cursor < end && !containers.isEmpty()) {
+        const char *lineEnd = lineEndOf(cursor, end);
+        bool closing = false;
+        const int index = (*cursor == '-') ? delimitedContainer(containers, cursor, lineEnd, &closing) : -1;
+        cursor = lineEnd < end ? lineEnd + 1 : end;
+        if (index == -1) {
+            continue;
+        }
+
+        // a delimiter also ends all multiparts nested in the current part
+        containers.resize(index + 1);
+        if (closing) {
+            containers.removeLast();
+            continue;
+        }
+
+        Container &container = containers.last();
+        PartHeader part;
+        cursor = forEachField(cursor, end, [&part](Field field, const char *fieldBody, const char *fieldEnd) {
+            if (field == FieldContentType || field == FieldContentDisposition) {
+                const QByteArray value = unfoldHeader(fieldBody, fieldEnd - fieldBody);
+                if (field == FieldContentType) {
+                    part.parseContentType(value.constData(), value.constData() + value.size());
+                } else {
+                    part.parseContentDisposition(value.constData(), value.constData() + value.size());
+                }
+            }
+        });
+
+        // the main body part is the first text part, see Content::textContent()
+        const bool mainText = !seenText && part.isText();
+        seenText = seenText || part.isText();
+
+        const bool onMainPath = container.onMainPath && (container.partCount == 0 || container.alternative);
+        ++container.partCount;
+        if (onMainPath && (!part.isMultipart() || container.alternative)) {
+            envelope.isSigned = envelope.isSigned || part.isSignedType();
+            envelope.isEncrypted = envelope.isEncrypted || part.isEncryptedType();
+        }
+
+        if (container.countsAttachments && part.isAttachment(mainText)) {
+            envelope.hasAttachment = true;
+        }
+
+        const QString boundary = part.typeParameters.value(QStringLiteral("boundary"));
+        if (part.isMultipart() && !boundary.isEmpty()) {
+            Container nested;
+            nested.delimiter = "--" + boundary.toLatin1();
+            nested.alternative = part.subType() == "alternative";
+            nested.onMainPath = onMainPath && !container.alternative;
+            nested.countsAttachments = container.countsAttachments && part.subType() != "related";
+            containers.append(nested);
+        }
+    }
+
+    return envelope;
+}
+
+} // namespace KMime
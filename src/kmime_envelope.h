@@ -0,0 +1,80 @@
+/*
+    kmime_envelope.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the Envelope structure.
+
+  @brief
+  Defines the Envelope structure and extractEnvelope().
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+#include "kmime_types.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace KMime
+{
+
+/**
+  @brief
+  The fields of a message that are needed to list it, as extracted by
+  extractEnvelope().
+
+  @since 5.23
+*/
+struct KMIME_EXPORT Envelope {
+    Types::Mailbox::List from;
+    Types::Mailbox sender;
+    Types::Mailbox::List to;
+    Types::Mailbox::List cc;
+    Types::Mailbox::List bcc;
+    Types::Mailbox::List replyTo;
+    /** The decoded Subject. */
+    QString subject;
+    /** The Date in seconds since the epoch, 0 if missing or invalid. */
+    qint64 date = 0;
+    /** The Message-ID, without angle brackets. */
+    QByteArray messageId;
+    QVector<QByteArray> inReplyTo;
+    QVector<QByteArray> references;
+    /** The mimetype of the message, in lower case; empty if not given. */
+    QByteArray contentType;
+    /** Same as KMime::hasAttachment() on the parsed message. */
+    bool hasAttachment = false;
+    /** Same as KMime::isSigned() on the parsed message. */
+    bool isSigned = false;
+    /** Same as KMime::isEncrypted() on the parsed message. */
+    bool isEncrypted = false;
+};
+
+/**
+  Extracts the Envelope of the message @p raw in one forward pass, without
+  creating a Message.
+
+  The header fields are parsed with the same HeaderParsing functions the
+  Headers classes use. For multipart messages the headers of the body parts
+  are scanned to determine the hasAttachment, isSigned and isEncrypted flags;
+  the body of an encapsulated message/rfc822 part is not looked into.
+
+  @param raw the complete message, with LF or CRLF line endings.
+  @since 5.23
+*/
+Q_REQUIRED_RESULT KMIME_EXPORT Envelope extractEnvelope(const QByteArray &raw);
+
+} // namespace KMime
+
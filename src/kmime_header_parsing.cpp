@@ -8,9 +8,12 @@
 */
 
 #include "kmime_header_parsing.h"
+#include "kmime_header_parsing_p.h"
 
+#include "kmime_charsetconversion_p.h"
 #include "kmime_headerfactory_p.h"
 #include "kmime_headers.h"
+#include "kmime_headers_p.h"
 #include "kmime_util.h"
 #include "kmime_util_p.h"
 #include "kmime_codecs.h"
@@ -25,8 +28,11 @@
 #include <QTextCodec>
 #include <QMap>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cctype> // for isdigit
+#include <cstring>
 
 using namespace KMime;
 using namespace KMime::Types;
@@ -47,11 +53,12 @@ namespace KMime
 namespace HeaderParsing
 {
 
-// parse the encoded-word (scursor points to after the initial '=')
-bool parseEncodedWord(const char *&scursor, const char *const send,
-                      QString &result, QByteArray &language,
-                      QByteArray &usedCS, const QByteArray &defaultCS,
-                      bool forceCS)
+// decode the encoded-word (scursor points to after the initial '=') into
+// the bytes of its encoded-text, in the charset of textCodec
+static bool decodeEncodedWord(const char *&scursor, const char *const send,
+                              QByteArray &result, QTextCodec *&textCodec,
+                              QByteArray &language, QByteArray &usedCS,
+                              const QByteArray &defaultCS, bool forceCS)
 {
     // make sure the caller already did a bit of the work.
     assert(*(scursor - 1) == '=');
@@ -183,7 +190,7 @@ bool parseEncodedWord(const char *&scursor, const char *const send,
 
     // try if there's a (text)codec for the charset found:
     bool matchOK = false;
-    QTextCodec *textCodec = nullptr;
+    textCodec = nullptr;
     if (forceCS || maybeCharset.isEmpty()) {
         textCodec = KCharsets::charsets()->codecForName(QLatin1String(defaultCS), matchOK);
         usedCS = cachedCharset(defaultCS);
@@ -222,9 +229,9 @@ bool parseEncodedWord(const char *&scursor, const char *const send,
                    << encodedTextLength << ")\nresult may be truncated";
     }
 
-    result = textCodec->toUnicode(buffer.data(), bbegin - buffer.data());
+    buffer.truncate(bbegin - buffer.data());
+    result = buffer;
 
-    // qCDebug(KMIME_LOG) << "result now: \"" << result << "\"";
     // cleanup:
     delete dec;
     language = maybeLanguage;
@@ -232,6 +239,115 @@ bool parseEncodedWord(const char *&scursor, const char *const send,
     return true;
 }
 
+// parse the encoded-word (scursor points to after the initial '=')
+bool parseEncodedWord(const char *&scursor, const char *const send,
+                      QString &result, QByteArray &language,
+                      QByteArray &usedCS, const QByteArray &defaultCS,
+                      bool forceCS)
+{
+    QByteArray buffer;
+    QTextCodec *textCodec = nullptr;
+    if (!decodeEncodedWord(scursor, send, buffer, textCodec, language, usedCS, defaultCS, forceCS)) {
+        return false;
+    }
+    result = CharsetConversion::toUnicode(textCodec, buffer);
+    // qCDebug(KMIME_LOG) << "result now: \"" << result << "\"";
+    return true;
+}
+
+// Decodes text between encoded-words, which is usually US-ASCII.
+static QString decodePlainText(const char *begin, const char *end, const QByteArray &defaultCS)
+{
+    if (std::all_of(begin, end, [](char c) { return uchar(c) < 128; })) {
+        return QString::fromLatin1(begin, end - begin);
+    }
+    QByteArray usedCS;
+    return KCodecs::decodeRFC2047String(QByteArray(begin, end - begin), &usedCS, defaultCS);
+}
+
+// Returns the length of the whitespace at @p cursor.
+static int whiteSpaceLength(const char *cursor, const char *const send)
+{
+    const char *p = cursor;
+    while (p != send && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        ++p;
+    }
+    return p - cursor;
+}
+
+QString decodeRFC2047Text(const QByteArray &src, QByteArray &usedCS, const QByteArray &defaultCS)
+{
+    // Adjacent encoded-words in the same charset are decoded into one buffer
+    // and converted together, so that characters split between them survive
+    // (rfc2047, 5). Without any encoded-word, KCodecs does all the work.
+    const char *const begin = src.constData();
+    const char *const send = begin + src.size();
+    QString result;
+    QByteArray wordsCS; // the charset of the encoded-words, UTF-8 if mixed
+    bool decodedWord = false;
+    const char *plainStart = begin; // the text before the next encoded-word
+    const char *cursor = begin;
+    while ((cursor = static_cast<const char *>(memchr(cursor, '=', send - cursor)))) {
+        QByteArray bytes;
+        QTextCodec *textCodec = nullptr;
+        QByteArray language;
+        QByteArray charset;
+        const char *wordEnd = cursor + 1;
+        if (wordEnd == send || *wordEnd != '?'
+            || !decodeEncodedWord(wordEnd, send, bytes, textCodec, language, charset, defaultCS, false)) {
+            ++cursor;
+            continue;
+        }
+
+        // the text before this encoded-word
+        if (plainStart != cursor) {
+            result += decodePlainText(plainStart, cursor, defaultCS);
+        }
+
+        // the following encoded-words in the same charset, only separated
+        // by whitespace
+        const char *next = wordEnd + whiteSpaceLength(wordEnd, send);
+        bool nextIsWord = false;
+        while (next != send && *next == '=') {
+            QByteArray moreBytes;
+            QTextCodec *moreTextCodec = nullptr;
+            QByteArray moreCS;
+            const char *moreEnd = next + 1;
+            if (moreEnd == send || *moreEnd != '?'
+                || !decodeEncodedWord(moreEnd, send, moreBytes, moreTextCodec, language, moreCS, defaultCS, false)) {
+                break;
+            }
+            if (moreTextCodec != textCodec) {
+                nextIsWord = true;
+                break;
+            }
+            bytes += moreBytes;
+            wordEnd = moreEnd;
+            next = wordEnd + whiteSpaceLength(wordEnd, send);
+        }
+        result += CharsetConversion::toUnicode(textCodec, bytes);
+        if (!decodedWord) {
+            wordsCS = charset;
+            decodedWord = true;
+        } else if (wordsCS != charset) {
+            // like KCodecs, report the superset charset for mixed ones
+            wordsCS = QByteArrayLiteral("UTF-8");
+        }
+
+        // whitespace between adjacent encoded-words is ignored (rfc2047, 6.2)
+        plainStart = cursor = nextIsWord ? next : wordEnd;
+    }
+
+    if (!decodedWord) {
+        return KCodecs::decodeRFC2047String(src, &usedCS, defaultCS);
+    }
+    if (plainStart != send) {
+        result += decodePlainText(plainStart, send, defaultCS);
+    }
+    usedCS = wordsCS;
+    return result;
+}
+
 static inline void eatWhiteSpace(const char *&scursor, const char *const send)
 {
     while (scursor != send &&
@@ -559,9 +675,23 @@ bool parsePhrase(const char *&scursor, const char *const send,
     // used to suppress whitespace between adjacent encoded-words
     // (rfc2047, 6.2):
     bool lastWasEncodedWord = false;
+    // adjacent encoded-words in the same charset are converted together,
+    // so that characters split between them survive (rfc2047, 5):
+    QByteArray encodedBytes;
+    QTextCodec *encodedTextCodec = nullptr;
+    const auto flushEncodedWords = [&]() {
+        if (encodedTextCodec) {
+            result += CharsetConversion::toUnicode(encodedTextCodec, encodedBytes);
+            encodedBytes.clear();
+            encodedTextCodec = nullptr;
+        }
+    };
 
     while (scursor != send) {
         char ch = *scursor++;
+        if (ch != '=') {
+            flushEncodedWords();
+        }
         switch (ch) {
         case '.': // broken, but allow for intorop's sake
             if (found == None) {
@@ -626,13 +756,17 @@ bool parsePhrase(const char *&scursor, const char *const send,
                 }
             }
             break;
-        case '=': // encoded-word
-            tmp.clear();
+        case '=': { // encoded-word
             oldscursor = scursor;
             lang.clear();
             charset.clear();
-            if (parseEncodedWord(scursor, send, tmp, lang, charset)) {
+            QByteArray bytes;
+            QTextCodec *textCodec = nullptr;
+            if (decodeEncodedWord(scursor, send, bytes, textCodec, lang, charset, QByteArray(), false)) {
                 successfullyParsed = scursor;
+                if (!lastWasEncodedWord || textCodec != encodedTextCodec) {
+                    flushEncodedWords();
+                }
                 switch (found) {
                 case None:
                     found = EncodedWord;
@@ -649,12 +783,15 @@ bool parsePhrase(const char *&scursor, const char *const send,
                 default: assert(0);
                 }
                 lastWasEncodedWord = true;
-                result += tmp;
+                encodedBytes += bytes;
+                encodedTextCodec = textCodec;
                 break;
             } else {
                 // parse as atom:
                 scursor = oldscursor;
+                flushEncodedWords();
             }
+        }
             Q_FALLTHROUGH();
             // fall though...
 
@@ -690,6 +827,7 @@ bool parsePhrase(const char *&scursor, const char *const send,
         eatWhiteSpace(scursor, send);
     }
 
+    flushEncodedWords();
     return found != None;
 }
 
@@ -1221,6 +1359,343 @@ bool parseAddressList(const char *&scursor, const char *const send,
     return true;
 }
 
+// Skips an encoded-word at @p scursor if all its parts consist of atext,
+// so that it cannot reach beyond the phrase it is in.
+static bool skipPlainEncodedWord(const char *&scursor, const char *const send)
+{
+    // "=?" charset "?" encoding "?" encoded-text "?="
+    const char *p = scursor + 2;
+    for (int part = 0; part < 3; ++part) {
+        const char *const partBegin = p;
+        while (p != send && *p != '?' && isAText(*p)) {
+            ++p;
+        }
+        if (p == send || *p != '?' || (part < 2 && p == partBegin)) {
+            return false;
+        }
+        ++p;
+    }
+    if (p == send || *p != '=') {
+        return false;
+    }
+    scursor = p + 1;
+    return true;
+}
+
+bool CompactMailboxList::parseSpans(const char *begin, const char *&scursor, const char *const send, Entry &entry)
+{
+    const auto isSpace = [](char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    };
+    const auto skipSpace = [&](const char *p) {
+        while (p != send && isSpace(*p)) {
+            ++p;
+        }
+        return p;
+    };
+    // local-part "@" domain, both dot-atoms without any CFWS, the domain
+    // maybe ending with a dot like in parseDomain()
+    const auto parsePlainAddrSpec = [&](const char *&p) {
+        const char *const localBegin = p;
+        while (p != send && (*p == '.' || isAText(*p))) {
+            ++p;
+        }
+        if (p == localBegin || p == send || *p != '@') {
+            return false;
+        }
+        entry.atSign = p - begin;
+        ++p;
+        if (p == send || !isAText(*p)) {
+            return false;
+        }
+        while (true) {
+            while (p != send && isAText(*p)) {
+                ++p;
+            }
+            if (p == send || *p != '.') {
+                break;
+            }
+            ++p;
+            if (p == send || !isAText(*p)) {
+                break;
+            }
+        }
+        // a second dot would end the domain in the middle
+        return p == send || *p != '.';
+    };
+
+    entry = Entry();
+    const char *p = skipSpace(scursor);
+
+    // a bare addr-spec:
+    const char *addrSpecEnd = p;
+    entry.addressBegin = p - begin;
+    if (parsePlainAddrSpec(addrSpecEnd)) {
+        // the obsolete display-name as comment is left to parseMailbox()
+        const char *const next = skipSpace(addrSpecEnd);
+        if (next != send && *next == '(') {
+            return false;
+        }
+        entry.addressEnd = addrSpecEnd - begin;
+        scursor = addrSpecEnd;
+        return true;
+    }
+
+    // [display-name] angle-addr, the display-name consisting of atoms,
+    // dots, quoted-strings and encoded-words:
+    const char *const nameBegin = p;
+    bool atWordStart = true;
+    while (p != send && *p != '<') {
+        const char ch = *p;
+        if (isSpace(ch) || ch == '.') {
+            if (ch == '.' && p == nameBegin) {
+                return false;
+            }
+            ++p;
+            atWordStart = true;
+        } else if (ch == '"') {
+            for (++p; p != send && *p != '"'; ++p) {
+                if (*p == '\\' && ++p == send) {
+                    return false;
+                }
+                if (*p == '\r' || *p == '\n') {
+                    return false;
+                }
+            }
+            if (p == send) {
+                return false;
+            }
+            ++p;
+            atWordStart = true;
+        } else if (atWordStart && ch == '=' && p + 1 != send && p[1] == '?') {
+            if (!skipPlainEncodedWord(p, send)) {
+                return false;
+            }
+        } else if (isAText(ch) || static_cast<signed char>(ch) < 0) {
+            ++p;
+            atWordStart = false;
+        } else {
+            return false;
+        }
+    }
+    if (p == send) {
+        return false;
+    }
+    entry.nameBegin = nameBegin - begin;
+    entry.nameEnd = p - begin;
+
+    p = skipSpace(p + 1);
+    entry.addressBegin = p - begin;
+    if (!parsePlainAddrSpec(p)) {
+        return false;
+    }
+    entry.addressEnd = p - begin;
+    p = skipSpace(p);
+    if (p == send || *p != '>') {
+        return false;
+    }
+    ++p;
+    const char *const next = skipSpace(p);
+    if (next != send && *next == '(') {
+        return false;
+    }
+    scursor = p;
+    return true;
+}
+
+CompactMailboxList::CompactMailboxList(const CompactMailboxList &other)
+    : value(other.value)
+    , entries(other.entries)
+    , parsed(other.parsed)
+    , emptyGroups(other.emptyGroups)
+    , isCRLF(other.isCRLF)
+{
+}
+
+CompactMailboxList &CompactMailboxList::operator=(const CompactMailboxList &other)
+{
+    if (this != &other) {
+        clearDecoded();
+        value = other.value;
+        entries = other.entries;
+        parsed = other.parsed;
+        emptyGroups = other.emptyGroups;
+        isCRLF = other.isCRLF;
+    }
+    return *this;
+}
+
+CompactMailboxList &CompactMailboxList::operator=(CompactMailboxList &&other) noexcept
+{
+    clearDecoded();
+    value = std::move(other.value);
+    entries = std::move(other.entries);
+    parsed = std::move(other.parsed);
+    decodedList.storeRelaxed(other.decodedList.fetchAndStoreRelaxed(nullptr));
+    emptyGroups = other.emptyGroups;
+    isCRLF = other.isCRLF;
+    return *this;
+}
+
+CompactMailboxList::~CompactMailboxList()
+{
+    clearDecoded();
+}
+
+bool CompactMailboxList::parse(const char *&scursor, const char *const send, bool isCRLF, QStringList *groupNames)
+{
+    // the same loop as parseAddressList(), on a copy the spans refer to
+    CompactMailboxList result;
+    result.value = QByteArray(scursor, send - scursor);
+    result.isCRLF = isCRLF;
+    const char *const begin = result.value.constData();
+    const char *const end = begin + result.value.size();
+    const char *cursor = begin;
+    bool hasSpans = false;
+
+    while (cursor != end) {
+        eatCFWS(cursor, end, isCRLF);
+        if (cursor == end) {
+            break;
+        }
+        // empty entry, or ';' as delimiter of broken clients: ignore
+        if (*cursor == ',' || *cursor == ';') {
+            cursor++;
+            continue;
+        }
+
+        Entry entry;
+        if (parseSpans(begin, cursor, end, entry)) {
+            result.entries.append(entry);
+            hasSpans = true;
+        } else {
+            Address maybeAddress;
+            if (!parseAddress(cursor, end, maybeAddress, isCRLF)) {
+                scursor += cursor - begin;
+                return false;
+            }
+            if (groupNames && !maybeAddress.displayName.isEmpty()) {
+                groupNames->append(maybeAddress.displayName);
+            }
+            for (const Mailbox &mbox : std::as_const(maybeAddress.mailboxList)) {
+                result.append(mbox);
+            }
+            if (maybeAddress.mailboxList.isEmpty()) {
+                result.emptyGroups++;
+            }
+        }
+
+        eatCFWS(cursor, end, isCRLF);
+        if (cursor == end) {
+            break;
+        }
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+
+    scursor += cursor - begin;
+    if (!hasSpans) {
+        result.value.clear();
+    }
+    *this = std::move(result);
+    return true;
+}
+
+void CompactMailboxList::append(const Mailbox &mailbox)
+{
+    clearDecoded();
+    Entry entry;
+    entry.mailbox = parsed.size();
+    entries.append(entry);
+    parsed.append(mailbox);
+}
+
+void CompactMailboxList::clear()
+{
+    clearDecoded();
+    value.clear();
+    entries.clear();
+    parsed.clear();
+    emptyGroups = 0;
+}
+
+QByteArray CompactMailboxList::address(int i) const
+{
+    const Entry &entry = entries.at(i);
+    if (entry.mailbox >= 0) {
+        return parsed.at(entry.mailbox).address();
+    }
+    return value.mid(entry.addressBegin, entry.addressEnd - entry.addressBegin);
+}
+
+QString CompactMailboxList::displayName(const Entry &entry) const
+{
+    // as parseMailbox() does it
+    QString phrase;
+    if (entry.nameBegin != entry.nameEnd) {
+        const char *cursor = value.constData() + entry.nameBegin;
+        parsePhrase(cursor, value.constData() + entry.nameEnd, phrase, isCRLF);
+    }
+    return stripQuotes(phrase);
+}
+
+const Mailbox::List &CompactMailboxList::decoded() const
+{
+    if (const Mailbox::List *list = decodedList.loadAcquire()) {
+        return *list;
+    }
+
+    auto list = new Mailbox::List;
+    list->reserve(entries.size());
+    for (const Entry &entry : entries) {
+        if (entry.mailbox >= 0) {
+            list->append(parsed.at(entry.mailbox));
+            continue;
+        }
+        AddrSpec addrSpec;
+        addrSpec.localPart = QString::fromLatin1(value.constData() + entry.addressBegin, entry.atSign - entry.addressBegin);
+        addrSpec.domain = QString::fromLatin1(value.constData() + entry.atSign + 1, entry.addressEnd - entry.atSign - 1);
+        Mailbox mbox;
+        mbox.setAddress(addrSpec);
+        mbox.setName(displayName(entry));
+        list->append(mbox);
+    }
+    // another thread may have been faster
+    if (!decodedList.testAndSetOrdered(nullptr, list)) {
+        delete list;
+    }
+    return *decodedList.loadAcquire();
+}
+
+void CompactMailboxList::clearDecoded()
+{
+    delete decodedList.fetchAndStoreRelaxed(nullptr);
+}
+
+QString CompactMailboxList::name(int i) const
+{
+    const Entry &entry = entries.at(i);
+    if (entry.mailbox >= 0) {
+        return parsed.at(entry.mailbox).name();
+    }
+    return decoded().at(i).name();
+}
+
+Mailbox CompactMailboxList::mailbox(int i) const
+{
+    const Entry &entry = entries.at(i);
+    if (entry.mailbox >= 0) {
+        return parsed.at(entry.mailbox);
+    }
+    return decoded().at(i);
+}
+
+Mailbox::List CompactMailboxList::mailboxes() const
+{
+    return decoded();
+}
+
 static bool parseParameter(const char *&scursor, const char *const send,
                            QPair<QString, QStringOrQPair> &result, bool isCRLF)
 {
@@ -1304,11 +1779,49 @@ static bool parseParameter(const char *&scursor, const char *const send,
     return true;
 }
 
+namespace {
+
+// A parameter of a parameter list before rfc2231 decoding and
+// concatenation, see parseRawParameterList().
+struct RawParameter {
+    QString name; // without the section and the trailing asterisk
+    int section = -1; // the number of the rfc2231 section, -1 if not continued
+    bool encoded = false; // rfc2231 extended-value, i.e. trailing asterisk
+    Types::QStringOrQPair value;
+};
+
+// Splits an attribute as returned by parseParameter() into its name,
+// section number and encoding flag.
+void splitAttribute(const QString &attribute, RawParameter &parameter)
+{
+    parameter.name = attribute;
+    if (parameter.name.endsWith(QLatin1Char('*'))) {
+        parameter.name.chop(1);
+        parameter.encoded = true;
+    }
+    const int star = parameter.name.lastIndexOf(QLatin1Char('*'));
+    if (star < 0 || star == parameter.name.size() - 1) {
+        return;
+    }
+    int section = 0;
+    for (int i = star + 1; i < parameter.name.size(); ++i) {
+        const QChar c = parameter.name.at(i);
+        if (c < QLatin1Char('0') || c > QLatin1Char('9') || section > 9999) {
+            return; // not a section number, part of the name
+        }
+        section = section * 10 + (c.unicode() - '0');
+    }
+    parameter.section = section;
+    parameter.name.truncate(star);
+}
+
+} // namespace
+
 static bool parseRawParameterList(const char *&scursor, const char *const send,
-                                  QMap<QString, QStringOrQPair> &result,
+                                  QVector<RawParameter> &result,
                                   bool isCRLF)
 {
-    // we use parseParameter() consecutively to obtain a map of raw
+    // we use parseParameter() consecutively to obtain a list of raw
     // attributes to raw values. "Raw" here means that we don't do
     // rfc2231 decoding and concatenation. This is left to
     // parseParameterList(), which will call this function.
@@ -1352,7 +1865,10 @@ static bool parseRawParameterList(const char *&scursor, const char *const send,
             continue;
         }
         // successful parsing brings us here:
-        result.insert(maybeParameter.first, maybeParameter.second);
+        RawParameter parameter;
+        splitAttribute(maybeParameter.first, parameter);
+        parameter.value = maybeParameter.second;
+        result.append(parameter);
 
         eatCFWS(scursor, send, isCRLF);
         // end of header: ends list.
@@ -1367,119 +1883,149 @@ static bool parseRawParameterList(const char *&scursor, const char *const send,
     return true;
 }
 
-static void decodeRFC2231Value(KCodecs::Codec *&rfc2231Codec,
-                               QTextCodec *&textcodec,
-                               bool isContinuation, QString &value,
-                               QPair<const char *, int> &source, QByteArray &charset)
+// Appends the rfc2231 percent-encoded @p data to @p buffer, decoded.
+// Malformed escapes are kept as they are.
+static void appendPercentDecoded(const char *data, int len, QByteArray &buffer)
 {
-    //
-    // parse the raw value into (charset,language,text):
-    //
+    static const auto hexValues = [] {
+        std::array<qint8, 256> values;
+        values.fill(-1);
+        for (int i = 0; i < 10; ++i) {
+            values['0' + i] = i;
+        }
+        for (int i = 0; i < 6; ++i) {
+            values['a' + i] = values['A' + i] = 10 + i;
+        }
+        return values;
+    }();
+
+    const char *const end = data + len;
+    const int start = buffer.size();
+    buffer.resize(start + len); // decoding never makes it longer
+    char *out = buffer.data() + start;
+    while (data != end) {
+        if (*data == '%' && end - data > 2) {
+            const int high = hexValues[uchar(data[1])];
+            const int low = hexValues[uchar(data[2])];
+            if (high >= 0 && low >= 0) {
+                *out++ = char(high << 4 | low);
+                data += 3;
+                continue;
+            }
+        }
+        *out++ = *data++;
+    }
+    buffer.truncate(out - buffer.constData());
+}
 
-    const char *decBegin = source.first;
-    const char *decCursor = decBegin;
-    const char *decEnd = decCursor + source.second;
+// Returns the raw, undecoded bytes of a parameter value.
+static QByteArray rawValue(const Types::QStringOrQPair &value)
+{
+    if (value.qpair.first) {
+        return QByteArray(value.qpair.first, value.qpair.second);
+    }
+    return value.qstring.toLatin1();
+}
 
-    if (!isContinuation) {
-        // find the first single quote
-        while (decCursor != decEnd) {
-            if (*decCursor == '\'') {
-                break;
-            } else {
-                decCursor++;
-            }
+// Returns the raw value as QString, for values that are not rfc2231 decoded.
+static QString plainValue(const Types::QStringOrQPair &value)
+{
+    if (value.qpair.first) {
+        return QString::fromLatin1(value.qpair.first, value.qpair.second);
+    }
+    return value.qstring;
+}
+
+// Decodes and concatenates the sections [begin, end) of one parameter,
+// which are sorted by their section number.
+static QString decodeParameterValue(const RawParameter *begin, const RawParameter *end,
+                                    QByteArray &charset)
+{
+    const bool encoded = std::any_of(begin, end, [](const RawParameter &parameter) {
+        return parameter.encoded;
+    });
+    if (!encoded) {
+        QString value;
+        bool rfc2047 = false;
+        for (const RawParameter *it = begin; it != end; ++it) {
+            value += plainValue(it->value);
+            // rfc2047 encoded-words in quoted-strings, as sent by some
+            // clients instead of rfc2231
+            rfc2047 = rfc2047 || (!it->value.qstring.isNull() && it->value.qstring.contains(QLatin1String("=?")));
         }
+        if (rfc2047) {
+            return KCodecs::decodeRFC2047String(value.toLatin1(), &charset);
+        }
+        return value;
+    }
 
-        if (decCursor == decEnd) {
+    //
+    // parse the initial value into (charset,language,text):
+    //
+    QByteArray initial = rawValue(begin->value);
+    QTextCodec *textcodec = nullptr;
+    int textStart = 0;
+    if (begin->encoded && begin->section <= 0) {
+        const int firstQuote = initial.indexOf('\'');
+        if (firstQuote < 0) {
             // there wasn't a single single quote at all!
             // take the whole value to be in latin-1:
             KMIME_WARN << "No charset in extended-initial-value."
                        "Assuming \"iso-8859-1\".";
-            value += QString::fromLatin1(decBegin, source.second);
-            return;
-        }
-
-        charset = QByteArray(decBegin, decCursor - decBegin);
-
-        const char *oldDecCursor = ++decCursor;
-        // find the second single quote (we ignore the language tag):
-        while (decCursor != decEnd) {
-            if (*decCursor == '\'') {
-                break;
+        } else {
+            charset = initial.left(firstQuote);
+            // find the second single quote (we ignore the language tag):
+            const int secondQuote = initial.indexOf('\'', firstQuote + 1);
+            if (secondQuote < 0) {
+                KMIME_WARN << "No language in extended-initial-value."
+                           "Trying to recover.";
+                textStart = firstQuote + 1;
             } else {
-                decCursor++;
+                textStart = secondQuote + 1;
             }
-        }
-        if (decCursor == decEnd) {
-            KMIME_WARN << "No language in extended-initial-value."
-                       "Trying to recover.";
-            decCursor = oldDecCursor;
-        } else {
-            decCursor++;
-        }
-
-        // decCursor now points to the start of the
-        // "extended-other-values":
 
-        //
-        // get the decoders:
-        //
-
-        bool matchOK = false;
-        textcodec = KCharsets::charsets()->codecForName(QLatin1String(charset), matchOK);
-        if (!matchOK) {
-            textcodec = nullptr;
-            KMIME_WARN_UNKNOWN(Charset, charset);
+            bool matchOK = false;
+            textcodec = KCharsets::charsets()->codecForName(QLatin1String(charset), matchOK);
+            if (!matchOK) {
+                textcodec = nullptr;
+                KMIME_WARN_UNKNOWN(Charset, charset);
+            }
         }
     }
 
-    if (!rfc2231Codec) {
-        rfc2231Codec = KCodecs::Codec::codecForName("x-kmime-rfc2231");
-        assert(rfc2231Codec);
-    }
-
     if (!textcodec) {
-        value += QString::fromLatin1(decCursor, decEnd - decCursor);
-        return;
+        // without a charset, take everything as it is
+        QString value = QString::fromLatin1(initial.constData() + textStart, initial.size() - textStart);
+        for (const RawParameter *it = begin + 1; it != end; ++it) {
+            value += plainValue(it->value);
+        }
+        return value;
     }
 
-    KCodecs::Decoder *dec = rfc2231Codec->makeDecoder();
-    assert(dec);
-
     //
-    // do the decoding:
+    // percent-decode all sections into one buffer and convert it once:
     //
-
     QByteArray buffer;
-    buffer.resize(rfc2231Codec->maxDecodedSizeFor(decEnd - decCursor));
-    QByteArray::Iterator bit = buffer.begin();
-    QByteArray::ConstIterator bend = buffer.end();
-
-    if (!dec->decode(decCursor, decEnd, bit, bend)) {
-        KMIME_WARN << rfc2231Codec->name()
-                   << "codec lies about its maxDecodedSizeFor()"
-                   << Qt::endl
-                   << "result may be truncated";
+    buffer.reserve(initial.size());
+    for (const RawParameter *it = begin; it != end; ++it) {
+        const QByteArray raw = it == begin ? initial.mid(textStart) : rawValue(it->value);
+        if (it->encoded) {
+            appendPercentDecoded(raw.constData(), raw.size(), buffer);
+        } else {
+            buffer += raw;
+        }
     }
-
-    value += textcodec->toUnicode(buffer.begin(), bit - buffer.begin());
-
-    // qCDebug(KMIME_LOG) << "value now: \"" << value << "\"";
-    // cleanup:
-    delete dec;
+    return CharsetConversion::toUnicode(textcodec, buffer);
 }
 
-// known issues:
-//  - permutes rfc2231 continuations when the total number of parts
-//    exceeds 10 (other-sections then becomes *xy, ie. two digits)
-
-bool parseParameterListWithCharset(const char *&scursor,
-                                   const char *const send,
-                                   QMap<QString, QString> &result,
-                                   QByteArray &charset, bool isCRLF)
+// Parses a parameter list and calls @p add with the name and the sorted
+// sections of every parameter, in the order of the names.
+template<typename Add>
+static bool parseParameterSections(const char *&scursor, const char *const send,
+                                   bool isCRLF, Add add)
 {
-// parse the list into raw attribute-value pairs:
-    QMap<QString, QStringOrQPair> rawParameterList;
+    // parse the list into raw attribute-value pairs:
+    QVector<RawParameter> rawParameterList;
     if (!parseRawParameterList(scursor, send, rawParameterList, isCRLF)) {
         return false;
     }
@@ -1488,116 +2034,132 @@ bool parseParameterListWithCharset(const char *&scursor,
         return true;
     }
 
-    // decode rfc 2231 continuations and alternate charset encoding:
+    // group the sections of each parameter, in the order of their numbers;
+    // of several equal attributes the last one wins
+    std::stable_sort(rawParameterList.begin(), rawParameterList.end(),
+                     [](const RawParameter &lhs, const RawParameter &rhs) {
+        return lhs.name < rhs.name || (lhs.name == rhs.name && lhs.section < rhs.section);
+    });
 
-    // NOTE: this code assumes that what QMapIterator delivers is sorted
-    // by the key!
+    const RawParameter *const listEnd = rawParameterList.constEnd();
+    QVector<RawParameter> sections;
+    for (const RawParameter *it = rawParameterList.constBegin(); it != listEnd;) {
+        const RawParameter *next = it;
+        while (next != listEnd && next->name == it->name) {
+            ++next;
+        }
 
-    KCodecs::Codec *rfc2231Codec = nullptr;
-    QTextCodec *textcodec = nullptr;
-    QString attribute;
-    QString value;
-    enum Mode {
-        NoMode = 0x0, Continued = 0x1, Encoded = 0x2
-    };
+        // a continued value takes precedence over a plain one
+        sections.clear();
+        const bool continued = (next - 1)->section >= 0;
+        for (const RawParameter *section = it; section != next; ++section) {
+            if (continued && section->section < 0) {
+                continue;
+            }
+            if (!sections.isEmpty() && sections.constLast().section == section->section) {
+                sections.last() = *section;
+            } else {
+                sections.append(*section);
+            }
+        }
 
-    enum EncodingMode {
-        NoEncoding,
-        RFC2047,
-        RFC2231
-    };
+        add(it->name, sections.constBegin(), sections.constEnd());
+        it = next;
+    }
 
-    QMap<QString, QStringOrQPair>::Iterator it;
-    QMap<QString, QStringOrQPair>::Iterator end = rawParameterList.end();
+    return true;
+}
 
-    for (it = rawParameterList.begin() ; it != end ; ++it) {
-        if (attribute.isNull() || !it.key().startsWith(attribute)) {
-            //
-            // new attribute:
-            //
+bool parseParameterListWithCharset(const char *&scursor,
+                                   const char *const send,
+                                   QMap<QString, QString> &result,
+                                   QByteArray &charset, bool isCRLF)
+{
+    return parseParameterSections(scursor, send, isCRLF,
+                                  [&](const QString &name, const RawParameter *begin, const RawParameter *end) {
+        result.insert(name, decodeParameterValue(begin, end, charset));
+    });
+}
 
-            // store the last attribute/value pair in the result map now:
-            if (!attribute.isNull()) {
-                result.insert(attribute, value);
-            }
-            // and extract the information from the new raw attribute:
-            value.clear();
-            attribute = it.key();
-            int mode = NoMode;
-            EncodingMode encodingMode = NoEncoding;
-
-            // is the value rfc2331-encoded?
-            if (attribute.endsWith(QLatin1Char('*'))) {
-                attribute.chop(1);
-                mode |= Encoded;
-                encodingMode = RFC2231;
-            }
-            // is the value rfc2047-encoded?
-            if (!(*it).qstring.isNull() && (*it).qstring.contains(QLatin1String("=?"))) {
-                mode |= Encoded;
-                encodingMode = RFC2047;
-            }
-            // is the value continued?
-            if (attribute.endsWith(QLatin1String("*0"))) {
-                attribute.chop(2);
-                mode |= Continued;
-            }
-            //
-            // decode if necessary:
-            //
-            if (mode & Encoded) {
-                if (encodingMode == RFC2231) {
-                    decodeRFC2231Value(rfc2231Codec, textcodec,
-                                       false, /* isn't continuation */
-                                       value, (*it).qpair, charset);
-                } else if (encodingMode == RFC2047) {
-                    value += KCodecs::decodeRFC2047String((*it).qstring.toLatin1(), &charset);
-                }
-            } else {
-                // not encoded.
-                if ((*it).qpair.first) {
-                    value += QString::fromLatin1((*it).qpair.first, (*it).qpair.second);
-                } else {
-                    value += (*it).qstring;
-                }
-            }
+QByteArray parameterKey(const QString &name)
+{
+    static const QByteArray commonKeys[] = {
+        QByteArrayLiteral("boundary"),
+        QByteArrayLiteral("charset"),
+        QByteArrayLiteral("filename"),
+        QByteArrayLiteral("format"),
+        QByteArrayLiteral("name"),
+        QByteArrayLiteral("size"),
+    };
+    const QByteArray lowerKey = name.toLatin1().toLower();
+    for (const QByteArray &common : commonKeys) {
+        if (common == lowerKey) {
+            return common;
+        }
+    }
+    return lowerKey;
+}
 
-            //
-            // shortcut-processing when the value isn't encoded:
-            //
+// Whether @p bytes are US-ASCII, like isUsAscii() for a QString.
+static bool isUsAsciiBytes(const QByteArray &bytes)
+{
+    return std::all_of(bytes.cbegin(), bytes.cend(), [](char c) {
+        return static_cast<signed char>(c) > 0;
+    });
+}
 
-            if (!(mode & Continued)) {
-                // save result already:
-                result.insert(attribute, value);
-                // force begin of a new attribute:
-                attribute.clear();
+bool parseParameterListWithCharset(const char *&scursor,
+                                   const char *const send,
+                                   QVector<Parameter> &result,
+                                   QByteArray &charset, bool isCRLF)
+{
+    QVector<Parameter> parameters;
+    const bool ok = parseParameterSections(scursor, send, isCRLF,
+                                           [&](const QString &name, const RawParameter *begin, const RawParameter *end) {
+        Parameter parameter;
+        parameter.key = parameterKey(name);
+
+        // plain values are taken as they are, without a detour via QString
+        const bool plain = std::none_of(begin, end, [](const RawParameter &section) {
+            return section.encoded || (!section.value.qstring.isNull() && section.value.qstring.contains(QLatin1String("=?")));
+        });
+        if (plain) {
+            QByteArray value;
+            for (const RawParameter *it = begin; it != end; ++it) {
+                value += rawValue(it->value);
             }
-        } else { // it.key().startsWith( attribute )
-            //
-            // continuation
-            //
-
-            // ignore the section and trust QMap to have sorted the keys:
-            if (it.key().endsWith(QLatin1Char('*'))) {
-                // encoded
-                decodeRFC2231Value(rfc2231Codec, textcodec,
-                                   true, /* is continuation */
-                                   value, (*it).qpair, charset);
+            if (isUsAsciiBytes(value)) {
+                parameter.ascii = value;
             } else {
-                // not encoded
-                if ((*it).qpair.first) {
-                    value += QString::fromLatin1((*it).qpair.first, (*it).qpair.second);
-                } else {
-                    value += (*it).qstring;
-                }
+                parameter.text = QString::fromLatin1(value);
+            }
+        } else {
+            const QString value = decodeParameterValue(begin, end, charset);
+            if (isUsAscii(value)) {
+                parameter.ascii = value.toLatin1();
+            } else {
+                parameter.text = value;
             }
         }
-    }
-    // write last attr/value pair:
-    if (!attribute.isNull()) {
-        result.insert(attribute, value);
+        parameters.append(parameter);
+    });
+    if (!ok) {
+        return false;
     }
 
+    // names differing in case only end up with the same key, the last of
+    // them wins
+    std::stable_sort(parameters.begin(), parameters.end(), [](const Parameter &lhs, const Parameter &rhs) {
+        return lhs.key < rhs.key;
+    });
+    result.clear();
+    result.reserve(parameters.size());
+    for (int i = 0; i < parameters.size(); ++i) {
+        if (i + 1 < parameters.size() && parameters.at(i + 1).key == parameters.at(i).key) {
+            continue;
+        }
+        result.append(parameters.at(i));
+    }
     return true;
 }
 
@@ -2072,6 +2634,7 @@ Headers::Base *extractHeader(const QByteArray &head, const int headerStart, int
     } else {
         header->from7BitString(head.constData() + startOfFieldBody, endOfFieldBody - startOfFieldBody);
     }
+    Headers::BasePrivate::setRawField(header, head.mid(headerStart, endOfFieldBody - headerStart));
 
     return header;
 }
@@ -2133,6 +2696,78 @@ QVector<Headers::Base*> parseHeaders(const QByteArray &head)
     return ret;
 }
 
+QByteArray HeaderView::unfoldedValue() const
+{
+    if (folded) {
+        return unfoldHeader(value.first, value.second);
+    }
+    return QByteArray(value.first, value.second);
+}
+
+HeaderIterator::HeaderIterator(const QByteArray &head)
+    : m_head(head)
+{
+    findNext();
+}
+
+bool HeaderIterator::hasNext() const
+{
+    return m_hasNext;
+}
+
+HeaderView HeaderIterator::next()
+{
+    const HeaderView current = m_next;
+    findNext();
+    return current;
+}
+
+void HeaderIterator::findNext()
+{
+    m_hasNext = false;
+    const char *const data = m_head.constData();
+    const int size = m_head.size();
+
+    while (m_cursor < size) {
+        const int lineStart = m_cursor;
+        if (data[lineStart] == '\n' ||
+            (data[lineStart] == '\r' && lineStart + 1 < size && data[lineStart + 1] == '\n')) {
+            // the empty line separating head and body
+            m_cursor = size;
+            return;
+        }
+
+        int lineEnd = m_head.indexOf('\n', lineStart);
+        if (lineEnd < 0) {
+            lineEnd = size;
+        }
+        const auto colon = static_cast<const char *>(memchr(data + lineStart, ':', lineEnd - lineStart));
+        if (!colon) {
+            // not a header field, e.g. a broken continuation line
+            m_cursor = lineEnd + 1;
+            continue;
+        }
+
+        int startOfFieldBody = colon - data + 1;
+        if (startOfFieldBody < size && data[startOfFieldBody] == ' ') { // skip the space after the ':', if there's any
+            startOfFieldBody++;
+        }
+        bool folded = false;
+        const int endOfFieldBody = std::min(findHeaderLineEnd(m_head, startOfFieldBody, &folded), size);
+        int valueEnd = std::max(endOfFieldBody, startOfFieldBody);
+        if (valueEnd > startOfFieldBody && data[valueEnd - 1] == '\r') {
+            --valueEnd;
+        }
+
+        m_next.name = qMakePair(data + lineStart, int(colon - data) - lineStart);
+        m_next.value = qMakePair(data + startOfFieldBody, valueEnd - startOfFieldBody);
+        m_next.folded = folded;
+        m_hasNext = true;
+        m_cursor = endOfFieldBody + 1;
+        return;
+    }
+}
+
 } // namespace HeaderParsing
 
 } // namespace KMime
@@ -248,6 +248,79 @@ Q_REQUIRED_RESULT KMIME_EXPORT KMime::Headers::Base *extractFirstHeader(QByteArr
 KMIME_EXPORT void extractHeaderAndBody(const QByteArray &content,
                                        QByteArray &header, QByteArray &body);
 
+/**
+ * A header field of a raw head, as returned by HeaderIterator.
+ *
+ * The spans point into the head the HeaderIterator was created for and
+ * are valid as long as that data is.
+ *
+ * @since 5.23
+ */
+struct KMIME_EXPORT HeaderView {
+    /** The field name, as it appears before the colon. */
+    QPair<const char *, int> name = {nullptr, 0};
+    /**
+     * The field body without the usual space after the colon and the
+     * final line break; still folded if @ref folded is set.
+     */
+    QPair<const char *, int> value = {nullptr, 0};
+    /** Whether the field body spans several lines. */
+    bool folded = false;
+
+    /**
+     * Returns the field body, unfolded if necessary. Unlike the spans
+     * this copies the data.
+     */
+    Q_REQUIRED_RESULT QByteArray unfoldedValue() const;
+};
+
+/**
+ * Iterates over the header fields of a raw head without creating
+ * Headers::Base objects or copying any data, unlike parseHeaders() and
+ * extractFirstHeader().
+ *
+ * Iteration stops at the first empty line, so the head may also be
+ * followed by a body. Lines that do not contain a colon are skipped.
+ *
+ * @code
+ * HeaderIterator it(head);
+ * while (it.hasNext()) {
+ *     const HeaderView field = it.next();
+ *     ...
+ * }
+ * @endcode
+ *
+ * @since 5.23
+ */
+class KMIME_EXPORT HeaderIterator
+{
+public:
+    /**
+     * Creates an iterator over the header fields of @p head. The data of
+     * @p head is shared, not copied.
+     */
+    explicit HeaderIterator(const QByteArray &head);
+
+    /**
+     * Returns whether there is another header field.
+     */
+    Q_REQUIRED_RESULT bool hasNext() const;
+
+    /**
+     * Returns the next header field and advances the iterator.
+     * Must only be called if hasNext() returns true.
+     */
+    HeaderView next();
+
+private:
+    void findNext();
+
+    QByteArray m_head;
+    int m_cursor = 0;
+    HeaderView m_next;
+    bool m_hasNext = false;
+};
+
 } // namespace HeaderParsing
 
 } // namespace KMime
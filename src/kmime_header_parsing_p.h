@@ -5,9 +5,13 @@
 */
 #pragma once
 
-#include <QVector>
+#include "kmime_types.h"
 
-class QByteArray;
+#include <QAtomicPointer>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
 
 namespace KMime
 {
@@ -21,6 +25,100 @@ namespace HeaderParsing
 
 Q_REQUIRED_RESULT QVector<KMime::Headers::Base *> parseHeaders(const QByteArray &head);
 
+// Same as KCodecs::decodeRFC2047String(), but decodes adjacent encoded-words
+// in the same charset together.
+Q_REQUIRED_RESULT QString decodeRFC2047Text(const QByteArray &src, QByteArray &usedCS, const QByteArray &defaultCS);
+
+// A parameter of a parameter list with its lowercase key. Values
+// consisting of US-ASCII only, like charsets and boundaries, are kept as
+// they are and only converted to QString when asked for.
+struct Parameter {
+    QByteArray key;
+    QByteArray ascii; // the value if it is US-ASCII
+    QString text; // the value otherwise
+};
+
+// Returns the lowercase key of the parameter @p name, sharing the data
+// for common parameter names.
+Q_REQUIRED_RESULT QByteArray parameterKey(const QString &name);
+
+// Same as the public parseParameterListWithCharset(), but the result is
+// sorted by key. Of several parameters with the same key the last one in
+// the order of their names is kept.
+bool parseParameterListWithCharset(const char *&scursor, const char *const send,
+                                   QVector<Parameter> &result, QByteArray &charset, bool isCRLF);
+
+// The mailboxes of an address-list, e.g. the value of a To: header.
+//
+// Mailboxes of the form "local@domain" or "phrase <local@domain>", without
+// quoting in the address and without comments, are kept as spans of the
+// header value. Their address is only converted when it is asked for, and
+// their display name is only decoded then. All other mailboxes are parsed
+// into a Types::Mailbox as before. Either way the results are the same as
+// with parseAddressList().
+class CompactMailboxList
+{
+public:
+    CompactMailboxList() = default;
+    CompactMailboxList(const CompactMailboxList &other);
+    CompactMailboxList &operator=(const CompactMailboxList &other);
+    CompactMailboxList &operator=(CompactMailboxList &&other) noexcept;
+    ~CompactMailboxList();
+
+    // Parses an address-list like parseAddressList() and replaces the
+    // mailboxes by the ones of all its addresses. The display names of
+    // groups are added to @p groupNames. Nothing is changed on failure.
+    bool parse(const char *&scursor, const char *const send, bool isCRLF = false, QStringList *groupNames = nullptr);
+
+    void append(const Types::Mailbox &mailbox);
+    void clear();
+
+    Q_REQUIRED_RESULT bool isEmpty() const
+    {
+        return entries.isEmpty();
+    }
+    Q_REQUIRED_RESULT int size() const
+    {
+        return entries.size();
+    }
+    // Whether there are addresses, including groups without mailboxes.
+    Q_REQUIRED_RESULT bool hasAddresses() const
+    {
+        return !entries.isEmpty() || emptyGroups > 0;
+    }
+
+    // Same as mailbox(i).address() and mailbox(i).name().
+    Q_REQUIRED_RESULT QByteArray address(int i) const;
+    Q_REQUIRED_RESULT QString name(int i) const;
+
+    Q_REQUIRED_RESULT Types::Mailbox mailbox(int i) const;
+    Q_REQUIRED_RESULT Types::Mailbox::List mailboxes() const;
+
+private:
+    struct Entry {
+        int mailbox = -1; // index in parsed, -1 for the spans of value
+        int addressBegin = 0;
+        int atSign = 0;
+        int addressEnd = 0;
+        int nameBegin = 0; // the raw display-name, empty if there is none
+        int nameEnd = 0;
+    };
+
+    static bool parseSpans(const char *begin, const char *&scursor, const char *const send, Entry &entry);
+    QString displayName(const Entry &entry) const;
+    // The mailboxes, decoded on first use and kept until the next change.
+    const Types::Mailbox::List &decoded() const;
+    void clearDecoded();
+
+    QByteArray value;
+    QVector<Entry> entries;
+    QVector<Types::Mailbox> parsed;
+    // set once by the first reader, so concurrent reads need no lock
+    mutable QAtomicPointer<const Types::Mailbox::List> decodedList;
+    int emptyGroups = 0;
+    bool isCRLF = false;
+};
+
 }
 
 }
@@ -0,0 +1,221 @@
+/*
+    kmime_headerrewriter.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the HeaderRewriter class.
+
+  @brief
+  Defines the HeaderRewriter class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#include "kmime_headerrewriter.h"
+#include "kmime_util.h"
+#include "kmime_util_p.h"
+
+#include <QBuffer>
+#include <QVector>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace KMime;
+
+//@cond PRIVATE
+class KMime::HeaderRewriterPrivate
+{
+public:
+    struct Field {
+        QByteArray name;
+        QByteArray field; // folded, with LF line breaks; null for a removal
+    };
+
+    // Drops all operations for @p name.
+    void forget(const QByteArray &name);
+    // Returns the index of the replacement for the field name
+    // [@p name, @p name + @p length), or -1.
+    int replacementFor(const char *name, int length) const;
+
+    QVector<Field> replacements; // setHeader() and removeHeader()
+    QVector<Field> appended; // appendHeader()
+};
+
+namespace
+{
+
+bool sameName(const QByteArray &name, const char *other, int length)
+{
+    return name.length() == length && qstrnicmp(name.constData(), other, length) == 0;
+}
+
+QByteArray makeField(const QByteArray &name, const QByteArray &value)
+{
+    return foldHeader(name + ": " + value);
+}
+
+} // namespace
+
+void HeaderRewriterPrivate::forget(const QByteArray &name)
+{
+    const auto matches = [&name](const Field &f) {
+        return sameName(f.name, name.constData(), name.length());
+    };
+    replacements.erase(std::remove_if(replacements.begin(), replacements.end(), matches), replacements.end());
+    appended.erase(std::remove_if(appended.begin(), appended.end(), matches), appended.end());
+}
+
+int HeaderRewriterPrivate::replacementFor(const char *name, int length) const
+{
+    for (int i = 0; i < replacements.size(); ++i) {
+        if (sameName(replacements.at(i).name, name, length)) {
+            return i;
+        }
+    }
+    return -1;
+}
+//@endcond
+
+HeaderRewriter::HeaderRewriter()
+    : d(new HeaderRewriterPrivate)
+{
+}
+
+HeaderRewriter::~HeaderRewriter() = default;
+
+void HeaderRewriter::appendHeader(const QByteArray &name, const QByteArray &value)
+{
+    if (name.isEmpty()) {
+        return;
+    }
+    d->appended.append({name, makeField(name, value)});
+}
+
+void HeaderRewriter::setHeader(const QByteArray &name, const QByteArray &value)
+{
+    if (name.isEmpty()) {
+        return;
+    }
+    d->forget(name);
+    d->replacements.append({name, makeField(name, value)});
+}
+
+void HeaderRewriter::removeHeader(const QByteArray &name)
+{
+    if (name.isEmpty()) {
+        return;
+    }
+    d->forget(name);
+    d->replacements.append({name, QByteArray()});
+}
+
+bool HeaderRewriter::isEmpty() const
+{
+    return d->replacements.isEmpty() && d->appended.isEmpty();
+}
+
+void HeaderRewriter::clear()
+{
+    d->replacements.clear();
+    d->appended.clear();
+}
+
+QByteArray HeaderRewriter::apply(const QByteArray &message) const
+{
+    QByteArray result;
+    result.reserve(message.size() + 256);
+    QBuffer buffer(&result);
+    buffer.open(QIODevice::WriteOnly);
+    apply(message, &buffer);
+    return result;
+}
+
+bool HeaderRewriter::apply(const QByteArray &message, QIODevice *device) const
+{
+    const char *const data = message.constData();
+    const int size = message.size();
+    bool ok = true;
+    const auto write = [&ok, device](const char *from, int length) {
+        if (ok && length > 0) {
+            ok = device->write(from, length) == length;
+        }
+    };
+
+    const char *const firstLf = static_cast<const char *>(memchr(data, '\n', size));
+    const bool crlf = firstLf && firstLf > data && firstLf[-1] == '\r';
+    const QByteArray lineBreak = crlf ? "\r\n" : "\n";
+    const auto writeField = [&](const QByteArray &field) {
+        const QByteArray f = crlf ? LFtoCRLF(field) : field;
+        write(f.constData(), f.size());
+        write(lineBreak.constData(), lineBreak.size());
+    };
+
+    QVector<bool> done(d->replacements.size(), false);
+    int copyFrom = 0; // start of the unmodified fields not written yet
+    int pos = 0;
+    while (pos < size) {
+        // an empty line ends the header
+        if (data[pos] == '\n' || (data[pos] == '\r' && pos + 1 < size && data[pos + 1] == '\n')) {
+            break;
+        }
+        const char *const lineEnd = static_cast<const char *>(memchr(data + pos, '\n', size - pos));
+        const int lineLength = lineEnd ? lineEnd - (data + pos) : size - pos;
+        const char *const colon = static_cast<const char *>(memchr(data + pos, ':', lineLength));
+
+        int end = pos + lineLength;
+        int replacement = -1;
+        if (colon) {
+            int nameLength = colon - (data + pos);
+            while (nameLength > 0 && (data[pos + nameLength - 1] == ' ' || data[pos + nameLength - 1] == '\t')) {
+                --nameLength;
+            }
+            replacement = d->replacementFor(data + pos, nameLength);
+            int dataBegin = colon - data + 1;
+            end = findHeaderLineEnd(message, dataBegin);
+        }
+        end = std::min(end + 1, size); // including the line break
+
+        if (replacement >= 0) {
+            write(data + copyFrom, pos - copyFrom);
+            const QByteArray &field = d->replacements.at(replacement).field;
+            if (!done.at(replacement) && !field.isNull()) {
+                writeField(field);
+            }
+            done[replacement] = true;
+            copyFrom = end;
+        }
+        pos = end;
+    }
+    write(data + copyFrom, pos - copyFrom);
+
+    // the new fields go after the last field
+    bool lineBreakPending = pos > 0 && data[pos - 1] != '\n';
+    const auto writeNewField = [&](const QByteArray &field) {
+        if (lineBreakPending) {
+            write(lineBreak.constData(), lineBreak.size());
+            lineBreakPending = false;
+        }
+        writeField(field);
+    };
+    for (int i = 0; i < d->replacements.size(); ++i) {
+        const QByteArray &field = d->replacements.at(i).field;
+        if (!done.at(i) && !field.isNull()) {
+            writeNewField(field);
+        }
+    }
+    for (const HeaderRewriterPrivate::Field &f : std::as_const(d->appended)) {
+        writeNewField(f.field);
+    }
+
+    // the empty line and the body
+    write(data + pos, size - pos);
+    return ok;
+}
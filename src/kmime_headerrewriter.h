@@ -0,0 +1,126 @@
+/*
+    kmime_headerrewriter.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the HeaderRewriter class.
+
+  @brief
+  Defines the HeaderRewriter class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+
+#include <QByteArray>
+
+#include <memory>
+
+class QIODevice;
+
+namespace KMime
+{
+class HeaderRewriterPrivate;
+
+/**
+  @brief
+  Adds, replaces and removes header fields of a raw message without
+  parsing it.
+
+  The operations are collected first and then applied to any number of
+  messages. Applying them walks the header fields of the message once and
+  splices the new fields into it; all other fields and the body are
+  copied byte by byte, so nothing is decoded or encoded again. This is
+  much cheaper than Content::setContent(), Content::parse(),
+  Content::assemble() and Content::encodedContent().
+
+  New fields use the line ending of the message (LF or CRLF). Field
+  values must already be encoded as 7 bit, e.g. with encodeRFC2047String();
+  they are folded if needed.
+
+  @code
+  KMime::HeaderRewriter rewriter;
+  rewriter.setHeader("X-Spam-Score", "0.3");
+  rewriter.removeHeader("X-Spam-Flag");
+  rewriter.apply(rawMessage, &file);
+  @endcode
+
+  @since 5.23
+*/
+class KMIME_EXPORT HeaderRewriter
+{
+public:
+    /**
+      Creates a HeaderRewriter without any operations.
+    */
+    HeaderRewriter();
+
+    /**
+      Destroys this HeaderRewriter.
+    */
+    ~HeaderRewriter();
+
+    /**
+      Adds a field @p name with the value @p value at the end of the header,
+      keeping all existing fields of that name.
+    */
+    void appendHeader(const QByteArray &name, const QByteArray &value);
+
+    /**
+      Replaces the first field @p name of the header with one with the
+      value @p value and removes all further fields of that name. If the
+      header has no such field, it is added at the end of the header.
+      Overrides any previous operation for @p name.
+    */
+    void setHeader(const QByteArray &name, const QByteArray &value);
+
+    /**
+      Removes all fields @p name from the header.
+      Overrides any previous operation for @p name.
+    */
+    void removeHeader(const QByteArray &name);
+
+    /**
+      Returns true if no operation has been added.
+    */
+    Q_REQUIRED_RESULT bool isEmpty() const;
+
+    /**
+      Removes all operations.
+    */
+    void clear();
+
+    /**
+      Applies the operations to the message @p message and returns the
+      result.
+    */
+    Q_REQUIRED_RESULT QByteArray apply(const QByteArray &message) const;
+
+    /**
+      Applies the operations to the message @p message and writes the
+      result to @p device, which must be open for writing. The body is
+      written with a single write.
+
+      @return false if writing to @p device failed.
+    */
+    bool apply(const QByteArray &message, QIODevice *device) const;
+
+private:
+    //@cond PRIVATE
+    Q_DISABLE_COPY(HeaderRewriter)
+    std::unique_ptr<HeaderRewriterPrivate> const d;
+    //@endcond
+};
+
+} // namespace KMime
+
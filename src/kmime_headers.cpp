@@ -31,15 +31,21 @@
 #include "kmime_util_p.h"
 #include "kmime_codecs.h"
 #include "kmime_content.h"
+#include "kmime_content_p.h"
 #include "kmime_headerfactory_p.h"
+#include "kmime_header_parsing_p.h"
 #include "kmime_debug.h"
 #include "kmime_warning.h"
 
 #include <KCharsets>
 #include <KCodecs>
 
+#include <QMap>
+
+#include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <typeinfo>
 
 // macro to generate a default constructor implementation
 #define kmime_mk_trivial_ctor( subclass, baseclass )                  \
@@ -57,7 +63,7 @@
     }                                                                     \
     \
 	subclass::~subclass() { \
-		Q_D(subclass); \
+		Q_D(const subclass); /* destruction is no modification, see Base::clearRawField() */ \
 		delete d;  /* see comment above the BasePrivate class */ \
 		d_ptr = nullptr; \
 	}
@@ -122,7 +128,7 @@ QByteArray Base::rfc2047Charset() const
 
 void Base::setRFC2047Charset(const QByteArray &cs)
 {
-    d_ptr->encCS = cachedCharset(cs);
+    d_func()->encCS = cachedCharset(cs);
 }
 
 const char *Base::type() const
@@ -145,6 +151,109 @@ QByteArray Base::typeIntro() const
     return QByteArray(type()) + ": ";
 }
 
+QByteArray Base::rawField() const
+{
+    return d_ptr->raw;
+}
+
+void Base::clearRawField()
+{
+    if (!d_ptr->raw.isNull()) {
+        d_ptr->raw = QByteArray();
+    }
+    BasePrivate::notifyOwner(this);
+}
+
+void BasePrivate::setRawField(Base *header, const QByteArray &raw)
+{
+    header->d_ptr->raw = raw;
+}
+
+void BasePrivate::setOwner(Base *header, Content *owner)
+{
+    header->d_ptr->owner = owner;
+}
+
+void BasePrivate::notifyOwner(Base *header)
+{
+    if (header->d_ptr->owner) {
+        ContentPrivate::headerModified(header->d_ptr->owner, header);
+    }
+}
+
+template<typename TPrivate>
+Base *BasePrivate::copyPrivate(const Base *header, Base *copy)
+{
+    auto d = static_cast<TPrivate *>(copy->d_ptr);
+    *d = *static_cast<const TPrivate *>(header->d_ptr);
+    d->owner = nullptr;
+    return copy;
+}
+
+#define kmime_clone_as( subclass, subclassPrivate ) \
+    if (typeid(*header) == typeid(subclass)) { \
+        return copyPrivate<subclassPrivate>(header, new subclass); \
+    }
+
+Base *BasePrivate::clone(const Base *header)
+{
+    using namespace Generics;
+    kmime_clone_as(ContentType, ContentTypePrivate)
+    kmime_clone_as(ContentTransferEncoding, ContentTransferEncodingPrivate)
+    kmime_clone_as(ContentDisposition, ContentDispositionPrivate)
+    kmime_clone_as(ContentID, ContentIDPrivate)
+    kmime_clone_as(ContentDescription, UnstructuredPrivate)
+    kmime_clone_as(ContentLocation, UnstructuredPrivate)
+    kmime_clone_as(MIMEVersion, DotAtomPrivate)
+    kmime_clone_as(From, MailboxListPrivate)
+    kmime_clone_as(Sender, SingleMailboxPrivate)
+    kmime_clone_as(To, AddressListPrivate)
+    kmime_clone_as(Cc, AddressListPrivate)
+    kmime_clone_as(Bcc, AddressListPrivate)
+    kmime_clone_as(ReplyTo, AddressListPrivate)
+    kmime_clone_as(ReturnPath, ReturnPathPrivate)
+    kmime_clone_as(MailCopiesTo, MailCopiesToPrivate)
+    kmime_clone_as(Subject, UnstructuredPrivate)
+    kmime_clone_as(Organization, UnstructuredPrivate)
+    kmime_clone_as(UserAgent, UnstructuredPrivate)
+    kmime_clone_as(Keywords, PhraseListPrivate)
+    kmime_clone_as(MessageID, SingleIdentPrivate)
+    kmime_clone_as(Supersedes, SingleIdentPrivate)
+    kmime_clone_as(InReplyTo, IdentPrivate)
+    kmime_clone_as(References, IdentPrivate)
+    kmime_clone_as(Control, ControlPrivate)
+    kmime_clone_as(Date, DatePrivate)
+    kmime_clone_as(Newsgroups, NewsgroupsPrivate)
+    kmime_clone_as(FollowUpTo, NewsgroupsPrivate)
+    kmime_clone_as(Lines, LinesPrivate)
+    if (typeid(*header) == typeid(Generic)) {
+        // the type name is owned by GenericPrivate, so copy only the rest
+        return copyPrivate<UnstructuredPrivate>(header, new Generic(header->type()));
+    }
+
+    // a header type registered by the application: re-parse its 7 bit
+    // representation, keeping it as Generic if that fails
+    Base *copy = HeaderFactory::createHeader(header->type());
+    if (!header->isEmpty()) {
+        const QByteArray body = header->as7BitString(false);
+        if (copy) {
+            copy->from7BitString(body);
+        }
+        if (!copy || copy->isEmpty()) {
+            delete copy;
+            copy = new Generic(header->type());
+            copy->from7BitString(body);
+        }
+    } else if (!copy) {
+        copy = new Generic(header->type());
+    }
+    copy->d_ptr->encCS = header->d_ptr->encCS;
+    copy->d_ptr->raw = header->d_ptr->raw;
+    return copy;
+}
+
+#undef kmime_clone_as
+
 //-----</Base>---------------------------------
 
 namespace Generics
@@ -162,7 +271,7 @@ Unstructured::Unstructured() : Base(new UnstructuredPrivate)
 
 Unstructured::~Unstructured()
 {
-    Q_D(Unstructured);
+    Q_D(const Unstructured);
     delete d;
     d_ptr = nullptr;
 }
@@ -170,7 +279,7 @@ Unstructured::~Unstructured()
 void Unstructured::from7BitString(const QByteArray &s)
 {
     Q_D(Unstructured);
-    d->decoded = KCodecs::decodeRFC2047String(s, &d->encCS, Content::defaultCharset());
+    d->decoded = HeaderParsing::decodeRFC2047Text(s, d->encCS, Content::defaultCharset());
 }
 
 QByteArray Unstructured::as7BitString(bool withHeaderType) const
@@ -220,7 +329,7 @@ kmime_mk_dptr_ctor(Structured, Base)
 
 Structured::~Structured()
 {
-    Q_D(Structured);
+    Q_D(const Structured);
     delete d;
     d_ptr = nullptr;
 }
@@ -308,8 +417,8 @@ QByteArray MailboxList::as7BitString(bool withHeaderType) const
     if (withHeaderType) {
         rv = typeIntro();
     }
-    for (const Types::Mailbox &mbox : std::as_const(d->mailboxList)) {
-        rv += mbox.as7BitString(d->encCS);
+    for (int i = 0; i < d->mailboxList.size(); ++i) {
+        rv += d->mailboxList.mailbox(i).as7BitString(d->encCS);
         rv += ", ";
     }
     rv.resize(rv.length() - 2);
@@ -326,7 +435,7 @@ void MailboxList::fromUnicodeString(const QString &s, const QByteArray &b)
 QString MailboxList::asUnicodeString() const
 {
     Q_D(const MailboxList);
-    return Mailbox::listToUnicodeString(d->mailboxList);
+    return Mailbox::listToUnicodeString(d->mailboxList.mailboxes());
 }
 
 void MailboxList::clear()
@@ -358,11 +467,11 @@ void MailboxList::addAddress(const QByteArray &address,
 
 QVector<QByteArray> MailboxList::addresses() const
 {
+    Q_D(const MailboxList);
     QVector<QByteArray> rv;
-    rv.reserve(d_func()->mailboxList.count());
-    const auto mailboxList = d_func()->mailboxList;
-    for (const Types::Mailbox &mbox : mailboxList) {
-        rv.append(mbox.address());
+    rv.reserve(d->mailboxList.size());
+    for (int i = 0; i < d->mailboxList.size(); ++i) {
+        rv.append(d->mailboxList.address(i));
     }
     return rv;
 }
@@ -371,12 +480,13 @@ QStringList MailboxList::displayNames() const
 {
     Q_D(const MailboxList);
     QStringList rv;
-    rv.reserve(d->mailboxList.count());
-    for (const Types::Mailbox &mbox : std::as_const(d->mailboxList)) {
-        if (mbox.hasName()) {
-            rv.append(mbox.name());
+    rv.reserve(d->mailboxList.size());
+    for (int i = 0; i < d->mailboxList.size(); ++i) {
+        const QString name = d->mailboxList.name(i);
+        if (!name.isEmpty()) {
+            rv.append(name);
         } else {
-            rv.append(QString::fromLatin1(mbox.address()));
+            rv.append(QString::fromLatin1(d->mailboxList.address(i)));
         }
     }
     return rv;
@@ -386,11 +496,11 @@ QString MailboxList::displayString() const
 {
     Q_D(const MailboxList);
     if (d->mailboxList.size() == 1) { // fast-path to avoid temporary QStringList in the common case of just one From address
-        const auto& mbox = d->mailboxList.at(0);
-        if (mbox.hasName()) {
-            return mbox.name();
+        const QString name = d->mailboxList.name(0);
+        if (!name.isEmpty()) {
+            return name;
         } else {
-            return QString::fromLatin1(mbox.address());
+            return QString::fromLatin1(d->mailboxList.address(0));
         }
     }
     return displayNames().join(QLatin1String(", "));
@@ -398,7 +508,7 @@ QString MailboxList::displayString() const
 
 Types::Mailbox::List MailboxList::mailboxes() const
 {
-    return d_func()->mailboxList;
+    return d_func()->mailboxList.mailboxes();
 }
 
 bool MailboxList::parse(const char *&scursor, const char *const send,
@@ -409,24 +519,17 @@ bool MailboxList::parse(const char *&scursor, const char *const send,
     // from := "From:" mailbox-list CRLF
     // sender := "Sender:" mailbox CRLF
 
-    // parse an address-list:
-    QVector<Types::Address> maybeAddressList;
-    if (!parseAddressList(scursor, send, maybeAddressList, isCRLF)) {
+    // parse an address-list, keeping the mailboxes and complaining if
+    // there are groups:
+    QStringList groupNames;
+    if (!d->mailboxList.parse(scursor, send, isCRLF, &groupNames)) {
         return false;
     }
-
-    d->mailboxList.clear();
-    d->mailboxList.reserve(maybeAddressList.count());
-
-    // extract the mailboxes and complain if there are groups:
-    for (const auto &it : std::as_const(maybeAddressList)) {
-        if (!(it).displayName.isEmpty()) {
-            KMIME_WARN << "mailbox groups in header disallowing them! Name: \""
-                       << (it).displayName << "\""
-                       << Qt::endl
-                          ;
-        }
-        d->mailboxList += (it).mailboxList;
+    for (const QString &name : std::as_const(groupNames)) {
+        KMIME_WARN << "mailbox groups in header disallowing them! Name: \""
+                   << name << "\""
+                   << Qt::endl
+                      ;
     }
     return true;
 }
@@ -447,7 +550,7 @@ bool SingleMailbox::parse(const char *&scursor, const char *const send,
         return false;
     }
 
-    if (d->mailboxList.count() > 1) {
+    if (d->mailboxList.size() > 1) {
         KMIME_WARN << "multiple mailboxes in header allowing only a single one!"
                    << Qt::endl;
     }
@@ -466,7 +569,7 @@ kmime_mk_dptr_ctor(AddressList, Address)
 QByteArray AddressList::as7BitString(bool withHeaderType) const
 {
     const Q_D(AddressList);
-    if (d->addressList.isEmpty()) {
+    if (!d->mailboxList.hasAddresses()) {
       return {};
     }
 
@@ -474,12 +577,9 @@ QByteArray AddressList::as7BitString(bool withHeaderType) const
     if (withHeaderType) {
         rv = typeIntro();
     }
-    for (const Types::Address &addr : std::as_const(d->addressList)) {
-        const auto mailBoxList = addr.mailboxList;
-        for (const Types::Mailbox &mbox : mailBoxList) {
-            rv += mbox.as7BitString(d->encCS);
-            rv += ", ";
-        }
+    for (int i = 0; i < d->mailboxList.size(); ++i) {
+        rv += d->mailboxList.mailbox(i).as7BitString(d->encCS);
+        rv += ", ";
     }
     rv.resize(rv.length() - 2);
     return rv;
@@ -496,12 +596,9 @@ QString AddressList::asUnicodeString() const
 {
     Q_D(const AddressList);
     QStringList rv;
-    for (const Types::Address &addr : std::as_const(d->addressList)) {
-        rv.reserve(rv.size() + addr.mailboxList.size());
-        const auto mailboxList = addr.mailboxList;
-        for (const Types::Mailbox &mbox : mailboxList) {
-            rv.append(mbox.prettyAddress());
-        }
+    rv.reserve(d->mailboxList.size());
+    for (int i = 0; i < d->mailboxList.size(); ++i) {
+        rv.append(d->mailboxList.mailbox(i).prettyAddress());
     }
     return rv.join(QLatin1String(", "));
 }
@@ -509,43 +606,37 @@ QString AddressList::asUnicodeString() const
 void AddressList::clear()
 {
     Q_D(AddressList);
-    d->addressList.clear();
+    d->mailboxList.clear();
 }
 
 bool AddressList::isEmpty() const
 {
-    return d_func()->addressList.isEmpty();
+    return !d_func()->mailboxList.hasAddresses();
 }
 
 void AddressList::addAddress(const Types::Mailbox &mbox)
 {
     Q_D(AddressList);
-    Types::Address addr;
-    addr.mailboxList.append(mbox);
-    d->addressList.append(addr);
+    d->mailboxList.append(mbox);
 }
 
 void AddressList::addAddress(const QByteArray &address,
                              const QString &displayName)
 {
     Q_D(AddressList);
-    Types::Address addr;
     Types::Mailbox mbox;
     if (stringToMailbox(address, displayName, mbox)) {
-        addr.mailboxList.append(mbox);
-        d->addressList.append(addr);
+        d->mailboxList.append(mbox);
     }
 }
 
 QVector<QByteArray> AddressList::addresses() const
 {
+    Q_D(const AddressList);
     QVector<QByteArray> rv;
-    const auto addressList = d_func()->addressList;
-    for (const Types::Address &addr : addressList) {
-        const auto mailboxList = addr.mailboxList;
-        for (const Types::Mailbox &mbox : mailboxList) {
-            rv.append(mbox.address());
-        }
+    rv.reserve(d->mailboxList.size());
+    for (int i = 0; i < d->mailboxList.size(); ++i) {
+        rv.append(d->mailboxList.address(i));
     }
     return rv;
 }
@@ -554,14 +645,13 @@ QStringList AddressList::displayNames() const
 {
     Q_D(const AddressList);
     QStringList rv;
-    for (const Types::Address &addr : std::as_const(d->addressList)) {
-        const auto mailboxList = addr.mailboxList;
-        for (const Types::Mailbox &mbox : mailboxList) {
-            if (mbox.hasName()) {
-                rv.append(mbox.name());
-            } else {
-                rv.append(QString::fromLatin1(mbox.address()));
-            }
+    rv.reserve(d->mailboxList.size());
+    for (int i = 0; i < d->mailboxList.size(); ++i) {
+        const QString name = d->mailboxList.name(i);
+        if (!name.isEmpty()) {
+            rv.append(name);
+        } else {
+            rv.append(QString::fromLatin1(d->mailboxList.address(i)));
         }
     }
     return rv;
@@ -575,28 +665,14 @@ QString AddressList::displayString() const
 
 Types::Mailbox::List AddressList::mailboxes() const
 {
-    Types::Mailbox::List rv;
-    const auto addressList = d_func()->addressList;
-    for (const Types::Address &addr : addressList) {
-        const auto mailboxList = addr.mailboxList;
-        for (const Types::Mailbox &mbox : mailboxList) {
-            rv.append(mbox);
-        }
-    }
-    return rv;
+    return d_func()->mailboxList.mailboxes();
 }
 
 bool AddressList::parse(const char *&scursor, const char *const send,
                         bool isCRLF)
 {
     Q_D(AddressList);
-    QVector<Types::Address> maybeAddressList;
-    if (!parseAddressList(scursor, send, maybeAddressList, isCRLF)) {
-        return false;
-    }
-
-    d->addressList = maybeAddressList;
-    return true;
+    return d->mailboxList.parse(scursor, send, isCRLF);
 }
 
 //-----</AddressList>-------------------------
@@ -822,6 +898,73 @@ bool DotAtom::parse(const char *&scursor, const char *const send,
 //@cond PRIVATE
 kmime_mk_trivial_ctor_with_dptr(Parametrized, Structured)
 kmime_mk_dptr_ctor(Parametrized, Structured)
+
+const ParametrizedPrivate::Parameter *ParametrizedPrivate::find(const QByteArray &key) const
+{
+    for (const Parameter &parameter : parameters) {
+        if (parameter.key == key) {
+            return &parameter;
+        }
+    }
+    return nullptr;
+}
+
+QByteArray ParametrizedPrivate::latin1Value(const QByteArray &key) const
+{
+    const Parameter *parameter = find(key);
+    if (!parameter) {
+        return {};
+    }
+    return parameter->text.isNull() ? parameter->ascii : parameter->text.toLatin1();
+}
+
+QString ParametrizedPrivate::value(const QByteArray &key) const
+{
+    const Parameter *parameter = find(key);
+    if (!parameter) {
+        return {};
+    }
+    return parameter->text.isNull() ? QString::fromLatin1(parameter->ascii) : parameter->text;
+}
+
+ParametrizedPrivate::Parameter &ParametrizedPrivate::insert(const QByteArray &key)
+{
+    const auto it = std::lower_bound(parameters.begin(), parameters.end(), key,
+                                     [](const Parameter &parameter, const QByteArray &key) {
+        return parameter.key < key;
+    });
+    if (it != parameters.end() && it->key == key) {
+        return *it;
+    }
+    return *parameters.insert(it, {key, QByteArray(), QString()});
+}
+
+void ParametrizedPrivate::setValue(const QByteArray &key, const QByteArray &latin1)
+{
+    Parameter &parameter = insert(key);
+    const bool ascii = std::all_of(latin1.cbegin(), latin1.cend(), [](char c) {
+        return uchar(c) < 128;
+    });
+    if (ascii) {
+        parameter.ascii = latin1;
+        parameter.text.clear();
+    } else {
+        parameter.ascii.clear();
+        parameter.text = QString::fromLatin1(latin1);
+    }
+}
+
+void ParametrizedPrivate::setValue(const QByteArray &key, const QString &value)
+{
+    Parameter &parameter = insert(key);
+    if (isUsAscii(value)) {
+        parameter.ascii = value.toLatin1();
+        parameter.text.clear();
+    } else {
+        parameter.ascii.clear();
+        parameter.text = value;
+    }
+}
 //@endcond
 
 QByteArray Parametrized::as7BitString(bool withHeaderType) const
@@ -837,26 +980,25 @@ QByteArray Parametrized::as7BitString(bool withHeaderType) const
     }
 
     bool first = true;
-    for (QMap<QString, QString>::ConstIterator it = d->parameterHash.constBegin();
-            it != d->parameterHash.constEnd(); ++it) {
+    for (const ParametrizedPrivate::Parameter &parameter : d->parameters) {
         if (!first) {
             rv += "; ";
         } else {
             first = false;
         }
-        if (isUsAscii(it.value())) {
-            rv += it.key().toLatin1() + '=';
-            QByteArray tmp = it.value().toLatin1();
+        if (parameter.text.isNull()) {
+            rv += parameter.key + '=';
+            QByteArray tmp = parameter.ascii;
             addQuotes(tmp, true);   // force quoting, eg. for whitespaces in parameter value
             rv += tmp;
         } else {
             if (useOutlookAttachmentEncoding()) {
-                rv += it.key().toLatin1() + '=';
-                qCDebug(KMIME_LOG) << "doing:" << it.value() << QLatin1String(d->encCS);
-                rv += "\"" + encodeRFC2047String(it.value(), d->encCS) + "\"";
+                rv += parameter.key + '=';
+                qCDebug(KMIME_LOG) << "doing:" << parameter.text << QLatin1String(d->encCS);
+                rv += "\"" + encodeRFC2047String(parameter.text, d->encCS) + "\"";
             } else {
-                rv += it.key().toLatin1() + "*=";
-                rv += encodeRFC2231String(it.value(), d->encCS);
+                rv += parameter.key + "*=";
+                rv += encodeRFC2231String(parameter.text, d->encCS);
             }
         }
     }
@@ -866,38 +1008,38 @@ QByteArray Parametrized::as7BitString(bool withHeaderType) const
 
 QString Parametrized::parameter(const QString &key) const
 {
-    return d_func()->parameterHash.value(key.toLower());
+    return d_func()->value(parameterKey(key));
 }
 
 bool Parametrized::hasParameter(const QString &key) const
 {
-    return d_func()->parameterHash.contains(key.toLower());
+    return d_func()->find(parameterKey(key)) != nullptr;
 }
 
 void Parametrized::setParameter(const QString &key, const QString &value)
 {
     Q_D(Parametrized);
-    d->parameterHash.insert(key.toLower(), value);
+    d->setValue(parameterKey(key), value);
 }
 
 bool Parametrized::isEmpty() const
 {
-    return d_func()->parameterHash.isEmpty();
+    return d_func()->parameters.isEmpty();
 }
 
 void Parametrized::clear()
 {
     Q_D(Parametrized);
-    d->parameterHash.clear();
+    d->parameters.clear();
 }
 
 bool Parametrized::parse(const char  *&scursor, const char *const send,
                          bool isCRLF)
 {
     Q_D(Parametrized);
-    d->parameterHash.clear();
+    d->parameters.clear();
     QByteArray charset;
-    if (!parseParameterListWithCharset(scursor, send, d->parameterHash, charset, isCRLF)) {
+    if (!parseParameterListWithCharset(scursor, send, d->parameters, charset, isCRLF)) {
         return false;
     }
     d->encCS = charset;
@@ -1191,7 +1333,7 @@ Generic::Generic(const char *t, int len) : Generics::Unstructured(new GenericPri
 
 Generic::~Generic()
 {
-    Q_D(Generic);
+    Q_D(const Generic);
     delete d;
     d_ptr = nullptr;
 }
@@ -1625,6 +1767,44 @@ bool Lines::parse(const char *&scursor, const char *const send, bool isCRLF) {
 //@cond PRIVATE
 kmime_mk_trivial_ctor_with_name_and_dptr(ContentType, Generics::Parametrized,
             Content-Type)
+
+static bool equalsNoCase(const char *data, int len, const char *name)
+{
+    return qstrlen(name) == uint(len) && qstrnicmp(data, name, len) == 0;
+}
+
+void ContentTypePrivate::classify()
+{
+    slash = mimeType.indexOf('/');
+    const char *data = mimeType.constData();
+    const int mediaLen = slash < 0 ? mimeType.size() : slash;
+    if (mimeType.isEmpty()) {
+        mediaType = NoMediaType;
+    } else if (equalsNoCase(data, mediaLen, "text")) {
+        mediaType = TextType;
+    } else if (equalsNoCase(data, mediaLen, "multipart")) {
+        mediaType = MultipartType;
+    } else if (equalsNoCase(data, mediaLen, "image")) {
+        mediaType = ImageType;
+    } else if (equalsNoCase(data, mediaLen, "message")) {
+        mediaType = MessageType;
+    } else {
+        mediaType = OtherMediaType;
+    }
+
+    subType = OtherSubType;
+    if (slash >= 0) {
+        const char *sub = data + slash + 1;
+        const int subLen = mimeType.size() - slash - 1;
+        if (mediaType == TextType && equalsNoCase(sub, subLen, "plain")) {
+            subType = PlainSubType;
+        } else if (mediaType == TextType && equalsNoCase(sub, subLen, "html")) {
+            subType = HtmlSubType;
+        } else if (mediaType == MessageType && equalsNoCase(sub, subLen, "partial")) {
+            subType = PartialSubType;
+        }
+    }
+}
 //@endcond
 
 bool ContentType::isEmpty() const {
@@ -1635,6 +1815,7 @@ void ContentType::clear() {
     Q_D(ContentType);
     d->category = CCsingle;
     d->mimeType.clear();
+    d->classify();
     Parametrized::clear();
 }
 
@@ -1663,27 +1844,45 @@ QByteArray ContentType::mimeType() const {
 
 QByteArray ContentType::mediaType() const {
     Q_D(const ContentType);
-    const int pos = d->mimeType.indexOf('/');
-    if (pos < 0) {
+    if (d->slash < 0) {
+        return d->mimeType;
+    } else {
+        return d->mimeType.left(d->slash);
+    }
+}
+
+QByteArray ContentType::mediaTypeView() const {
+    Q_D(const ContentType);
+    if (d->slash < 0) {
         return d->mimeType;
     } else {
-        return d->mimeType.left(pos);
+        return QByteArray::fromRawData(d->mimeType.constData(), d->slash);
     }
 }
 
 QByteArray ContentType::subType() const {
     Q_D(const ContentType);
-    const int pos = d->mimeType.indexOf('/');
-    if (pos < 0) {
+    if (d->slash < 0) {
+      return {};
+    } else {
+        return d->mimeType.mid(d->slash + 1);
+    }
+}
+
+QByteArray ContentType::subTypeView() const {
+    Q_D(const ContentType);
+    if (d->slash < 0) {
       return {};
     } else {
-        return d->mimeType.mid(pos + 1);
+        return QByteArray::fromRawData(d->mimeType.constData() + d->slash + 1,
+                                       d->mimeType.size() - d->slash - 1);
     }
 }
 
 void ContentType::setMimeType(const QByteArray & mimeType) {
     Q_D(ContentType);
     d->mimeType = mimeType;
+    d->classify();
 
     if (isMultipart()) {
         d->category = CCcontainer;
@@ -1694,20 +1893,17 @@ void ContentType::setMimeType(const QByteArray & mimeType) {
 
 bool ContentType::isMediatype(const char *mediatype) const {
     Q_D(const ContentType);
-    const int len = strlen(mediatype);
-    return qstrnicmp(d->mimeType.constData(), mediatype, len) == 0 &&
-            (d->mimeType.at(len) == '/' || d->mimeType.size() == len);
+    const int len = d->slash < 0 ? d->mimeType.size() : d->slash;
+    return equalsNoCase(d->mimeType.constData(), len, mediatype);
 }
 
 bool ContentType::isSubtype(const char *subtype) const {
     Q_D(const ContentType);
-    const int pos = d->mimeType.indexOf('/');
-    if (pos < 0) {
+    if (d->slash < 0) {
         return false;
     }
-    const int len = strlen(subtype);
-    return qstrnicmp(d->mimeType.constData() + pos + 1, subtype, len) == 0 &&
-            d->mimeType.size() == pos + len + 1;
+    return equalsNoCase(d->mimeType.constData() + d->slash + 1,
+                        d->mimeType.size() - d->slash - 1, subtype);
 }
 
 bool ContentType::isMimeType(const char* mimeType) const
@@ -1717,31 +1913,33 @@ bool ContentType::isMimeType(const char* mimeType) const
 }
 
 bool ContentType::isText() const {
-    return (isMediatype("text") || isEmpty());
+    Q_D(const ContentType);
+    return d->mediaType == ContentTypePrivate::TextType || d->mediaType == ContentTypePrivate::NoMediaType;
 }
 
 bool ContentType::isPlainText() const {
-    return (qstricmp(d_func()->mimeType.constData(), "text/plain") == 0 || isEmpty());
+    Q_D(const ContentType);
+    return d->subType == ContentTypePrivate::PlainSubType || d->mediaType == ContentTypePrivate::NoMediaType;
 }
 
 bool ContentType::isHTMLText() const {
-    return qstricmp(d_func()->mimeType.constData(), "text/html") == 0;
+    return d_func()->subType == ContentTypePrivate::HtmlSubType;
 }
 
 bool ContentType::isImage() const {
-    return isMediatype("image");
+    return d_func()->mediaType == ContentTypePrivate::ImageType;
 }
 
 bool ContentType::isMultipart() const {
-    return isMediatype("multipart");
+    return d_func()->mediaType == ContentTypePrivate::MultipartType;
 }
 
 bool ContentType::isPartial() const {
-    return qstricmp(d_func()->mimeType.constData(), "message/partial") == 0;
+    return d_func()->subType == ContentTypePrivate::PartialSubType;
 }
 
 QByteArray ContentType::charset() const {
-    QByteArray ret = parameter(QStringLiteral("charset")).toLatin1();
+    QByteArray ret = d_func()->latin1Value(QByteArrayLiteral("charset"));
     if (ret.isEmpty()) {
         //return the default-charset if necessary
         ret = Content::defaultCharset();
@@ -1750,15 +1948,17 @@ QByteArray ContentType::charset() const {
 }
 
 void ContentType::setCharset(const QByteArray & s) {
-    setParameter(QStringLiteral("charset"), QString::fromLatin1(s));
+    Q_D(ContentType);
+    d->setValue(QByteArrayLiteral("charset"), s);
 }
 
 QByteArray ContentType::boundary() const {
-    return parameter(QStringLiteral("boundary")).toLatin1();
+    return d_func()->latin1Value(QByteArrayLiteral("boundary"));
 }
 
 void ContentType::setBoundary(const QByteArray & s) {
-    setParameter(QStringLiteral("boundary"), QString::fromLatin1(s));
+    Q_D(ContentType);
+    d->setValue(QByteArrayLiteral("boundary"), s);
 }
 
 QString ContentType::name() const {
@@ -1802,8 +2002,9 @@ contentCategory ContentType::category() const {
 }
 
 void ContentType::setCategory(contentCategory c) {
-    Q_D(ContentType);
-    d->category = c;
+    // the category is not part of the header field, the raw field stays
+    static_cast<ContentTypePrivate *>(d_ptr)->category = c;
+    BasePrivate::notifyOwner(this);
 }
 
 void ContentType::setPartialParams(int total, int number) {
@@ -1844,6 +2045,7 @@ bool ContentType::parse(const char *&scursor, const char *const send,
     d->mimeType.reserve(maybeMimeType.second + maybeSubType.second + 1);
     d->mimeType = QByteArray(maybeMimeType.first, maybeMimeType.second).toLower()
                     + '/' + QByteArray(maybeSubType.first, maybeSubType.second).toLower();
+    d->classify();
 
     // parameter list
     eatCFWS(scursor, send, isCRLF);
@@ -1995,8 +2197,10 @@ bool ContentTransferEncoding::isDecoded() const {
 }
 
 void ContentTransferEncoding::setDecoded(bool decoded) {
-    Q_D(ContentTransferEncoding);
-    d->decoded = decoded;
+    // the state of the body is not part of the header field, the raw field
+    // stays; the encoded body of the Content changes though
+    static_cast<ContentTransferEncodingPrivate *>(d_ptr)->decoded = decoded;
+    BasePrivate::notifyOwner(this);
 }
 
 bool ContentTransferEncoding::needToEncode() const {
@@ -90,6 +90,20 @@ enum contentDisposition {
     kmime_mk_trivial_ctor( subclass )                     \
     const char *type() const override;                           \
     static const char *staticType();
+
+// internal macro like Q_DECLARE_PRIVATE, but any non-const access to the
+// private data counts as a modification of the header, see Base::rawField()
+#define kmime_declare_private( Class ) \
+    inline Class##Private *d_func() \
+    { \
+        clearRawField(); \
+        return reinterpret_cast<Class##Private *>(d_ptr); \
+    } \
+    inline const Class##Private *d_func() const \
+    { \
+        return reinterpret_cast<const Class##Private *>(d_ptr); \
+    } \
+    friend class Class##Private;
 //@endcond
 
 //
@@ -183,6 +197,18 @@ public:
     */
     Q_REQUIRED_RESULT bool isMimeHeader() const;
 
+    /**
+      Returns the header field exactly as it was parsed from a message
+      head or last assembled into one, including the header type and any
+      folding, but without the final line break.
+      Returns a null QByteArray if the header is not part of a head yet
+      or has been modified since.
+
+      Content::assemble() uses this to keep unmodified headers unchanged.
+      @since 5.23
+    */
+    Q_REQUIRED_RESULT QByteArray rawField() const;
+
 protected:
     /**
       Helper method, returns the header prefix including ":".
@@ -190,12 +216,14 @@ protected:
     QByteArray typeIntro() const;
 
     //@cond PRIVATE
+    void clearRawField();
+
     BasePrivate *d_ptr;
     kmime_mk_dptr_ctor(Base)
     //@endcond
 
 private:
-    Q_DECLARE_PRIVATE(Base)
+    kmime_declare_private(Base)
     Q_DISABLE_COPY(Base)
 };
 
@@ -244,7 +272,7 @@ public:
     bool isEmpty() const override;
 
 private:
-    Q_DECLARE_PRIVATE(Unstructured)
+    kmime_declare_private(Unstructured)
 };
 
 class StructuredPrivate;
@@ -307,7 +335,7 @@ protected:
     //@endcond
 
 private:
-    Q_DECLARE_PRIVATE(Structured)
+    kmime_declare_private(Structured)
 };
 
 class AddressPrivate;
@@ -325,7 +353,7 @@ protected:
     kmime_mk_dptr_ctor(Address)
     //@endcond
 private:
-    Q_DECLARE_PRIVATE(Address)
+    kmime_declare_private(Address)
 };
 
 class MailboxListPrivate;
@@ -393,7 +421,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(MailboxList)
+    kmime_declare_private(MailboxList)
 };
 
 class SingleMailboxPrivate;
@@ -410,7 +438,7 @@ class KMIME_EXPORT SingleMailbox : public MailboxList
 protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 private:
-    Q_DECLARE_PRIVATE(SingleMailbox)
+    kmime_declare_private(SingleMailbox)
 };
 
 class AddressListPrivate;
@@ -481,7 +509,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(AddressList)
+    kmime_declare_private(AddressList)
 };
 
 class IdentPrivate;
@@ -525,7 +553,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(Ident)
+    kmime_declare_private(Ident)
 };
 
 class SingleIdentPrivate;
@@ -558,7 +586,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(SingleIdent)
+    kmime_declare_private(SingleIdent)
 };
 
 class TokenPrivate;
@@ -591,7 +619,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(Token)
+    kmime_declare_private(Token)
 };
 
 class PhraseListPrivate;
@@ -619,7 +647,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(PhraseList)
+    kmime_declare_private(PhraseList)
 };
 
 class DotAtomPrivate;
@@ -642,7 +670,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(DotAtom)
+    kmime_declare_private(DotAtom)
 };
 
 class ParametrizedPrivate;
@@ -689,7 +717,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(Parametrized)
+    kmime_declare_private(Parametrized)
 };
 
 } // namespace Generics
@@ -721,7 +749,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(ReturnPath)
+    kmime_declare_private(ReturnPath)
 };
 
 // Address et al.:
@@ -830,7 +858,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(MailCopiesTo)
+    kmime_declare_private(MailCopiesTo)
 };
 
 class ContentTransferEncodingPrivate;
@@ -881,7 +909,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(ContentTransferEncoding)
+    kmime_declare_private(ContentTransferEncoding)
 };
 
 /**
@@ -941,7 +969,7 @@ class KMIME_EXPORT ContentID : public Generics::SingleIdent
 protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 private:
-    Q_DECLARE_PRIVATE(ContentID)
+    kmime_declare_private(ContentID)
 };
 
 /**
@@ -1000,11 +1028,30 @@ public:
 
     QByteArray mediaType() const;
 
+    /**
+      Returns the media type like mediaType(), without copying it.
+
+      The returned QByteArray refers to the data of this header and is only
+      valid as long as the mimetype is not changed and the header exists.
+      It is not null-terminated.
+      @since 5.23
+    */
+    Q_REQUIRED_RESULT QByteArray mediaTypeView() const;
+
     /**
       Returns the mime sub-type (second part of the mimetype).
     */
     QByteArray subType() const;
 
+    /**
+      Returns the mime sub-type like subType(), without copying it.
+
+      The returned QByteArray refers to the data of this header and is only
+      valid as long as the mimetype is not changed and the header exists.
+      @since 5.23
+    */
+    Q_REQUIRED_RESULT QByteArray subTypeView() const;
+
     /**
       Sets the mimetype.
       @param mimeType The new mimetype.
@@ -1125,7 +1172,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(ContentType)
+    kmime_declare_private(ContentType)
 };
 
 class ContentDispositionPrivate;
@@ -1175,7 +1222,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(ContentDisposition)
+    kmime_declare_private(ContentDisposition)
 };
 
 //
@@ -1207,7 +1254,7 @@ public:
     void setType(const char *type, int len = -1);
 
 private:
-    Q_DECLARE_PRIVATE(Generic)
+    kmime_declare_private(Generic)
 };
 
 /**
@@ -1290,7 +1337,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(Control)
+    kmime_declare_private(Control)
 };
 
 class DatePrivate;
@@ -1329,7 +1376,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(Date)
+    kmime_declare_private(Date)
 };
 
 class NewsgroupsPrivate;
@@ -1371,7 +1418,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(Newsgroups)
+    kmime_declare_private(Newsgroups)
 };
 
 /**
@@ -1418,7 +1465,7 @@ protected:
     bool parse(const char *&scursor, const char *const send, bool isCRLF = false) override;
 
 private:
-    Q_DECLARE_PRIVATE(Lines)
+    kmime_declare_private(Lines)
 };
 
 /**
@@ -1441,6 +1488,7 @@ KMIME_EXPORT Base *createHeader(const QByteArray &type);
 #undef kmime_mk_trivial_ctor
 #undef kmime_mk_dptr_ctor
 #undef kmime_mk_trivial_ctor_with_name
+#undef kmime_declare_private
 
 Q_DECLARE_METATYPE(KMime::Headers::To*)
 Q_DECLARE_METATYPE(KMime::Headers::Cc*)
@@ -6,7 +6,11 @@
 
 #pragma once
 
-#include <QMap>
+#include "kmime_header_parsing_p.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
 //@cond PRIVATE
 
 #define kmime_mk_empty_private( subclass, base ) \
@@ -15,6 +19,8 @@
 namespace KMime
 {
 
+class Content;
+
 namespace Headers
 {
 
@@ -26,7 +32,26 @@ namespace Headers
 class BasePrivate
 {
 public:
+    // Sets the field as parsed from a head, see Base::rawField().
+    static void setRawField(Base *header, const QByteArray &raw);
+    // Sets the Content whose head @p header is part of.
+    static void setOwner(Base *header, Content *owner);
+    // Tells the owner that @p header has been modified.
+    static void notifyOwner(Base *header);
+    // Returns a copy of @p header of the same type, with a copy of its
+    // private data.
+    static Base *clone(const Base *header);
+
     QByteArray encCS;
+    // null once the header has been modified
+    QByteArray raw;
+    // the Content that is told about modifications, see Base::clearRawField()
+    Content *owner = nullptr;
+
+private:
+    // Copies the private data of @p header into @p copy, of the same type.
+    template<typename TPrivate>
+    static Base *copyPrivate(const Base *header, Base *copy);
 };
 
 namespace Generics
@@ -44,7 +69,7 @@ kmime_mk_empty_private(Address, Structured)
 class MailboxListPrivate : public AddressPrivate
 {
 public:
-    QVector<Types::Mailbox> mailboxList;
+    HeaderParsing::CompactMailboxList mailboxList;
 };
 
 kmime_mk_empty_private(SingleMailbox, MailboxList)
@@ -52,7 +77,8 @@ kmime_mk_empty_private(SingleMailbox, MailboxList)
 class AddressListPrivate : public AddressPrivate
 {
 public:
-    KMime::Types::AddressList addressList;
+    // the mailboxes of all addresses, the groups are not kept
+    HeaderParsing::CompactMailboxList mailboxList;
 };
 
 class IdentPrivate : public AddressPrivate
@@ -85,7 +111,20 @@ public:
 class ParametrizedPrivate : public StructuredPrivate
 {
 public:
-    QMap<QString, QString> parameterHash;
+    using Parameter = HeaderParsing::Parameter;
+
+    // Returns the parameter with the lowercase @p key, or nullptr.
+    const Parameter *find(const QByteArray &key) const;
+    // Returns the value of the parameter with the lowercase @p key as Latin-1.
+    QByteArray latin1Value(const QByteArray &key) const;
+    QString value(const QByteArray &key) const;
+    void setValue(const QByteArray &key, const QByteArray &latin1);
+    void setValue(const QByteArray &key, const QString &value);
+    // Returns the parameter with the lowercase @p key, added if missing.
+    Parameter &insert(const QByteArray &key);
+
+    // sorted by key
+    QVector<Parameter> parameters;
 };
 
 } // namespace Generics
@@ -123,12 +162,35 @@ public:
 class ContentTypePrivate : public Generics::ParametrizedPrivate
 {
 public:
+    // The media types and subtypes tested for by ContentType's predicates.
+    enum MediaType : quint8 {
+        NoMediaType,
+        OtherMediaType,
+        TextType,
+        MultipartType,
+        ImageType,
+        MessageType
+    };
+    enum SubType : quint8 {
+        OtherSubType,
+        PlainSubType,
+        HtmlSubType,
+        PartialSubType
+    };
+
     ContentTypePrivate() :
         Generics::ParametrizedPrivate(),
         category(CCsingle)
     {}
+
+    // Updates slash, mediaType and subType, call whenever mimeType changes.
+    void classify();
+
     QByteArray mimeType;
     contentCategory category;
+    int slash = -1; // position of the '/' in mimeType
+    MediaType mediaType = NoMediaType;
+    SubType subType = OtherSubType;
 };
 
 class ContentDispositionPrivate : public Generics::ParametrizedPrivate
@@ -0,0 +1,100 @@
+/*
+    kmime_idn.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_idn_p.h"
+#include "kmime_types.h"
+#include "kmime_util.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QUrl>
+
+using namespace KMime;
+
+namespace
+{
+
+// The number of domains kept for each direction. Address lists repeat
+// few domains, so this is plenty.
+const int maxCachedDomains = 256;
+
+// QUrl's IDN conversions are expensive; the results for the most recently
+// used domains are kept, the least recently used ones are dropped first.
+struct IdnCache {
+    QMutex mutex;
+    QCache<QString, QString> fromAce{maxCachedDomains};
+    QCache<QString, QString> toAce{maxCachedDomains};
+    Types::IdnCacheStatistics statistics;
+};
+
+IdnCache *idnCache()
+{
+    static IdnCache cache;
+    return &cache;
+}
+
+// Looks up @p domain in @p conversions, one of the caches of idnCache(),
+// and converts it with @p convertDomain if it is not there.
+QString convert(QCache<QString, QString> &conversions, const QString &domain, QString (*convertDomain)(const QString &))
+{
+    IdnCache *const cache = idnCache();
+    {
+        QMutexLocker locker(&cache->mutex);
+        if (const QString *result = conversions.object(domain)) {
+            ++cache->statistics.hits;
+            return *result;
+        }
+        ++cache->statistics.misses;
+    }
+
+    // converted without holding the lock, a concurrent miss for the same
+    // domain merely converts it twice
+    const QString result = convertDomain(domain);
+    QMutexLocker locker(&cache->mutex);
+    conversions.insert(domain, new QString(result));
+    return result;
+}
+
+QString qurlFromAce(const QString &domain)
+{
+    return QUrl::fromAce(domain.toLatin1());
+}
+
+QString qurlToAce(const QString &domain)
+{
+    const QByteArray ace = QUrl::toAce(domain);
+    return ace.isEmpty() ? domain : QString::fromLatin1(ace);
+}
+
+} // namespace
+
+QString Idn::fromAce(const QString &domain)
+{
+    // the presence of IDNA is readily detected with a substring match
+    if (!domain.contains(QLatin1String("xn--"))) {
+        return domain;
+    }
+    return convert(idnCache()->fromAce, domain, qurlFromAce);
+}
+
+QString Idn::toAce(const QString &domain)
+{
+    if (isUsAscii(domain)) {
+        return domain;
+    }
+    return convert(idnCache()->toAce, domain, qurlToAce);
+}
+
+Types::IdnCacheStatistics Types::idnCacheStatistics()
+{
+    IdnCache *const cache = idnCache();
+    QMutexLocker locker(&cache->mutex);
+    return cache->statistics;
+}
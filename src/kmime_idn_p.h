@@ -0,0 +1,47 @@
+/*
+    kmime_idn_p.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+// @cond PRIVATE
+
+#include <QString>
+
+/* Internal helper functions. Not part of the public API. */
+
+namespace KMime
+{
+
+namespace Idn
+{
+
+/**
+  Returns @p domain with its ACE labels ("xn--...") decoded, the same as
+  QUrl::fromAce(). Domains without ACE labels are returned as they are.
+
+  The conversions of the most recently used domains are cached, see
+  Types::idnCacheStatistics().
+*/
+QString fromAce(const QString &domain);
+
+/**
+  Returns @p domain with its non-ASCII labels encoded in ACE, the same as
+  QUrl::toAce(). ASCII domains, and domains QUrl cannot convert, are
+  returned as they are.
+
+  Uses the same cache as fromAce().
+*/
+QString toAce(const QString &domain);
+
+} // namespace Idn
+
+} // namespace KMime
+
+// @endcond
@@ -30,7 +30,9 @@ QByteArray Message::assembleHeaders()
 
     // Make sure the mandatory MIME-Version field (RFC2045) is present and valid.
     auto *mimeVersion = header<Headers::MIMEVersion>(true);
-    mimeVersion->from7BitString("1.0");
+    if (mimeVersion->as7BitString(false) != "1.0") {
+        mimeVersion->from7BitString("1.0");
+    }
 
     // Assemble all header fields.
     return Content::assembleHeaders();
@@ -55,7 +57,7 @@ Content *Message::mainBodyPart(const QByteArray &type)
         }
 
         // multipart/alternative
-        if (contentType->subType() == "alternative") {
+        if (contentType->subTypeView() == "alternative") {
             if (type.isEmpty()) {
                 return c->contents().at(0);
             }
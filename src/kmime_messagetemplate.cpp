@@ -0,0 +1,323 @@
+/*
+    kmime_messagetemplate.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the MessageTemplate class.
+
+  @brief
+  Defines the MessageTemplate class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#include "kmime_messagetemplate.h"
+#include "kmime_headerfactory_p.h"
+#include "kmime_transferencoding_p.h"
+#include "kmime_util.h"
+
+#include <KCharsets>
+
+#include <QTextCodec>
+#include <QVector>
+
+#include <algorithm>
+
+using namespace KMime;
+
+namespace
+{
+
+// A string with placeholders: literals.size() == names.size() + 1.
+struct TextTemplate {
+    QStringList literals;
+    QStringList names;
+
+    bool isEmpty() const
+    {
+        return names.isEmpty();
+    }
+
+    QString fill(const QHash<QString, QString> &values) const
+    {
+        QString result = literals.at(0);
+        for (int i = 0; i < names.size(); ++i) {
+            result += values.value(names.at(i));
+            result += literals.at(i + 1);
+        }
+        return result;
+    }
+};
+
+bool isNameChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('-') || c == QLatin1Char('_');
+}
+
+TextTemplate parseTemplate(const QString &text)
+{
+    TextTemplate t;
+    int literalStart = 0;
+    int pos = 0;
+    while ((pos = text.indexOf(QLatin1String("{{"), pos)) != -1) {
+        int end = pos + 2;
+        while (end < text.size() && isNameChar(text.at(end))) {
+            ++end;
+        }
+        if (end == pos + 2 || end + 1 >= text.size() || text.at(end) != QLatin1Char('}') || text.at(end + 1) != QLatin1Char('}')) {
+            ++pos;
+            continue;
+        }
+        t.literals.append(text.mid(literalStart, pos - literalStart));
+        t.names.append(text.mid(pos + 2, end - pos - 2));
+        pos = literalStart = end + 2;
+    }
+    t.literals.append(text.mid(literalStart));
+    return t;
+}
+
+// Whether Content::encodedContent() puts an empty line between the head
+// and the body.
+bool needsSeparator(bool headIsEmpty, const QByteArray &body)
+{
+    return headIsEmpty ? !body.startsWith("\n\n") : !body.startsWith('\n');
+}
+
+bool isTextLeaf(Content *c)
+{
+    return !c->isFrozen() && c->contents().isEmpty() && c->contentType()->isText() && !c->contentType()->isMultipart();
+}
+
+bool hasPlaceholders(const QString &text)
+{
+    return !parseTemplate(text).isEmpty();
+}
+
+bool hasPlaceholders(Content *c)
+{
+    const auto headers = c->headers();
+    for (const Headers::Base *h : headers) {
+        if (hasPlaceholders(h->asUnicodeString())) {
+            return true;
+        }
+    }
+    if (isTextLeaf(c)) {
+        return hasPlaceholders(c->decodedText());
+    }
+    if (!c->isFrozen() && c->contentType()->isMultipart()) {
+        const auto contents = c->contents();
+        return std::any_of(contents.cbegin(), contents.cend(), [](Content *child) {
+            return hasPlaceholders(child);
+        });
+    }
+    return false;
+}
+
+} // namespace
+
+//@cond PRIVATE
+class KMime::MessageTemplatePrivate
+{
+public:
+    struct Segment {
+        enum Kind {
+            Literal, ///< encoded bytes
+            Header, ///< a header field with placeholders
+            Body ///< the body of a text part with placeholders
+        };
+        Kind kind = Literal;
+        QByteArray data; // Literal: the bytes; Header: the header type
+        TextTemplate text;
+        QByteArray charset; // Header: the RFC2047 charset
+        QTextCodec *codec = nullptr; // Body
+        Headers::contentEncoding encoding = Headers::CE7Bit; // Body
+        bool headIsEmpty = false; // Body
+    };
+
+    // Makes sure the values of the placeholders in text parts can be encoded.
+    void prepare(Content *c);
+    void compile(Content *c);
+    void appendLiteral(const QByteArray &data);
+    void appendTemplate(Segment &&segment);
+
+    QVector<Segment> segments;
+    QStringList placeholders;
+};
+
+void MessageTemplatePrivate::prepare(Content *c)
+{
+    if (isTextLeaf(c)) {
+        // decodedText() replaces a missing charset by the one of the locale
+        const QByteArray charset = c->contentType()->charset().toLower();
+        const QString text = c->decodedText();
+        if (!hasPlaceholders(text)) {
+            return;
+        }
+        if (charset.isEmpty() || charset == "us-ascii") {
+            c->contentType()->setCharset("utf-8");
+        }
+        auto cte = c->contentTransferEncoding();
+        if (cte->encoding() == Headers::CE7Bit) {
+            cte->setEncoding(Headers::CEquPr);
+        }
+        c->fromUnicodeString(text);
+    } else if (!c->isFrozen() && c->contentType()->isMultipart()) {
+        const auto contents = c->contents();
+        for (Content *child : contents) {
+            prepare(child);
+        }
+    }
+}
+
+void MessageTemplatePrivate::appendLiteral(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    if (!segments.isEmpty() && segments.last().kind == Segment::Literal) {
+        segments.last().data += data;
+    } else {
+        Segment segment;
+        segment.data = data;
+        segments.append(segment);
+    }
+}
+
+void MessageTemplatePrivate::appendTemplate(Segment &&segment)
+{
+    for (const QString &name : std::as_const(segment.text.names)) {
+        if (!placeholders.contains(name)) {
+            placeholders.append(name);
+        }
+    }
+    segments.append(std::move(segment));
+}
+
+void MessageTemplatePrivate::compile(Content *c)
+{
+    if (!hasPlaceholders(c)) {
+        appendLiteral(c->encodedContent());
+        return;
+    }
+
+    // The head, same as Content::assembleHeaders().
+    bool headIsEmpty = true;
+    const auto headers = c->headers();
+    for (const Headers::Base *h : headers) {
+        if (h->isEmpty()) {
+            continue;
+        }
+        headIsEmpty = false;
+        const TextTemplate text = parseTemplate(h->asUnicodeString());
+        if (text.isEmpty()) {
+            const QByteArray raw = h->rawField();
+            appendLiteral((raw.isNull() ? foldHeader(h->as7BitString()) : raw) + '\n');
+        } else {
+            Segment segment;
+            segment.kind = Segment::Header;
+            segment.data = h->type();
+            segment.text = text;
+            segment.charset = h->rfc2047Charset();
+            appendTemplate(std::move(segment));
+        }
+    }
+
+    // The body, same as Content::encodedBody().
+    if (isTextLeaf(c)) {
+        Segment segment;
+        segment.kind = Segment::Body;
+        segment.text = parseTemplate(c->decodedText());
+        bool ok = true;
+        segment.codec = KCharsets::charsets()->codecForName(QLatin1String(c->contentType()->charset()), ok);
+        if (!ok || !segment.codec) {
+            segment.codec = QTextCodec::codecForLocale();
+        }
+        segment.encoding = c->contentTransferEncoding()->encoding();
+        segment.headIsEmpty = headIsEmpty;
+        appendTemplate(std::move(segment));
+        return;
+    }
+
+    // Any other body that is not split into parts is taken as it is,
+    // e.g. an attachment with a placeholder in its file name.
+    if (c->isFrozen() || !c->contentType()->isMultipart()) {
+        const QByteArray body = c->encodedBody();
+        if (needsSeparator(headIsEmpty, body)) {
+            appendLiteral("\n");
+        }
+        appendLiteral(body);
+        return;
+    }
+
+    const QByteArray boundary = "\n--" + c->contentType()->boundary();
+    const QByteArray preamble = c->preamble();
+    if (needsSeparator(headIsEmpty, preamble.isEmpty() ? boundary : preamble + boundary)) {
+        appendLiteral("\n");
+    }
+    appendLiteral(preamble);
+    const auto contents = c->contents();
+    for (Content *child : contents) {
+        appendLiteral(boundary + '\n');
+        compile(child);
+    }
+    appendLiteral(boundary + "--\n");
+    appendLiteral(c->epilogue());
+}
+//@endcond
+
+MessageTemplate::MessageTemplate(const Message::Ptr &message)
+    : d(new MessageTemplatePrivate)
+{
+    // Work on a copy that can be prepared and assembled.
+    std::unique_ptr<Content> copy(message->clone());
+    d->prepare(copy.get());
+    copy->assemble();
+    d->compile(copy.get());
+}
+
+MessageTemplate::~MessageTemplate() = default;
+
+QStringList MessageTemplate::placeholders() const
+{
+    return d->placeholders;
+}
+
+QByteArray MessageTemplate::instantiate(const QHash<QString, QString> &values, bool useCrLf) const
+{
+    QByteArray result;
+    for (const MessageTemplatePrivate::Segment &segment : std::as_const(d->segments)) {
+        switch (segment.kind) {
+        case MessageTemplatePrivate::Segment::Literal:
+            result += segment.data;
+            break;
+        case MessageTemplatePrivate::Segment::Header: {
+            std::unique_ptr<Headers::Base> h(HeaderFactory::createHeader(segment.data));
+            if (!h) {
+                h.reset(new Headers::Generic(segment.data.constData()));
+            }
+            h->fromUnicodeString(segment.text.fill(values), segment.charset);
+            if (!h->isEmpty()) {
+                result += foldHeader(h->as7BitString()) + '\n';
+            }
+            break;
+        }
+        case MessageTemplatePrivate::Segment::Body: {
+            const QByteArray data = segment.codec->fromUnicode(segment.text.fill(values));
+            const QByteArray encoded = data.isEmpty() ? data : TransferEncoding::encode(data, segment.encoding);
+            if (needsSeparator(segment.headIsEmpty, encoded)) {
+                result += '\n';
+            }
+            result += encoded;
+            break;
+        }
+        }
+    }
+    return useCrLf ? LFtoCRLF(result) : result;
+}
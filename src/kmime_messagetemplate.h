@@ -0,0 +1,121 @@
+/*
+    kmime_messagetemplate.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the MessageTemplate class.
+
+  @brief
+  Defines the MessageTemplate class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+#include "kmime_message.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+namespace KMime
+{
+class MessageTemplatePrivate;
+
+/**
+  @brief
+  Generates many similar messages from one Message with placeholders.
+
+  Placeholders have the form "{{name}}", where name consists of letters,
+  digits, '-' and '_'. They can be used in the value of any header field
+  and in the decoded text of text/ parts that are not multipart.
+
+  Structured header fields, e.g. To, cannot hold a placeholder as their
+  syntax does not allow it. Use a Headers::Generic with the same type
+  instead: its value is parsed as the proper header type once the
+  placeholders are replaced.
+
+  The constructor assembles and encodes the message once. Everything but
+  the header fields and text parts that contain placeholders is kept as
+  encoded bytes. instantiate() only encodes those fields and parts again
+  and splices them into the prepared bytes, so it is much faster than
+  building a Message and calling Content::assemble() and
+  Content::encodedContent() for every recipient.
+
+  Text parts with placeholders are encoded as quoted-printable UTF-8 if
+  they are declared as 7 bit US-ASCII, so any value can be inserted.
+
+  @code
+  KMime::Message::Ptr msg(new KMime::Message);
+  auto to = new KMime::Headers::Generic("To");
+  to->fromUnicodeString(QStringLiteral("{{to}}"), "utf-8");
+  msg->setHeader(to);
+  msg->subject()->fromUnicodeString(QStringLiteral("News for {{name}}"), "utf-8");
+  msg->contentType()->setMimeType("text/plain");
+  msg->fromUnicodeString(QStringLiteral("Hello {{name}},\n..."));
+
+  const KMime::MessageTemplate tmpl(msg);
+  for (const auto &recipient : recipients) {
+      send(tmpl.instantiate({{QStringLiteral("to"), recipient.address},
+                             {QStringLiteral("name"), recipient.name}}));
+  }
+  @endcode
+
+  instantiate() does not modify the template, so it can be called from
+  several threads at the same time.
+
+  @since 5.23
+*/
+class KMIME_EXPORT MessageTemplate
+{
+public:
+    /**
+      Prepares a template from @p message. The message itself is not
+      modified; later changes to it do not affect the template.
+    */
+    explicit MessageTemplate(const Message::Ptr &message);
+
+    /**
+      Destroys this MessageTemplate.
+    */
+    ~MessageTemplate();
+
+    /**
+      Returns the names of all placeholders in the template, without
+      duplicates, in the order of their first occurrence.
+    */
+    Q_REQUIRED_RESULT QStringList placeholders() const;
+
+    /**
+      Returns the encoded message with every placeholder replaced by its
+      value in @p values. Placeholders without a value are removed.
+
+      The result is the same as encodedContent() of the message with the
+      values inserted.
+
+      @param values the values of the placeholders, by name.
+      @param useCrLf If true, use @ref CRLF instead of @ref LF for linefeeds.
+    */
+    Q_REQUIRED_RESULT QByteArray instantiate(const QHash<QString, QString> &values, bool useCrLf = false) const;
+
+private:
+    //@cond PRIVATE
+    Q_DISABLE_COPY(MessageTemplate)
+    std::unique_ptr<MessageTemplatePrivate> const d;
+    //@endcond
+};
+
+} // namespace KMime
+
@@ -56,6 +56,13 @@ private:
 class NonMimeParser
 {
 public:
+    /** Integrity state of one extracted binary part. */
+    enum Verification {
+        NotVerified, ///< the encoding carries no checksum for this part
+        Verified, ///< the decoded data matches the transmitted checksum
+        VerificationFailed ///< the decoded data does not match the checksum
+    };
+
     explicit NonMimeParser(const QByteArray &src);
     virtual ~NonMimeParser();
     virtual bool parse() = 0;
@@ -91,12 +98,18 @@ public:
     {
         return m_mimeTypes;
     }
+    /** Verification state of each entry of binaryParts(). */
+    Q_REQUIRED_RESULT QVector<Verification> verifications() const
+    {
+        return m_verifications;
+    }
 
 protected:
     static QByteArray guessMimeType(const QByteArray &fileName);
 
     QByteArray m_src, m_text;
     QVector<QByteArray> m_bins, m_filenames, m_mimeTypes;
+    QVector<Verification> m_verifications;
     int m_partNr, m_totalNr;
 };
 
@@ -128,6 +141,7 @@ public:
 
 private:
     static bool yencMeta(QByteArray &src, const QByteArray &name, int *value);
+    static bool yencCrcMeta(const QByteArray &src, const QByteArray &name, quint32 *value);
 };
 
 } // namespace Parser
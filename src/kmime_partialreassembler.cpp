@@ -0,0 +1,373 @@
+/*
+    kmime_partialreassembler.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the PartialReassembler class.
+
+  @brief
+  Defines the PartialReassembler class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#include "kmime_partialreassembler.h"
+#include "kmime_parsers.h"
+#include "kmime_util.h"
+
+#include <QIODevice>
+#include <QMap>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QTemporaryFile>
+#include <QThreadPool>
+
+#include <algorithm>
+
+using namespace KMime;
+
+namespace
+{
+
+struct EncodedPart {
+    QByteArray data;
+    bool yenc = false;
+};
+
+// Returns the value of " key=" in a yEnc header line, or -1.
+int yencValue(const QByteArray &line, const char *key)
+{
+    const QByteArray sought = QByteArray(" ") + key + '=';
+    const int pos = line.indexOf(sought);
+    if (pos == -1) {
+        return -1;
+    }
+    const int start = pos + sought.length();
+    int end = start;
+    while (end < line.length() && line.at(end) >= '0' && line.at(end) <= '9') {
+        ++end;
+    }
+    bool ok = false;
+    const int value = line.mid(start, end - start).toInt(&ok);
+    return ok ? value : -1;
+}
+
+// Returns the line of @p src starting with @p marker at a line start.
+QByteArray lineStartingWith(const QByteArray &src, const QByteArray &marker)
+{
+    int pos = 0;
+    while ((pos = src.indexOf(marker, pos)) != -1) {
+        if (pos == 0 || src.at(pos - 1) == '\n') {
+            int end = src.indexOf('\n', pos);
+            if (end == -1) {
+                end = src.length();
+            }
+            if (end > pos && src.at(end - 1) == '\r') {
+                --end;
+            }
+            return src.mid(pos, end - pos);
+        }
+        pos += marker.length();
+    }
+    return {};
+}
+
+// Decodes all uuencoded data lines of @p src, skipping any other line;
+// a part of a split post has no begin line for KCodecs' decoder to sync on.
+bool uudecodeLines(const QByteArray &src, QByteArray *out)
+{
+    bool found = false;
+    int lineStart = 0;
+    while (lineStart < src.length()) {
+        int lineEnd = src.indexOf('\n', lineStart);
+        if (lineEnd == -1) {
+            lineEnd = src.length();
+        }
+        int end = lineEnd;
+        if (end > lineStart && src.at(end - 1) == '\r') {
+            --end;
+        }
+        const char *line = src.constData() + lineStart;
+        const int length = end - lineStart;
+        lineStart = lineEnd + 1;
+
+        if (found && length == 3 && qstrncmp(line, "end", 3) == 0) {
+            break;
+        }
+        if (length < 2) {
+            continue;
+        }
+        const int bytes = (line[0] - ' ') & 0x3f;
+        const int encoded = (bytes + 2) / 3 * 4;
+        if (bytes == 0 || length - 1 < encoded || length - 1 > encoded + 1) {
+            continue; // not a data line
+        }
+
+        for (int i = 0; i < bytes; i += 3) {
+            const char *group = line + 1 + i / 3 * 4;
+            const uchar c0 = (group[0] - ' ') & 0x3f;
+            const uchar c1 = (group[1] - ' ') & 0x3f;
+            const uchar c2 = (group[2] - ' ') & 0x3f;
+            const uchar c3 = (group[3] - ' ') & 0x3f;
+            out->append(static_cast<char>(c0 << 2 | c1 >> 4));
+            if (i + 1 < bytes) {
+                out->append(static_cast<char>(c1 << 4 | c2 >> 2));
+            }
+            if (i + 2 < bytes) {
+                out->append(static_cast<char>(c2 << 6 | c3));
+            }
+        }
+        found = true;
+    }
+    return found;
+}
+
+bool decodePart(const EncodedPart &part, QByteArray *out)
+{
+    if (!part.yenc) {
+        return uudecodeLines(part.data, out);
+    }
+
+    Parser::YENCEncoded yenc(part.data);
+    if (!yenc.parse() || yenc.binaryParts().isEmpty()) {
+        return false;
+    }
+    if (yenc.verifications().constFirst() == Parser::NonMimeParser::VerificationFailed) {
+        return false;
+    }
+    *out = yenc.binaryParts().constFirst();
+    return true;
+}
+
+} // namespace
+
+namespace KMime
+{
+
+class PartialReassemblerPrivate
+{
+public:
+    // Where the encoded data of a part is kept.
+    struct StoredPart {
+        qint64 offset = -1; // in File::spill, -1 if kept in data
+        qint64 size = 0;
+        QByteArray data; // only if it could not be spilled
+        bool yenc = false;
+    };
+
+    struct File {
+        int total = 0; // 0 while unknown
+        QMap<int, StoredPart> parts;
+        // the encoded parts, appended as they are added; a replaced part
+        // leaves its old data behind until the file is removed
+        QSharedPointer<QTemporaryFile> spill;
+    };
+
+    static StoredPart store(File &file, const EncodedPart &part);
+    static bool load(const File &file, const StoredPart &stored, EncodedPart *part);
+
+    QMap<QByteArray, File> files;
+};
+
+PartialReassemblerPrivate::StoredPart PartialReassemblerPrivate::store(File &file, const EncodedPart &part)
+{
+    StoredPart stored;
+    stored.size = part.data.size();
+    stored.yenc = part.yenc;
+    if (!file.spill) {
+        file.spill.reset(new QTemporaryFile);
+        if (!file.spill->open()) {
+            file.spill.reset();
+        }
+    }
+    if (file.spill && file.spill->seek(file.spill->size()) && file.spill->write(part.data) == stored.size) {
+        stored.offset = file.spill->size() - stored.size;
+    } else {
+        // keep it in memory rather than losing it
+        stored.data = part.data;
+    }
+    return stored;
+}
+
+bool PartialReassemblerPrivate::load(const File &file, const StoredPart &stored, EncodedPart *part)
+{
+    part->yenc = stored.yenc;
+    if (stored.offset < 0) {
+        part->data = stored.data;
+        return true;
+    }
+    if (!file.spill->seek(stored.offset)) {
+        return false;
+    }
+    part->data = file.spill->read(stored.size);
+    return part->data.size() == stored.size;
+}
+
+PartialReassembler::PartialReassembler()
+    : d(new PartialReassemblerPrivate)
+{
+}
+
+PartialReassembler::~PartialReassembler() = default;
+
+bool PartialReassembler::addPart(const NewsArticle::Ptr &article)
+{
+    if (!article) {
+        return false;
+    }
+
+    EncodedPart part;
+    part.data = article->decodedContent();
+
+    QByteArray file;
+    int number;
+    int total;
+
+    const QByteArray begin = lineStartingWith(part.data, "=ybegin ");
+    if (!begin.isEmpty()) {
+        const int namePos = begin.indexOf("name=");
+        if (namePos == -1) {
+            return false;
+        }
+        file = begin.mid(namePos + 5);
+        part.yenc = true;
+        number = yencValue(begin, "part");
+        total = yencValue(begin, "total");
+        if (number == -1) {
+            number = total = 1;
+        } else if (total == -1) {
+            // yEnc 1.1 posts omit the total; the last part ends at the file size
+            const QByteArray ypart = lineStartingWith(part.data, "=ypart ");
+            const int size = yencValue(begin, "size");
+            total = (size != -1 && yencValue(ypart, "end") == size) ? number : 0;
+        }
+    } else {
+        // uuencoded; the part counter is only found in the subject
+        const QString subject = QString::fromLatin1(KMime::extractHeader(article->head(), "Subject"));
+        static const QRegularExpression counterRegex(QStringLiteral("[\\(\\[]?\\s*([0-9]+)\\s*/\\s*([0-9]+)\\s*[\\)\\]]?"));
+        QRegularExpressionMatch match;
+        auto it = counterRegex.globalMatch(subject);
+        while (it.hasNext()) {
+            match = it.next();
+        }
+        if (!match.hasMatch()) {
+            return false;
+        }
+        number = match.captured(1).toInt();
+        total = match.captured(2).toInt();
+        QByteArray probe;
+        if (!uudecodeLines(part.data, &probe)) {
+            return false;
+        }
+        file = QString(subject).remove(match.capturedStart(0), match.capturedLength(0)).simplified().toLatin1();
+    }
+
+    if (number < 1 || (total > 0 && number > total)) {
+        return false;
+    }
+
+    PartialReassemblerPrivate::File &entry = d->files[file];
+    if (total > 0) {
+        entry.total = total;
+    }
+    entry.parts.insert(number, PartialReassemblerPrivate::store(entry, part));
+    return true;
+}
+
+QVector<QByteArray> PartialReassembler::files() const
+{
+    return d->files.keys().toVector();
+}
+
+int PartialReassembler::partCount(const QByteArray &file) const
+{
+    return d->files.value(file).total;
+}
+
+int PartialReassembler::receivedPartCount(const QByteArray &file) const
+{
+    return d->files.value(file).parts.size();
+}
+
+bool PartialReassembler::isComplete(const QByteArray &file) const
+{
+    const auto it = d->files.constFind(file);
+    if (it == d->files.constEnd() || it->total == 0) {
+        return false;
+    }
+    // parts are keyed by number within [1, total], so counting is enough
+    return it->parts.size() == it->total;
+}
+
+PartialReassembler::Status PartialReassembler::writeTo(const QByteArray &file, QIODevice *device) const
+{
+    if (!isComplete(file)) {
+        return Incomplete;
+    }
+    if (!device || !device->isWritable()) {
+        return WriteError;
+    }
+
+    const PartialReassemblerPrivate::File &entry = *d->files.constFind(file);
+    // QMap iterates in part order
+    const QVector<PartialReassemblerPrivate::StoredPart> parts = entry.parts.values().toVector();
+
+    // Load a window of parts from the spill file, decode them in parallel,
+    // then write them in order; at most one window of encoded and decoded
+    // data is held in memory at a time.
+    QThreadPool pool;
+    const int window = std::max(1, pool.maxThreadCount());
+    QVector<EncodedPart> encoded(window);
+    QVector<QByteArray> decoded(window);
+    QVector<bool> decodedOk(window);
+    EncodedPart *const inputs = encoded.data();
+    QByteArray *const results = decoded.data();
+    bool *const resultsOk = decodedOk.data();
+
+    for (int first = 0; first < parts.size(); first += window) {
+        const int count = std::min(window, parts.size() - first);
+        for (int i = 0; i < count; ++i) {
+            if (!PartialReassemblerPrivate::load(entry, parts.at(first + i), &inputs[i])) {
+                return CorruptPart;
+            }
+        }
+        for (int i = 0; i < count; ++i) {
+            pool.start([inputs, results, resultsOk, i]() {
+                resultsOk[i] = decodePart(inputs[i], &results[i]);
+            });
+        }
+        pool.waitForDone();
+
+        for (int i = 0; i < count; ++i) {
+            inputs[i].data.clear();
+            if (!resultsOk[i]) {
+                return CorruptPart;
+            }
+            if (device->write(results[i]) != results[i].size()) {
+                return WriteError;
+            }
+            results[i].clear();
+        }
+    }
+
+    return Success;
+}
+
+void PartialReassembler::removeFile(const QByteArray &file)
+{
+    d->files.remove(file);
+}
+
+void PartialReassembler::clear()
+{
+    d->files.clear();
+}
+
+} // namespace KMime
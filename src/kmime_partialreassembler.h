@@ -0,0 +1,162 @@
+/*
+    kmime_partialreassembler.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the PartialReassembler class.
+
+  @brief
+  Defines the PartialReassembler class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+#include "kmime_newsarticle.h"
+
+#include <QByteArray>
+#include <QVector>
+
+#include <memory>
+
+class QIODevice;
+
+namespace KMime
+{
+class PartialReassemblerPrivate;
+
+/**
+  @brief
+  Joins binary files that were posted split over several news articles.
+
+  Large binaries are usually posted as a series of articles, each carrying
+  one yEnc or uuencoded part of the file. Parsing such an article yields a
+  "message/partial" Content only; this class collects those articles and
+  writes the decoded file once all parts are available.
+
+  Files are identified by the name given in the yEnc header, or, for
+  uuencoded posts, by the Subject with the "(n/m)" part counter removed.
+
+  The encoded parts are written to a temporary file as they are added, and
+  only their positions are kept in memory. writeTo() loads and decodes a
+  window of as many parts as there are threads at a time, in parallel, and
+  streams them to the device in order, so memory use is bounded by the size
+  of that window rather than by the size of the file. Should the temporary
+  file not be writable, parts are kept in memory instead.
+
+  @code
+  KMime::PartialReassembler reassembler;
+  for (const KMime::NewsArticle::Ptr &article : articles) {
+      reassembler.addPart(article);
+  }
+  const auto files = reassembler.files();
+  for (const QByteArray &file : files) {
+      if (reassembler.isComplete(file)) {
+          QFile out(QString::fromUtf8(file));
+          out.open(QIODevice::WriteOnly);
+          reassembler.writeTo(file, &out);
+      }
+  }
+  @endcode
+
+  @since 5.23
+*/
+class KMIME_EXPORT PartialReassembler
+{
+public:
+    /**
+      Describes the outcome of writeTo().
+    */
+    enum Status {
+        Success, ///< the file was decoded and written completely
+        Incomplete, ///< not all parts of the file have been added yet
+        CorruptPart, ///< a part could not be decoded or failed its CRC check
+        WriteError ///< writing to the device failed
+    };
+
+    /**
+      Creates an empty PartialReassembler.
+    */
+    PartialReassembler();
+
+    /**
+      Destroys this PartialReassembler.
+    */
+    ~PartialReassembler();
+
+    /**
+      Adds one part of a split binary post.
+
+      The article's body is inspected for a yEnc or uuencoded part; the
+      part number and count are taken from the yEnc header or, for
+      uuencoded data, from the "(n/m)" counter in the Subject. A part
+      that was already added is replaced.
+
+      @param article the news article carrying the part.
+      @return true if the article carries a binary part, false otherwise.
+    */
+    bool addPart(const NewsArticle::Ptr &article);
+
+    /**
+      Returns the identifiers of all files a part has been added for.
+    */
+    Q_REQUIRED_RESULT QVector<QByteArray> files() const;
+
+    /**
+      Returns the number of parts @p file was posted in, or 0 if the
+      file is unknown.
+    */
+    Q_REQUIRED_RESULT int partCount(const QByteArray &file) const;
+
+    /**
+      Returns the number of distinct parts added for @p file so far.
+    */
+    Q_REQUIRED_RESULT int receivedPartCount(const QByteArray &file) const;
+
+    /**
+      Returns true if all parts of @p file have been added.
+    */
+    Q_REQUIRED_RESULT bool isComplete(const QByteArray &file) const;
+
+    /**
+      Decodes all parts of @p file and writes the joined binary data
+      to @p device, which must be open for writing.
+
+      Writing stops at the first part that cannot be decoded or whose
+      CRC32 does not match; data of the preceding parts has already been
+      written in that case.
+
+      The parts are read back from the temporary file they were stored in,
+      so this must not be called for the same file from several threads at
+      once.
+    */
+    Status writeTo(const QByteArray &file, QIODevice *device) const;
+
+    /**
+      Forgets all parts added for @p file.
+    */
+    void removeFile(const QByteArray &file);
+
+    /**
+      Forgets all parts of all files.
+    */
+    void clear();
+
+private:
+    //@cond PRIVATE
+    Q_DISABLE_COPY(PartialReassembler)
+    std::unique_ptr<PartialReassemblerPrivate> const d;
+    //@endcond
+};
+
+} // namespace KMime
+
@@ -0,0 +1,265 @@
+/*
+    kmime_smtpwriter.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the SmtpWriter class.
+
+  @brief
+  Defines the SmtpWriter class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#include "kmime_smtpwriter.h"
+#include "kmime_content.h"
+
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace KMime;
+
+//@cond PRIVATE
+class KMime::SmtpWriterPrivate
+{
+public:
+    // Writes @p content to @p device, the bodies of binary parts unconverted.
+    bool write(Content *content, QIODevice *device);
+    // Converts the next @p len bytes of the encoded Content.
+    bool convert(const char *data, qint64 len);
+    bool finish();
+    bool append(const char *data, qint64 len);
+    bool append(const QByteArray &data, QIODevice *device);
+
+    // What convert() does with the bytes it gets.
+    enum State {
+        Convert, ///< convert everything
+        ConvertHead, ///< convert up to the empty line, then switch to Copy
+        Copy ///< pass everything on as it is
+    };
+
+    SmtpWriter::Mode mode;
+    int chunkSize;
+    SmtpWriter::ChunkHandler handler;
+    QByteArray buffer;
+    State state = Convert;
+    char prev = '\n'; // the last byte converted, LF at the start of a line or after a copied body
+};
+
+namespace
+{
+
+// Passes everything written to it through SmtpWriterPrivate::convert().
+class ConvertingDevice : public QIODevice
+{
+public:
+    explicit ConvertingDevice(SmtpWriterPrivate *d)
+        : d(d)
+    {
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+        return -1;
+    }
+
+    qint64 writeData(const char *data, qint64 len) override
+    {
+        return d->convert(data, len) ? len : -1;
+    }
+
+private:
+    SmtpWriterPrivate *const d;
+};
+
+} // namespace
+
+bool SmtpWriterPrivate::append(const char *data, qint64 len)
+{
+    while (len > 0) {
+        const qint64 n = std::min<qint64>(len, chunkSize - buffer.size());
+        buffer.append(data, n);
+        data += n;
+        len -= n;
+        if (buffer.size() == chunkSize) {
+            if (!handler(buffer, false)) {
+                return false;
+            }
+            buffer.clear();
+            buffer.reserve(chunkSize);
+        }
+    }
+    return true;
+}
+
+bool SmtpWriterPrivate::convert(const char *data, qint64 len)
+{
+    const char *p = data;
+    const char *const end = data + len;
+    while (p < end) {
+        if (state == Copy) {
+            if (!append(p, end - p)) {
+                return false;
+            }
+            break;
+        }
+        if (mode == SmtpWriter::Data && prev == '\n' && *p == '.') {
+            if (!append(".", 1)) {
+                return false;
+            }
+        }
+        const auto lf = static_cast<const char *>(memchr(p, '\n', end - p));
+        const char *const lineEnd = lf ? lf : end;
+        if (lineEnd > p) {
+            if (!append(p, lineEnd - p)) {
+                return false;
+            }
+            prev = lineEnd[-1];
+        }
+        if (!lf) {
+            break;
+        }
+        // the empty line that ends a head
+        const bool emptyLine = lf == p && prev == '\n';
+        // LF becomes CRLF, an existing CRLF is kept
+        if (!(prev == '\r' ? append("\n", 1) : append("\r\n", 2))) {
+            return false;
+        }
+        prev = '\n';
+        p = lf + 1;
+        if (emptyLine && state == ConvertHead) {
+            state = Copy;
+        }
+    }
+    return true;
+}
+
+bool SmtpWriterPrivate::append(const QByteArray &data, QIODevice *device)
+{
+    return device->write(data) == data.size();
+}
+
+bool SmtpWriterPrivate::write(Content *content, QIODevice *device)
+{
+    if (SmtpWriter::bodyType(content) != SmtpWriter::BinaryMime) {
+        return content->writeEncodedContent(device);
+    }
+
+    const auto contents = content->contents();
+    if (content->isFrozen() || contents.isEmpty()) {
+        // the head is converted, the body kept as it is
+        state = ConvertHead;
+        const bool result = content->writeEncodedContent(device);
+        // the body does not count as converted: the LF of the following
+        // delimiter becomes CRLF even if the body ends with CR
+        state = Convert;
+        prev = '\n';
+        return result;
+    }
+
+    // A multipart or encapsulated message with binary parts, written the
+    // same way as by Content::encodedContent().
+    const QByteArray boundary = "\n--" + content->contentType()->boundary();
+    const QByteArray preamble = content->preamble();
+    const QByteArray bodyStart = (content->bodyIsMessage() ? contents.first()->head() : preamble + boundary).left(2);
+    QByteArray start = content->head();
+    if (!start.endsWith("\n\n") && !bodyStart.startsWith("\n\n") &&
+        !(start.endsWith('\n') && bodyStart.startsWith('\n'))) {
+        start += '\n';
+    }
+    if (!append(start, device)) {
+        return false;
+    }
+    if (content->bodyIsMessage()) {
+        return write(contents.first(), device);
+    }
+    if (!append(preamble, device)) {
+        return false;
+    }
+    for (Content *c : contents) {
+        if (!append(boundary + '\n', device) || !write(c, device)) {
+            return false;
+        }
+    }
+    return append(boundary + "--\n", device) && append(content->epilogue(), device);
+}
+
+bool SmtpWriterPrivate::finish()
+{
+    if (mode == SmtpWriter::Data) {
+        if (prev != '\n' && !append("\r\n", 2)) {
+            return false;
+        }
+        if (!append(".\r\n", 3)) {
+            return false;
+        }
+    }
+    const bool result = handler(buffer, true);
+    buffer.clear();
+    return result;
+}
+//@endcond
+
+SmtpWriter::SmtpWriter(Mode mode, int chunkSize, const ChunkHandler &handler)
+    : d(new SmtpWriterPrivate)
+{
+    d->mode = mode;
+    d->chunkSize = std::max(chunkSize, 1);
+    d->handler = handler;
+}
+
+SmtpWriter::~SmtpWriter() = default;
+
+bool SmtpWriter::write(Content *content)
+{
+    if (d->mode == Data && bodyType(content) == BinaryMime) {
+        // binary data cannot be sent with DATA
+        return false;
+    }
+
+    d->buffer.clear();
+    d->buffer.reserve(d->chunkSize);
+    d->state = SmtpWriterPrivate::Convert;
+    d->prev = '\n';
+
+    ConvertingDevice device(d.get());
+    device.open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    if (!d->write(content, &device)) {
+        d->buffer.clear();
+        return false;
+    }
+    return d->finish();
+}
+
+SmtpWriter::BodyType SmtpWriter::bodyType(Content *content)
+{
+    BodyType type = SevenBit;
+    if (const auto cte = content->contentTransferEncoding(false)) {
+        if (cte->encoding() == Headers::CEbinary) {
+            return BinaryMime;
+        }
+        if (cte->encoding() == Headers::CE8Bit) {
+            type = EightBitMime;
+        }
+    }
+    const auto contents = content->contents();
+    for (Content *c : contents) {
+        type = std::max(type, bodyType(c));
+        if (type == BinaryMime) {
+            break;
+        }
+    }
+    return type;
+}
@@ -0,0 +1,128 @@
+/*
+    kmime_smtpwriter.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+/**
+  @file
+  This file is part of the API for handling @ref MIME data and
+  defines the SmtpWriter class.
+
+  @brief
+  Defines the SmtpWriter class.
+
+  @authors the KMime authors (see AUTHORS file)
+*/
+
+#pragma once
+
+#include "kmime_export.h"
+
+#include <QByteArray>
+
+#include <functional>
+#include <memory>
+
+namespace KMime
+{
+class Content;
+class SmtpWriterPrivate;
+
+/**
+  @brief
+  Writes a Content as the data of an SMTP transaction.
+
+  The encoded Content is converted in a single pass while it is written:
+  all line breaks become CRLF and, for the DATA command, lines starting
+  with a dot are dot-stuffed and the terminating "." line is added. The
+  result is passed on in chunks of a fixed size, which can be sent as they
+  are after DATA, or each with a BDAT command (RFC 3030).
+
+  The bodies of parts with the Content-Transfer-Encoding "binary" are
+  passed on unchanged. Such Contents can only be sent with BDAT, see
+  bodyType().
+
+  Bodies with a body source, see Content::setBodySource(), are read and
+  encoded while they are written; the complete message is never held in
+  memory.
+
+  @code
+  KMime::SmtpWriter writer(KMime::SmtpWriter::Bdat, 64 * 1024,
+                           [&socket](const QByteArray &chunk, bool last) {
+      socket.write("BDAT " + QByteArray::number(chunk.size()) + (last ? " LAST\r\n" : "\r\n"));
+      return socket.write(chunk) == chunk.size();
+  });
+  writer.write(message.data());
+  @endcode
+
+  @since 5.23
+*/
+class KMIME_EXPORT SmtpWriter
+{
+public:
+    /**
+      The SMTP command the data is written for.
+    */
+    enum Mode {
+        Data, ///< DATA: dot-stuffed and terminated by a "." line
+        Bdat ///< BDAT (CHUNKING): sent as is
+    };
+
+    /**
+      The BODY parameter of the MAIL command a Content needs, see bodyType().
+    */
+    enum BodyType {
+        SevenBit, ///< no parameter or BODY=7BIT
+        EightBitMime, ///< BODY=8BITMIME (RFC 6152)
+        BinaryMime ///< BODY=BINARYMIME (RFC 3030), only with BDAT
+    };
+
+    /**
+      Called with each chunk of data; @p last is true for the final chunk,
+      which may be shorter than the chunk size or empty. Returns false to
+      stop writing.
+    */
+    using ChunkHandler = std::function<bool(const QByteArray &chunk, bool last)>;
+
+    /**
+      Creates a SmtpWriter that passes chunks of @p chunkSize bytes
+      to @p handler.
+    */
+    SmtpWriter(Mode mode, int chunkSize, const ChunkHandler &handler);
+
+    /**
+      Destroys this SmtpWriter.
+    */
+    ~SmtpWriter();
+
+    /**
+      Writes the encoded @p content, as returned by
+      Content::encodedContent(), and finishes with the last chunk.
+
+      As for Content::encodedContent(), call Content::assemble() after
+      modifying the Content.
+
+      @return false if the handler returned false, a body source could
+      not be read, or @p content needs BinaryMime in Data mode.
+    */
+    bool write(Content *content);
+
+    /**
+      Returns the BODY parameter needed to send @p content, according to
+      the Content-Transfer-Encoding of it and all its sub-Contents.
+    */
+    Q_REQUIRED_RESULT static BodyType bodyType(Content *content);
+
+private:
+    //@cond PRIVATE
+    Q_DISABLE_COPY(SmtpWriter)
+    std::unique_ptr<SmtpWriterPrivate> const d;
+    //@endcond
+};
+
+} // namespace KMime
+
@@ -0,0 +1,400 @@
+/*
+    kmime_transferencoding.cpp
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kmime_transferencoding_p.h"
+
+#include <KCodecs>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace KMime;
+
+namespace
+{
+
+QByteArray identity(const QByteArray &body)
+{
+    return body;
+}
+
+QByteArray base64EncodeBody(const QByteArray &body)
+{
+    QByteArray result = TransferEncoding::base64Encode(body);
+    result += '\n';
+    return result;
+}
+
+QByteArray uudecode(const QByteArray &body)
+{
+    return KCodecs::uudecode(body);
+}
+
+// How a Content-Transfer-Encoding is encoded and decoded.
+struct Entry {
+    const char *codecName; // for KCodecs::Codec::codecForName()
+    QByteArray (*encode)(const QByteArray &);
+    QByteArray (*decode)(const QByteArray &);
+};
+
+// Indexed by Headers::contentEncoding.
+const int entryCount = 6;
+const Entry entries[entryCount] = {
+    {nullptr, identity, identity}, // CE7Bit
+    {nullptr, identity, identity}, // CE8Bit
+    {"quoted-printable", TransferEncoding::quotedPrintableEncode, TransferEncoding::quotedPrintableDecode}, // CEquPr
+    {"base64", base64EncodeBody, TransferEncoding::base64Decode}, // CEbase64
+    {"x-uuencode", identity, uudecode}, // CEuuenc, KCodecs cannot encode it
+    {nullptr, identity, identity}, // CEbinary
+};
+
+int entryIndex(Headers::contentEncoding encoding)
+{
+    return (encoding >= 0 && encoding < entryCount) ? encoding : Headers::CE7Bit;
+}
+
+const char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const int base64QuadsPerLine = 76 / 4;
+
+// The two base64 characters of every 12 bit value, so that three bytes
+// are encoded with two lookups.
+using Base64Pairs = std::array<std::array<char, 2>, 4096>;
+
+Base64Pairs makeBase64Pairs()
+{
+    Base64Pairs pairs;
+    for (int i = 0; i < 4096; ++i) {
+        pairs[i] = {base64Chars[i >> 6], base64Chars[i & 63]};
+    }
+    return pairs;
+}
+
+// The 6 bit value of every base64 character, -1 for other characters.
+using Base64Values = std::array<qint8, 256>;
+
+Base64Values makeBase64Values()
+{
+    Base64Values values;
+    values.fill(-1);
+    for (int i = 0; i < 64; ++i) {
+        values[static_cast<uchar>(base64Chars[i])] = i;
+    }
+    return values;
+}
+
+// Quoted-printable lines get a soft line break once they are longer.
+const int qpMaxLineLength = 70;
+
+inline bool isQpLiteral(uchar c)
+{
+    return c >= 33 && c <= 126 && c != '=';
+}
+
+// Whether any of the eight bytes in @p x is not a literal, without
+// looking at them one by one.
+inline bool hasQpNonLiteral(quint64 x)
+{
+    const quint64 ones = 0x0101010101010101ULL;
+    const quint64 highBits = ones * 0x80;
+    const quint64 below = (x - ones * 33) & ~x & highBits;
+    const quint64 above = ((x + ones) | x) & highBits;
+    const quint64 equals = x ^ (ones * '=');
+    return below | above | ((equals - ones) & ~equals & highBits);
+}
+
+// The number of literal bytes at @p data, at most @p max.
+int qpLiteralRun(const char *data, int max)
+{
+    int n = 0;
+    for (; n + 8 <= max; n += 8) {
+        quint64 x;
+        memcpy(&x, data + n, 8);
+        if (hasQpNonLiteral(x)) {
+            break;
+        }
+    }
+    while (n < max && isQpLiteral(data[n])) {
+        ++n;
+    }
+    return n;
+}
+
+// Quoted-printable encoding the way KCodecs::quotedPrintableEncode() does
+// it, which determines the soft line breaks. Only counts the output if
+// Write is false.
+template<bool Write>
+int qpEncode(const char *data, int size, char *out)
+{
+    static const char hexChars[] = "0123456789ABCDEF";
+    const char *const begin = out;
+    int lineLength = 0;
+    int i = 0;
+    while (i < size) {
+        // lineLength <= qpMaxLineLength here
+        const int run = qpLiteralRun(data + i, std::min(size - i, qpMaxLineLength + 1 - lineLength));
+        if (run > 0) {
+            if (Write) {
+                memcpy(out, data + i, run);
+            }
+            out += run;
+            i += run;
+            lineLength += run;
+        } else {
+            const uchar c = data[i++];
+            if (c == '\n') {
+                if (Write) {
+                    *out = '\n';
+                }
+                ++out;
+                lineLength = 0;
+            } else if (c == ' ' && (i == size || data[i] != '\n')) {
+                // KCodecs leaves a space at the very end alone
+                if (Write) {
+                    *out = ' ';
+                }
+                ++out;
+                ++lineLength;
+            } else {
+                if (Write) {
+                    out[0] = '=';
+                    out[1] = hexChars[c >> 4];
+                    out[2] = hexChars[c & 15];
+                }
+                out += 3;
+                lineLength += 3;
+            }
+        }
+        if (lineLength > qpMaxLineLength && i < size) {
+            if (Write) {
+                out[0] = '=';
+                out[1] = '\n';
+            }
+            out += 2;
+            lineLength = 0;
+        }
+    }
+    return out - begin;
+}
+
+inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+} // namespace
+
+const KCodecs::Codec *TransferEncoding::codec(Headers::contentEncoding encoding)
+{
+    static const auto codecs = [] {
+        std::array<const KCodecs::Codec *, entryCount> codecs;
+        for (int i = 0; i < entryCount; ++i) {
+            codecs[i] = entries[i].codecName ? KCodecs::Codec::codecForName(entries[i].codecName) : nullptr;
+        }
+        return codecs;
+    }();
+    return codecs[entryIndex(encoding)];
+}
+
+QByteArray TransferEncoding::encode(const QByteArray &body, Headers::contentEncoding encoding)
+{
+    return entries[entryIndex(encoding)].encode(body);
+}
+
+QByteArray TransferEncoding::decode(const QByteArray &body, Headers::contentEncoding encoding)
+{
+    return entries[entryIndex(encoding)].decode(body);
+}
+
+QByteArray TransferEncoding::base64Encode(const QByteArray &data)
+{
+    static const Base64Pairs pairs = makeBase64Pairs();
+
+    const int quads = (data.size() + 2) / 3;
+    if (quads == 0) {
+        return {};
+    }
+    QByteArray result(quads * 4 + (quads - 1) / base64QuadsPerLine, Qt::Uninitialized);
+    auto in = reinterpret_cast<const uchar *>(data.constData());
+    char *out = result.data();
+
+    const int fullQuads = data.size() / 3;
+    int i = 0;
+    while (i < fullQuads) {
+        if (i != 0) {
+            *out++ = '\n';
+        }
+        const int lineEnd = std::min(i + base64QuadsPerLine, fullQuads);
+        for (; i < lineEnd; ++i, in += 3, out += 4) {
+            const uint value = uint(in[0]) << 16 | uint(in[1]) << 8 | in[2];
+            memcpy(out, pairs[value >> 12].data(), 2);
+            memcpy(out + 2, pairs[value & 0xfff].data(), 2);
+        }
+    }
+
+    const int rest = data.size() - fullQuads * 3;
+    if (rest > 0) {
+        if (fullQuads != 0 && fullQuads % base64QuadsPerLine == 0) {
+            *out++ = '\n';
+        }
+        const uint value = uint(in[0]) << 16 | (rest == 2 ? uint(in[1]) << 8 : 0);
+        out[0] = base64Chars[value >> 18];
+        out[1] = base64Chars[(value >> 12) & 63];
+        out[2] = rest == 2 ? base64Chars[(value >> 6) & 63] : '=';
+        out[3] = '=';
+    }
+    return result;
+}
+
+QByteArray TransferEncoding::base64Decode(const QByteArray &data)
+{
+    static const Base64Values values = makeBase64Values();
+
+    // Decodes well-formed base64 with line breaks; everything else is left
+    // to KCodecs, which knows how to recover from broken input.
+    QByteArray result(data.size() / 4 * 3 + 3, Qt::Uninitialized);
+    auto out = reinterpret_cast<uchar *>(result.data());
+    const char *p = data.constData();
+    const char *const end = p + data.size();
+    uint quad = 0;
+    int n = 0;
+    while (p < end) {
+        if (n == 0 && end - p >= 4) {
+            const int a = values[static_cast<uchar>(p[0])];
+            const int b = values[static_cast<uchar>(p[1])];
+            const int c = values[static_cast<uchar>(p[2])];
+            const int d = values[static_cast<uchar>(p[3])];
+            if ((a | b | c | d) >= 0) {
+                const uint value = uint(a) << 18 | uint(b) << 12 | uint(c) << 6 | uint(d);
+                out[0] = value >> 16;
+                out[1] = value >> 8;
+                out[2] = value;
+                out += 3;
+                p += 4;
+                continue;
+            }
+        }
+        if (*p == '\n' || *p == '\r') {
+            ++p;
+            continue;
+        }
+        const int value = values[static_cast<uchar>(*p)];
+        if (value < 0) {
+            break;
+        }
+        quad = quad << 6 | uint(value);
+        ++p;
+        if (++n == 4) {
+            out[0] = quad >> 16;
+            out[1] = quad >> 8;
+            out[2] = quad;
+            out += 3;
+            quad = 0;
+            n = 0;
+        }
+    }
+
+    if (p != end) {
+        // "xx==" or "xxx=" ends the data, only line breaks may follow
+        const int padding = 4 - n;
+        if (n < 2 || end - p < padding || memcmp(p, "==", padding) != 0) {
+            return KCodecs::base64Decode(data);
+        }
+        for (p += padding; p < end; ++p) {
+            if (*p != '\n' && *p != '\r') {
+                return KCodecs::base64Decode(data);
+            }
+        }
+        if (n == 2) {
+            *out++ = quad >> 4;
+        } else {
+            *out++ = quad >> 10;
+            *out++ = quad >> 2;
+        }
+        n = 0;
+    }
+    if (n != 0) {
+        return KCodecs::base64Decode(data);
+    }
+    result.truncate(out - reinterpret_cast<uchar *>(result.data()));
+    return result;
+}
+
+int TransferEncoding::quotedPrintableEncodedSize(const char *data, int size)
+{
+    return qpEncode<false>(data, size, nullptr);
+}
+
+int TransferEncoding::quotedPrintableEncode(const char *data, int size, char *out)
+{
+    return qpEncode<true>(data, size, out);
+}
+
+QByteArray TransferEncoding::quotedPrintableEncode(const QByteArray &data)
+{
+    QByteArray result(quotedPrintableEncodedSize(data.constData(), data.size()), Qt::Uninitialized);
+    quotedPrintableEncode(data.constData(), data.size(), result.data());
+    return result;
+}
+
+int TransferEncoding::quotedPrintableDecode(const char *data, int size, char *out)
+{
+    const char *const begin = out;
+    const char *p = data;
+    const char *const end = data + size;
+    while (p < end) {
+        // everything up to the next '=' is copied as it is
+        const auto equals = static_cast<const char *>(memchr(p, '=', end - p));
+        const char *const runEnd = equals ? equals : end;
+        memcpy(out, p, runEnd - p);
+        out += runEnd - p;
+        if (!equals) {
+            break;
+        }
+        // KCodecs has its own ideas about a '=' in the last two bytes
+        if (end - equals < 3) {
+            return -1;
+        }
+        if (equals[1] == '\n') {
+            p = equals + 2;
+        } else if (equals[1] == '\r' && equals[2] == '\n') {
+            p = equals + 3;
+        } else {
+            const int high = hexValue(equals[1]);
+            const int low = hexValue(equals[2]);
+            if (high < 0 || low < 0) {
+                return -1;
+            }
+            *out++ = char(high << 4 | low);
+            p = equals + 3;
+        }
+    }
+    return out - begin;
+}
+
+QByteArray TransferEncoding::quotedPrintableDecode(const QByteArray &data)
+{
+    QByteArray result(data.size(), Qt::Uninitialized);
+    const int size = quotedPrintableDecode(data.constData(), data.size(), result.data());
+    if (size < 0) {
+        return KCodecs::quotedPrintableDecode(data);
+    }
+    result.truncate(size);
+    return result;
+}
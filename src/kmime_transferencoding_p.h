@@ -0,0 +1,97 @@
+/*
+    kmime_transferencoding_p.h
+
+    KMime, the KDE Internet mail/usenet news message library.
+    SPDX-FileCopyrightText: 2001 the KMime authors.
+    See file AUTHORS for details
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+// @cond PRIVATE
+
+#include "kmime_headers.h"
+
+#include <QByteArray>
+
+namespace KCodecs
+{
+class Codec;
+}
+
+/* Internal helper functions. Not part of the public API. */
+
+namespace KMime
+{
+
+namespace TransferEncoding
+{
+
+/**
+  Returns the codec for the Content-Transfer-Encoding @p encoding, nullptr
+  for 7bit, 8bit and binary. The codecs are looked up only once.
+*/
+const KCodecs::Codec *codec(Headers::contentEncoding encoding);
+
+/**
+  Returns @p body encoded in @p encoding, as it is written by
+  Content::encodedContent(): base64 ends with a line break. Encodings
+  that cannot be applied here return @p body as it is.
+*/
+QByteArray encode(const QByteArray &body, Headers::contentEncoding encoding);
+
+/**
+  Returns @p body decoded from @p encoding.
+*/
+QByteArray decode(const QByteArray &body, Headers::contentEncoding encoding);
+
+/**
+  Same as KCodecs::base64Encode(data, out, true): lines of 76 characters,
+  without a line break at the end.
+*/
+QByteArray base64Encode(const QByteArray &data);
+
+/**
+  Same as KCodecs::base64Decode().
+*/
+QByteArray base64Decode(const QByteArray &data);
+
+/**
+  Returns the size of the quoted-printable encoding of the @p size bytes
+  at @p data.
+*/
+int quotedPrintableEncodedSize(const char *data, int size);
+
+/**
+  Writes the quoted-printable encoding of the @p size bytes at @p data to
+  @p out, which must have room for quotedPrintableEncodedSize() bytes.
+  The result is the same as KCodecs::quotedPrintableEncode(data, false).
+  @return the number of bytes written.
+*/
+int quotedPrintableEncode(const char *data, int size, char *out);
+
+/**
+  Same as KCodecs::quotedPrintableEncode(data, false).
+*/
+QByteArray quotedPrintableEncode(const QByteArray &data);
+
+/**
+  Writes the decoded @p size bytes of quoted-printable at @p data to
+  @p out, which must have room for @p size bytes.
+  @return the number of bytes written, -1 if the input contains a '='
+  that is neither an escape nor a soft line break.
+*/
+int quotedPrintableDecode(const char *data, int size, char *out);
+
+/**
+  Same as KCodecs::quotedPrintableDecode().
+*/
+QByteArray quotedPrintableDecode(const QByteArray &data);
+
+} // namespace TransferEncoding
+
+} // namespace KMime
+
+// @endcond
@@ -11,6 +11,7 @@
 #include "kmime_codecs.h"
 #include "kmime_header_parsing.h"
 #include "kmime_header_parsing_p.h"
+#include "kmime_idn_p.h"
 #include "kmime_util.h"
 #include "kmime_util_p.h"
 #include "kmime_debug.h"
@@ -18,7 +19,6 @@
 #include <KCodecs>
 
 #include <QStringList>
-#include <QUrl>
 
 namespace KMime
 {
@@ -26,17 +26,6 @@ namespace KMime
 namespace Types
 {
 
-// QUrl::fromAce is extremely expensive, so only use it when necessary.
-// Fortunately, the presence of IDNA is readily detected with a substring match...
-static inline QString QUrl_fromAce_wrapper(const QString &domain)
-{
-    if (domain.contains(QLatin1String("xn--"))) {
-        return QUrl::fromAce(domain.toLatin1());
-    } else {
-        return domain;
-    }
-}
-
 static QString addr_spec_as_string(const AddrSpec &as, bool pretty)
 {
     if (as.isEmpty()) {
@@ -62,7 +51,7 @@ static QString addr_spec_as_string(const AddrSpec &as, bool pretty)
             result += ch;
         }
     }
-    const QString dom = pretty ? QUrl_fromAce_wrapper(as.domain) : as.domain ;
+    const QString dom = pretty ? Idn::fromAce(as.domain) : as.domain ;
     if (needsQuotes) {
         result = quoteChar + result + quoteChar;
     }
@@ -178,10 +167,21 @@ void Mailbox::from7BitString(const QByteArray &s)
     HeaderParsing::parseMailbox(cursor, cursor + s.length(), *this);
 }
 
+// Same as Mailbox::address(), but with a non-ASCII domain in ACE.
+static QByteArray address_as_7bit(const AddrSpec &as)
+{
+    if (isUsAscii(as.domain)) {
+        return addr_spec_as_string(as, false).toLatin1();
+    }
+    AddrSpec aceAddrSpec = as;
+    aceAddrSpec.domain = Idn::toAce(as.domain);
+    return addr_spec_as_string(aceAddrSpec, false).toLatin1();
+}
+
 QByteArray Mailbox::as7BitString(const QByteArray &encCharset) const
 {
     if (!hasName()) {
-        return address();
+        return address_as_7bit(mAddrSpec);
     }
     QByteArray rv;
     if (isUsAscii(name())) {
@@ -192,7 +192,7 @@ QByteArray Mailbox::as7BitString(const QByteArray &encCharset) const
         rv += encodeRFC2047String(name(), encCharset, true);
     }
     if (hasAddress()) {
-        rv += " <" + address() + '>';
+        rv += " <" + address_as_7bit(mAddrSpec) + '>';
     }
     return rv;
 }
@@ -155,6 +155,27 @@ struct KMIME_EXPORT Address {
 };
 typedef QVector<Address> AddressList;
 
+/**
+  The lookups in the cache of IDN domain conversions, which is used by
+  AddrSpec::asPrettyString() to decode ACE domains ("xn--...") and by
+  Mailbox::as7BitString() to encode non-ASCII domains. Only domains that
+  need a conversion are looked up.
+
+  @since 5.23
+*/
+struct KMIME_EXPORT IdnCacheStatistics {
+    quint64 hits = 0; ///< lookups answered from the cache
+    quint64 misses = 0; ///< lookups that needed a conversion by QUrl
+};
+
+/**
+  Returns the hits and misses of the IDN cache since the start of the
+  program, for all threads.
+
+  @since 5.23
+*/
+Q_REQUIRED_RESULT KMIME_EXPORT IdnCacheStatistics idnCacheStatistics();
+
 } // namespace KMime::Types
 
 } // namespace KMime
@@ -17,14 +17,13 @@
 #include "kmime_message.h"
 #include "kmime_warning.h"
 
-#include <config-kmime.h>
-
 #include <KCharsets>
 #include <QCoreApplication>
 #include <QRegularExpression>
 
 #include <cctype>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 
 using namespace KMime;
@@ -73,9 +72,13 @@ QString nameForEncoding(Headers::contentEncoding enc)
 }
 
 QVector<Headers::contentEncoding> encodingsForData(const QByteArray &data)
+{
+    return encodingsForCharFreq(CharFreq(data));
+}
+
+QVector<Headers::contentEncoding> encodingsForCharFreq(const CharFreq &cf)
 {
     QVector<Headers::contentEncoding> allowed;
-    CharFreq cf(data);
 
     switch (cf.type()) {
     case CharFreq::SevenBitText:
@@ -374,76 +377,105 @@ int findHeaderLineEnd(const QByteArray &src, int &dataBegin, bool *folded)
     return end;
 }
 
-#if !HAVE_STRCASESTR
-#ifdef WIN32
-#define strncasecmp _strnicmp
-#endif
-static const char *strcasestr(const char *haystack, const char *needle)
+namespace
 {
-    /* Copied from libreplace as part of qtwebengine 5.5.1 */
-    const char *s;
-    size_t nlen = strlen(needle);
-    for (s = haystack; *s; s++) {
-        if (toupper(*needle) == toupper(*s) && strncasecmp(s, needle, nlen) == 0) {
-            return (char *)((uintptr_t)s);
-        }
+
+// Returns whether the line starting at @p line is a field of the header
+// @p name, i.e. starts with @p name (case-insensitive) directly followed by ':'.
+bool isHeaderLine(const char *line, const char *const end, const QByteArray &name)
+{
+    return end - line > name.length() && line[name.length()] == ':' &&
+           qstrnicmp(line, name.constData(), name.length()) == 0;
+}
+
+// Returns the start of the line following the one containing @p pos, or @p end.
+const char *nextLineStart(const char *pos, const char *const end)
+{
+    const auto lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos));
+    return lineEnd ? lineEnd + 1 : end;
+}
+
+// Returns the unfolded body of the header field starting at @p dataBegin,
+// the index after the colon.
+QByteArray headerFieldBody(const QByteArray &src, int dataBegin)
+{
+    // skip the usual space after the colon
+    if (dataBegin < src.length() && src.at(dataBegin) == ' ') {
+        ++dataBegin;
+    }
+    bool folded;
+    const int end = findHeaderLineEnd(src, dataBegin, &folded);
+    if (!folded) {
+        return src.mid(dataBegin, end - dataBegin);
+    }
+    if (end > dataBegin) {
+        return unfoldHeader(src.constData() + dataBegin, end - dataBegin);
     }
-    return NULL;
+    return {};
 }
-#endif
+
+} // namespace
 
 int indexOfHeader(const QByteArray &src, const QByteArray &name, int &end, int &dataBegin, bool *folded)
 {
-    QByteArray n = name;
-    n.append(':');
-    int begin = -1;
-
-    if (qstrnicmp(n.constData(), src.constData(), n.length()) == 0) {
-        begin = 0;
-    } else {
-        n.prepend('\n');
-        const char *p = strcasestr(src.constData(), n.constData());
-        if (!p) {
-            begin = -1;
-        } else {
-            begin = p - src.constData();
-            ++begin;
+    const char *const srcBegin = src.constData();
+    const char *const srcEnd = srcBegin + src.size();
+    for (const char *line = srcBegin; line < srcEnd; line = nextLineStart(line, srcEnd)) {
+        if (isHeaderLine(line, srcEnd, name)) {   //there is a header with the given name
+            const int begin = line - srcBegin;
+            dataBegin = begin + name.length() + 1; //skip the name
+            // skip the usual space after the colon
+            if (dataBegin < src.length() && src.at(dataBegin) == ' ') {
+                ++dataBegin;
+            }
+            end = findHeaderLineEnd(src, dataBegin, folded);
+            return begin;
         }
     }
 
-    if (begin > -1) {       //there is a header with the given name
-        dataBegin = begin + name.length() + 1; //skip the name
-        // skip the usual space after the colon
-        if (dataBegin < src.length() && src.at(dataBegin) == ' ') {
-            ++dataBegin;
-        }
-        end = findHeaderLineEnd(src, dataBegin, folded);
-        return begin;
+    end = -1;
+    dataBegin = -1;
+    return -1; //header not found
+}
 
-    } else {
-        end = -1;
-        dataBegin = -1;
-        return -1; //header not found
+QByteArray extractHeader(const QByteArray &src, const QByteArray &name)
+{
+    const char *const srcBegin = src.constData();
+    const char *const srcEnd = srcBegin + src.size();
+    for (const char *line = srcBegin; line < srcEnd; line = nextLineStart(line, srcEnd)) {
+        if (isHeaderLine(line, srcEnd, name)) {
+            return headerFieldBody(src, line - srcBegin + name.length() + 1);
+        }
     }
+    return {};
 }
 
-QByteArray extractHeader(const QByteArray &src, const QByteArray &name)
+QVector<QByteArray> extractHeaders(const QByteArray &src, const QVector<QByteArray> &names)
 {
-    int begin;
-    int end;
-    bool folded;
-    QByteArray result;
+    QVector<QByteArray> result(names.size());
+    QVector<bool> found(names.size(), false);
+    int missing = names.size();
 
-    if (src.isEmpty() || indexOfHeader(src, name, end, begin, &folded) < 0) {
-        return result;
+    // Lines are only compared against the names if their first character
+    // can start one of them, which rules out most lines with a table lookup.
+    bool isFirstChar[256] = {};
+    for (const QByteArray &name : names) {
+        const uchar first = name.isEmpty() ? ':' : name.at(0);
+        isFirstChar[std::tolower(first)] = true;
+        isFirstChar[std::toupper(first)] = true;
     }
 
-    if (begin >= 0) {
-        if (!folded) {
-            result = src.mid(begin, end - begin);
-        } else {
-            if (end > begin) {
-                result = unfoldHeader(src.constData() + begin, end - begin);
+    const char *const srcBegin = src.constData();
+    const char *const srcEnd = srcBegin + src.size();
+    for (const char *line = srcBegin; missing > 0 && line < srcEnd; line = nextLineStart(line, srcEnd)) {
+        if (!isFirstChar[static_cast<uchar>(*line)]) {
+            continue;
+        }
+        for (int i = 0; i < names.size(); ++i) {
+            if (!found.at(i) && isHeaderLine(line, srcEnd, names.at(i))) {
+                result[i] = headerFieldBody(src, line - srcBegin + names.at(i).length() + 1);
+                found[i] = true;
+                --missing;
             }
         }
     }
@@ -637,180 +669,37 @@ QString removeBidiControlChars(const QString &input)
 
 bool isCryptoPart(Content *content)
 {
-    auto ct = content->contentType(false);
-    if (!ct || !ct->isMediatype("application")) {
-        return false;
-    }
-
-    const QByteArray lowerSubType = ct->subType().toLower();
-    if (lowerSubType == "pgp-encrypted" ||
-        lowerSubType == "pgp-signature" ||
-        lowerSubType == "pkcs7-mime" ||
-        lowerSubType == "x-pkcs7-mime" ||
-        lowerSubType == "pkcs7-signature" ||
-        lowerSubType == "x-pkcs7-signature") {
-        return true;
-    }
-
-    if (lowerSubType == "octet-stream") {
-        auto cd = content->contentDisposition(false);
-        if (!cd) {
-            return false;
-        }
-        const auto fileName = cd->filename().toLower();
-        return fileName == QLatin1String("msg.asc") || fileName == QLatin1String("encrypted.asc");
-    }
-
-    return false;
+    return content && (content->classification() & Content::CryptoPart);
 }
 
 bool isAttachment(Content* content)
 {
-    if (!content) {
-        return false;
-    }
-
-    const auto contentType = content->contentType(false);
-    // multipart/* is never an attachment itself, message/rfc822 always is
-    if (contentType) {
-        if (contentType->isMultipart()) {
-            return false;
-        }
-        if (contentType->isMimeType("message/rfc822")) {
-            return true;
-        }
-    }
-
-    // the main body part is not an attachment
-    if (content->parent()) {
-        const auto top = content->topLevel();
-        if (content == top->textContent()) {
-            return false;
-        }
-    }
-
-    // ignore crypto parts
-    if (isCryptoPart(content)) {
-        return false;
-    }
-
-    // content type or content disposition having a file name set looks like an attachment
-    const auto contentDisposition = content->contentDisposition(false);
-    if (contentDisposition && !contentDisposition->filename().isEmpty()) {
-        return true;
-    }
-
-    if (contentType && !contentType->name().isEmpty()) {
-        return true;
-    }
-
-    // "attachment" content disposition is otherwise a good indicator though
-    if (contentDisposition && contentDisposition->disposition() == Headers::CDattachment) {
-        return true;
-    }
-
-    return false;
+    return content && (content->classification() & Content::Attachment);
 }
 
 bool hasAttachment(Content *content)
 {
-    if (!content) {
-        return false;
-    }
-
-    if (isAttachment(content)) {
-        return true;
-    }
-
-    // Ok, content itself is not an attachment. now we deal with multiparts
-    auto ct = content->contentType(false);
-    if (ct && ct->isMultipart() && !ct->isSubtype("related")) {// && !ct->isSubtype("alternative")) {
-        const auto contents = content->contents();
-        for (Content *child : contents) {
-            if (hasAttachment(child)) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return content && (content->classification() & Content::ContainsAttachment);
 }
 
 bool hasInvitation(Content *content)
 {
-    if (!content) {
-        return false;
-    }
-
-    if (isInvitation(content)) {
-        return true;
-    }
-
-    // Ok, content itself is not an invitation. now we deal with multiparts
-    if (content->contentType()->isMultipart()) {
-        const auto contents = content->contents();
-        for (Content *child : contents) {
-            if (hasInvitation(child)) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return content && (content->classification() & Content::ContainsInvitation);
 }
 
 bool isSigned(Message *message)
 {
-    if (!message) {
-        return false;
-    }
-
-    const KMime::Headers::ContentType *const contentType = message->contentType();
-    if (contentType->isSubtype("signed") ||
-            contentType->isSubtype("pgp-signature") ||
-            contentType->isSubtype("pkcs7-signature") ||
-            contentType->isSubtype("x-pkcs7-signature") ||
-            message->mainBodyPart("multipart/signed") ||
-            message->mainBodyPart("application/pgp-signature") ||
-            message->mainBodyPart("application/pkcs7-signature") ||
-            message->mainBodyPart("application/x-pkcs7-signature")) {
-        return true;
-    }
-    return false;
+    return message && (message->classification() & Content::Signed);
 }
 
 bool isEncrypted(Message *message)
 {
-    if (!message) {
-        return false;
-    }
-
-    const KMime::Headers::ContentType *const contentType = message->contentType();
-    if (contentType->isSubtype("encrypted") ||
-            contentType->isSubtype("pgp-encrypted") ||
-            contentType->isSubtype("pkcs7-mime") ||
-            contentType->isSubtype("x-pkcs7-mime") ||
-            message->mainBodyPart("multipart/encrypted") ||
-            message->mainBodyPart("application/pgp-encrypted") ||
-            message->mainBodyPart("application/pkcs7-mime") ||
-            message->mainBodyPart("application/x-pkcs7-mime")) {
-        return true;
-    }
-
-    return false;
+    return message && (message->classification() & Content::Encrypted);
 }
 
 bool isInvitation(Content *content)
 {
-    if (!content) {
-        return false;
-    }
-
-    const KMime::Headers::ContentType *const contentType = content->contentType(false);
-
-    if (contentType && contentType->isMediatype("text") && contentType->isSubtype("calendar")) {
-        return true;
-    }
-
-    return false;
+    return content && (content->classification() & Content::Invitation);
 }
 
 } // namespace KMime
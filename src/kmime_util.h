@@ -98,6 +98,22 @@ KMIME_EXPORT extern QByteArray foldHeader(const QByteArray &header);
 KMIME_EXPORT extern QByteArray extractHeader(const QByteArray &src,
         const QByteArray &name);
 
+/**
+  Extracts the headers with the names @p names from the string @p src in
+  a single pass, unfolding them if necessary.
+
+  This is faster than calling extractHeader() for each name.
+
+  @param src  the source string.
+  @param names the names of the headers to search for.
+
+  @return the first instance of each header, in the order of @p names;
+          a null QByteArray for each header that was not found.
+  @since 5.23
+*/
+Q_REQUIRED_RESULT KMIME_EXPORT extern QVector<QByteArray> extractHeaders(const QByteArray &src,
+        const QVector<QByteArray> &names);
+
 /**
   Converts all occurrences of "\r\n" (CRLF) in @p s to "\n" (LF).
 
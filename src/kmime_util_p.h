@@ -8,10 +8,15 @@
 
 // @cond PRIVATE
 
+#include "kmime_headers.h"
+
+#include <QVector>
+
 /* Internal helper functions. Not part of the public API. */
 
 namespace KMime
 {
+class CharFreq;
 
 /**
  *  Consult the charset cache. Only used for reducing mem usage by
@@ -37,6 +42,11 @@ extern int findHeaderLineEnd(const QByteArray &src, int &dataBegin, bool *folded
 */
 extern int indexOfHeader(const QByteArray &src, const QByteArray &name, int &end, int &dataBegin, bool *folded = nullptr);
 
+/**
+  Same as encodingsForData(), for data that has already been counted.
+*/
+extern QVector<Headers::contentEncoding> encodingsForCharFreq(const CharFreq &cf);
+
 /**
  *  Uses current time, pid and random numbers to construct a string
  *  that aims to be unique on a per-host basis (ie. for the local